@@ -6,11 +6,22 @@
       "cflags_cc!": ["-fno-exceptions"],
       "sources": [
         "src/lasso.cc",
+        "src/codec.cc",
+        "src/attributes.cc",
+        "src/authn_template.cc",
+        "src/key_index.cc",
+        "src/provider_search.cc",
+        "src/prefilter.cc",
+        "src/xml_memory.cc",
+        "src/log_capture.cc",
+        "src/warmup.cc",
         "src/server.cc",
         "src/login.cc",
         "src/logout.cc",
         "src/identity.cc",
         "src/session.cc",
+        "src/session_store.cc",
+        "src/name_id_generator.cc",
         "src/provider.cc",
         "src/utils.cc"
       ],
@@ -31,7 +42,8 @@
               "<!@(pkg-config --cflags lasso)"
             ],
             "OTHER_LDFLAGS": [
-              "<!@(pkg-config --libs lasso)"
+              "<!@(pkg-config --libs lasso)",
+              "-lz"
             ]
           }
         }],
@@ -48,7 +60,8 @@
             "<!@(pkg-config --libs-only-L lasso)"
           ],
           "libraries": [
-            "<!@(pkg-config --libs-only-l lasso)"
+            "<!@(pkg-config --libs-only-l lasso)",
+            "-lz"
           ]
         }]
       ]
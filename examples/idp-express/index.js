@@ -161,12 +161,16 @@ app.get("/saml/sso", (req, res) => {
     // Create login object and process the request
     const login = new lasso.Login(server);
     login.processAuthnRequestMsg(samlRequest);
-    login.validateRequestMsg();
+    if (relayState) {
+      login.relayState = relayState;
+    }
 
-    // Store SAML context in session
+    // Keep the login state in the session: once the user has authenticated,
+    // /saml/respond resumes it without parsing and verifying the request again
     req.session.samlRequest = {
       remoteProviderId: login.remoteProviderId,
       relayState: relayState || "",
+      login: login.dump(),
     };
 
     // If user is already logged in, send response
@@ -194,11 +198,14 @@ app.post("/saml/sso", (req, res) => {
 
     const login = new lasso.Login(server);
     login.processAuthnRequestMsg(samlRequest);
-    login.validateRequestMsg();
+    if (relayState) {
+      login.relayState = relayState;
+    }
 
     req.session.samlRequest = {
       remoteProviderId: login.remoteProviderId,
       relayState: relayState || "",
+      login: login.dump(),
     };
 
     if (req.session.user) {
@@ -222,12 +229,11 @@ app.get("/saml/respond", (req, res) => {
     const { user } = req.session;
     const { relayState } = req.session.samlRequest;
 
-    // Create a new login for the response
-    const login = new lasso.Login(server);
+    // Resume the login saved by the SSO endpoint
+    const login = lasso.Login.fromDump(server, req.session.samlRequest.login);
 
-    // We need to re-process the original request to get the context
-    // In a real implementation, you'd store the login object dump in the session
-    // For this example, we'll initiate a response directly
+    // The user has authenticated
+    login.validateRequestMsg();
 
     // Set the NameID
     login.setNameId(user.email, lasso.NameIdFormat.EMAIL);
@@ -237,11 +243,6 @@ app.get("/saml/respond", (req, res) => {
       "urn:oasis:names:tc:SAML:2.0:ac:classes:Password"
     );
 
-    // Set relay state if present
-    if (relayState) {
-      login.relayState = relayState;
-    }
-
     // Build response message
     const result = login.buildResponseMsg();
 
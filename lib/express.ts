@@ -6,7 +6,7 @@
  */
 
 import * as lasso from "./index";
-import type { Request, Response, NextFunction, Router } from "express";
+import type { CookieOptions, Request, Response, NextFunction, Router } from "express";
 import * as crypto from "crypto";
 
 /**
@@ -72,6 +72,82 @@ export function isValidRedirectUrl(url: string, allowedHosts?: string[]): boolea
   return false;
 }
 
+// Cookie binding a login tracked by the native state store to the browser
+// that started it
+const REQUEST_COOKIE = "lasso_saml_request";
+
+/**
+ * Value of the request cookie: the AuthnRequest ID and its HMAC
+ * @internal Exported for testing
+ */
+export function signRequestCookie(requestId: string, key: Buffer): string {
+  const mac = crypto.createHmac("sha256", key).update(requestId).digest("base64url");
+  return `${requestId}.${mac}`;
+}
+
+/**
+ * Attributes of the request cookie
+ * The IdP answers the HTTP-POST binding with a cross-site POST, which only
+ * carries SameSite=None cookies, and browsers only keep those with Secure.
+ * Rather than fall back to a value that silently breaks the POST binding,
+ * plain HTTP requests are refused unless Lax was chosen explicitly (which
+ * only suits an IdP answering by redirect, i.e. HTTP-Artifact).
+ * @param secure - Whether the request came over HTTPS (req.secure)
+ * @internal Exported for testing
+ */
+export function requestCookieOptions(
+  secure: boolean,
+  sameSite: "none" | "lax",
+  path: string,
+  maxAge: number,
+): CookieOptions {
+  if (sameSite === "none" && !secure) {
+    throw new Error(
+      'stateStore "native" needs HTTPS: its SameSite=None cookie is only kept over a ' +
+        'secure connection (behind a TLS-terminating proxy, set Express "trust proxy"). ' +
+        'Set requestCookieSameSite: "lax" if the IdP answers by redirect (HTTP-Artifact).',
+    );
+  }
+  return { httpOnly: true, secure, sameSite, maxAge, path };
+}
+
+/**
+ * AuthnRequest ID held by a valid request cookie, or null
+ * @param cookieHeader - Cookie request header
+ * @internal Exported for testing
+ */
+export function verifyRequestCookie(cookieHeader: string | undefined, key: Buffer): string | null {
+  if (!cookieHeader) {
+    return null;
+  }
+
+  for (const part of cookieHeader.split(";")) {
+    const eq = part.indexOf("=");
+    if (eq < 0 || part.slice(0, eq).trim() !== REQUEST_COOKIE) {
+      continue;
+    }
+
+    let value: string;
+    try {
+      value = decodeURIComponent(part.slice(eq + 1).trim());
+    } catch {
+      return null;
+    }
+    const dot = value.lastIndexOf(".");
+    if (dot <= 0) {
+      return null;
+    }
+
+    const requestId = value.slice(0, dot);
+    const expected = Buffer.from(signRequestCookie(requestId, key));
+    const actual = Buffer.from(value);
+    return expected.length === actual.length && crypto.timingSafeEqual(expected, actual)
+      ? requestId
+      : null;
+  }
+  return null;
+}
+
 /**
  * SAML SP middleware configuration
  */
@@ -150,6 +226,38 @@ export interface SamlSpConfig {
   stateMaxAge?: number;
   /** Regenerate session after authentication (default: true) */
   regenerateSession?: boolean;
+  /**
+   * Where pending login state is kept (default: 'session')
+   * - 'session': nonce and RelayState are written to the Express session
+   * - 'native': AuthnRequest IDs and RelayState are tracked in-process by the
+   *   binding and matched against InResponseTo, so the session is only written
+   *   once the user is authenticated. The request ID is also set in a short
+   *   lived HMAC-signed cookie that /acs requires to match InResponseTo, which
+   *   ties the response to the browser that started the login. Requires
+   *   /login and /acs to be served by the same process; the cookie needs
+   *   HTTPS (SameSite=None) for the IdP's cross-site POST to carry it, so
+   *   /login fails over plain HTTP (see requestCookieSameSite).
+   */
+  stateStore?: "session" | "native";
+  /**
+   * SameSite attribute of the native state store's request cookie
+   * (default: 'none'). 'none' works with every ACS binding but requires
+   * HTTPS (req.secure; set Express "trust proxy" behind a TLS proxy). 'lax'
+   * also works over HTTP but the cookie only comes back on top-level GETs,
+   * i.e. when the IdP answers by redirect (HTTP-Artifact), never on the
+   * HTTP-POST binding.
+   */
+  requestCookieSameSite?: "none" | "lax";
+  /**
+   * Build Redirect AuthnRequests from a template compiled from Lasso's first
+   * one, only filling in a new ID and IssueInstant (default: false)
+   */
+  authnRequestTemplates?: boolean;
+  /**
+   * SOAP client used to resolve HTTP-Artifact responses on the ACS
+   * (default: a pooled keep-alive client created on first use)
+   */
+  soapClient?: lasso.SoapClient;
 }
 
 /**
@@ -234,6 +342,7 @@ function extractEntityId(metadata: string): string | null {
  * // GET  /saml/metadata - SP metadata
  * // GET  /saml/login    - Initiate login
  * // POST /saml/acs      - Assertion Consumer Service
+ * // GET  /saml/acs      - Assertion Consumer Service (HTTP-Artifact)
  * // GET  /saml/logout   - Initiate logout
  * // POST /saml/slo      - Single Logout Service
  * ```
@@ -252,10 +361,20 @@ export function createSamlSp(config: SamlSpConfig): Router {
   const allowedRedirectHosts = config.allowedRedirectHosts;
   const stateMaxAge = config.stateMaxAge ?? 300000; // 5 minutes default
   const regenerateSession = config.regenerateSession !== false; // true by default
+  const stateStore = config.stateStore || "session";
+  const requestCookieSameSite = config.requestCookieSameSite ?? "none";
+  if (requestCookieSameSite !== "none" && requestCookieSameSite !== "lax") {
+    throw new Error('requestCookieSameSite must be "none" or "lax"');
+  }
+  let soapClient = config.soapClient ?? null;
+
+  // Signs the request cookie; outstanding requests are per process, so is the key
+  const requestCookieKey = crypto.randomBytes(32);
 
   // Server instance (initialized lazily)
   let server: lasso.Server | null = null;
   let spMetadataXml: string | null = null;
+  let idpId: string | null = null;
   let initPromise: Promise<void> | null = null;
 
   // Initialize server
@@ -273,15 +392,30 @@ export function createSamlSp(config: SamlSpConfig): Router {
       readFileOrString(config.idpMetadata),
     ]);
 
-    spMetadataXml = spMeta;
-    server = lasso.Server.fromBuffers(spMeta, spKeyPem, spCertPem);
-
     // Add IdP as provider
     const idpEntityId = config.idpEntityId || extractEntityId(idpMeta);
     if (!idpEntityId) {
       throw new Error("Could not extract IdP entity ID from metadata");
     }
-    server.addProviderFromBuffer(idpEntityId, idpMeta);
+
+    // Parse metadata and keys off the event loop so requests arriving
+    // during startup are not blocked
+    const newServer = await lasso.Server.fromBuffersAsync(spMeta, spKeyPem, spCertPem);
+    await newServer.addProviderFromBufferAsync(idpEntityId, idpMeta);
+
+    if (stateStore === "native") {
+      newServer.enableRequestTracking({ ttl: stateMaxAge });
+    }
+
+    // Only the ID and IssueInstant of our AuthnRequests change from one
+    // login to the next: build them from a compiled template
+    if (config.authnRequestTemplates) {
+      newServer.enableAuthnRequestTemplates();
+    }
+
+    spMetadataXml = spMeta;
+    idpId = idpEntityId;
+    server = newServer;
   }
 
   // Ensure server is initialized
@@ -329,35 +463,60 @@ export function createSamlSp(config: SamlSpConfig): Router {
       }
 
       // Initialize authentication request
-      login.initAuthnRequest();
+      login.initAuthnRequest(idpId ?? undefined);
 
       // Set options
       if (config.forceAuthn) {
         // Would set forceAuthn flag if supported
       }
 
+      let encodedState: string | null = null;
+      let cookieOptions: CookieOptions | null = null;
+      if (stateStore === "native") {
+        // Fails over plain HTTP before any request is recorded
+        cookieOptions = requestCookieOptions(
+          req.secure,
+          requestCookieSameSite,
+          `${req.baseUrl}/acs`,
+          stateMaxAge
+        );
+        // RelayState is recorded natively with the AuthnRequest ID
+        login.relayState = relayState;
+      } else {
+        // Store login state in session for later validation (CSRF protection)
+        const session = (req as RequestWithSession).session;
+        const nonce = crypto.randomUUID();
+        if (session) {
+          session.samlLoginState = {
+            relayState,
+            nonce,
+            timestamp: Date.now(),
+          };
+        }
+
+        // Include nonce in RelayState for round-trip validation
+        const statePayload = JSON.stringify({ url: relayState, nonce });
+        encodedState = Buffer.from(statePayload).toString("base64url");
+      }
+
       // Build the request message
       const result = login.buildAuthnRequestMsg();
 
-      // Store login state in session for later validation (CSRF protection)
-      const session = (req as RequestWithSession).session;
-      const nonce = crypto.randomUUID();
-      if (session) {
-        session.samlLoginState = {
-          relayState,
-          nonce,
-          timestamp: Date.now(),
-        };
+      if (cookieOptions) {
+        // Security: Bind the request to this browser (login CSRF protection)
+        if (!result.requestId) {
+          throw new Error("AuthnRequest has no ID");
+        }
+        res.cookie(REQUEST_COOKIE, signRequestCookie(result.requestId, requestCookieKey), cookieOptions);
       }
 
-      // Include nonce in RelayState for round-trip validation
-      const statePayload = JSON.stringify({ url: relayState, nonce });
-      const encodedState = Buffer.from(statePayload).toString("base64url");
-
       // Redirect to IdP
       if (result.responseUrl) {
-        const separator = result.responseUrl.includes("?") ? "&" : "?";
-        const url = `${result.responseUrl}${separator}RelayState=${encodeURIComponent(encodedState)}`;
+        let url = result.responseUrl;
+        if (encodedState) {
+          const separator = url.includes("?") ? "&" : "?";
+          url = `${url}${separator}RelayState=${encodeURIComponent(encodedState)}`;
+        }
         res.redirect(url);
       } else {
         // POST binding - return auto-submit form (with HTML escaping for XSS prevention)
@@ -371,7 +530,7 @@ export function createSamlSp(config: SamlSpConfig): Router {
             <noscript><p>JavaScript is disabled. Click the button to continue.</p></noscript>
             <form method="POST" action="${escapeHtml(postUrl)}">
               <input type="hidden" name="SAMLRequest" value="${escapeHtml(result.responseBody || "")}" />
-              <input type="hidden" name="RelayState" value="${escapeHtml(encodedState)}" />
+              <input type="hidden" name="RelayState" value="${escapeHtml(encodedState || relayState)}" />
               <noscript><input type="submit" value="Continue" /></noscript>
             </form>
           </body>
@@ -383,61 +542,99 @@ export function createSamlSp(config: SamlSpConfig): Router {
     }
   });
 
-  // POST /acs - Assertion Consumer Service (receive SAML response)
-  router.post("/acs", express.urlencoded({ extended: false }), async (
+  // /acs - Assertion Consumer Service (receive SAML response or artifact)
+  const acsHandler = async (
     req: Request,
     res: Response,
     next: NextFunction
-  ) => {
+  ): Promise<void> => {
     try {
       if (!server) {throw new Error("Server not initialized");}
 
-      const samlResponse = req.body.SAMLResponse;
+      // HTTP-Artifact responses may arrive by redirect, everything else is
+      // POSTed. A Response is never taken from the query string: it would
+      // end up in logs and browser history, and the Redirect binding is not
+      // allowed for SAML Responses.
+      const isGet = req.method === "GET";
+      const params = (isGet ? req.query : req.body) as Record<string, unknown>;
+      const samlResponse =
+        !isGet && typeof params.SAMLResponse === "string" ? params.SAMLResponse : undefined;
+      const samlArt = typeof params.SAMLart === "string" ? params.SAMLart : undefined;
       const session = (req as RequestWithSession).session;
 
-      if (!samlResponse) {
-        res.status(400).send("Missing SAMLResponse");
-        return;
-      }
-
-      // Security: Validate SAML state (CSRF protection)
-      const storedState = session?.samlLoginState;
-      if (!storedState || Date.now() - storedState.timestamp > stateMaxAge) {
-        res.status(400).send("SAML state expired or missing");
+      if (!samlResponse && !samlArt) {
+        res.status(400).send(isGet ? "Missing SAMLart" : "Missing SAMLResponse");
         return;
       }
 
-      // Security: Validate nonce from RelayState matches stored nonce
-      const relayStateParam = req.body.RelayState;
       let relayState = defaultRedirectUrl;
-      if (relayStateParam) {
-        try {
-          const decoded = Buffer.from(relayStateParam, "base64url").toString("utf-8");
-          const parsed = JSON.parse(decoded);
-          if (parsed.nonce !== storedState.nonce) {
-            res.status(400).send("Invalid SAML state: nonce mismatch");
-            return;
-          }
-          relayState = parsed.url || defaultRedirectUrl;
-        } catch {
-          res.status(400).send("Invalid RelayState format");
+      let expectedRequestId: string | null = null;
+      if (stateStore === "native") {
+        // Security: Only the browser that sent the AuthnRequest may answer it
+        expectedRequestId = verifyRequestCookie(req.headers.cookie, requestCookieKey);
+        if (!expectedRequestId) {
+          res.status(400).send("SAML state expired or missing");
+          return;
+        }
+      } else {
+        // Security: Validate SAML state (CSRF protection)
+        const storedState = session?.samlLoginState;
+        if (!storedState || Date.now() - storedState.timestamp > stateMaxAge) {
+          res.status(400).send("SAML state expired or missing");
           return;
         }
-      }
 
-      // Security: Validate redirect URL
-      if (!isValidRedirectUrl(relayState, allowedRedirectHosts)) {
-        relayState = defaultRedirectUrl;
+        // Security: Validate nonce from RelayState matches stored nonce
+        const relayStateParam = typeof params.RelayState === "string" ? params.RelayState : undefined;
+        if (relayStateParam) {
+          try {
+            const decoded = Buffer.from(relayStateParam, "base64url").toString("utf-8");
+            const parsed = JSON.parse(decoded);
+            if (parsed.nonce !== storedState.nonce) {
+              res.status(400).send("Invalid SAML state: nonce mismatch");
+              return;
+            }
+            relayState = parsed.url || defaultRedirectUrl;
+          } catch {
+            res.status(400).send("Invalid RelayState format");
+            return;
+          }
+        }
       }
 
       const login = new lasso.Login(server);
 
-      // Process the SAML response
-      login.processResponseMsg(samlResponse);
+      // Process the SAML response, resolving it over SOAP for HTTP-Artifact
+      // With the native state store this also checks InResponseTo against
+      // the outstanding AuthnRequests and restores the recorded RelayState
+      if (samlArt) {
+        if (!soapClient) {
+          soapClient = new lasso.SoapClient();
+        }
+        await lasso.resolveArtifact(login, samlArt, lasso.HttpMethod.ARTIFACT_POST, soapClient);
+      } else {
+        await login.processResponseMsgAsync(samlResponse as string);
+      }
+
+      if (stateStore === "native") {
+        // The response answered an outstanding request, but maybe not the
+        // one this browser sent
+        if (login.inResponseTo !== expectedRequestId) {
+          res.status(400).send("Invalid SAML state: request mismatch");
+          return;
+        }
+        res.clearCookie(REQUEST_COOKIE, { path: `${req.baseUrl}/acs` });
+        relayState = login.relayState || defaultRedirectUrl;
+      }
 
       // Security: Accept the SSO to complete validation
       login.acceptSso();
 
+      // Security: Validate redirect URL
+      if (!isValidRedirectUrl(relayState, allowedRedirectHosts)) {
+        relayState = defaultRedirectUrl;
+      }
+
       // Extract user information
       const nameId = login.nameId;
       const nameIdFormat = (login.nameIdFormat || lasso.NameIdFormat.UNSPECIFIED) as lasso.NameIdFormatType;
@@ -487,7 +684,10 @@ export function createSamlSp(config: SamlSpConfig): Router {
     } catch (err) {
       next(err);
     }
-  });
+  };
+
+  router.post("/acs", express.urlencoded({ extended: false }), acsHandler);
+  router.get("/acs", acsHandler);
 
   // GET /logout - Initiate SAML logout
   router.get("/logout", async (req: Request, res: Response, next: NextFunction) => {
@@ -17,14 +17,25 @@ interface NativeBinding {
   shutdown(): boolean;
   checkVersion(): string;
   isInitialized(): boolean;
+  decodeMessage(message: string, maxSize?: number): string;
+  encodeMessage(xml: string, method?: HttpMethod): string;
+  enableMemoryStats(): void;
+  memoryStats(): MemoryStats;
+  setLogCapture(options?: LogCaptureOptions | null): void;
+  drainLogs(max?: number): LogRecord[];
+  logStats(): LogStats;
+  warmup(server: Server): WarmupTimings;
   Server: ServerConstructor;
   Login: LoginConstructor;
   Logout: LogoutConstructor;
   Identity: IdentityConstructor;
   Session: SessionConstructor;
+  SessionStore: SessionStoreConstructor;
+  NameIdGenerator: NameIdGeneratorConstructor;
   HttpMethod: Record<string, number>;
   SignatureMethod: Record<string, number>;
   NameIdFormat: Record<string, string>;
+  ErrorCode: Record<string, number>;
 }
 
 // Load native binding
@@ -70,14 +81,107 @@ export function isInitialized(): boolean {
   return binding.isInitialized();
 }
 
+/**
+ * Decode an inbound SAML message to XML
+ * Accepts an HTTP-POST (base64) value, an HTTP-Redirect query string or raw XML.
+ * Throws if the decoded message would exceed maxSize bytes (default 4 MB).
+ */
+export function decodeMessage(message: string, maxSize?: number): string {
+  return binding.decodeMessage(message, maxSize);
+}
+
+/**
+ * Encode a SAML message for an HTTP binding
+ * POST (the default) returns base64; REDIRECT returns the URL-encoded deflated value
+ * to append after `SAMLRequest=` or `SAMLResponse=`.
+ */
+export function encodeMessage(xml: string, method?: HttpMethod): string {
+  return binding.encodeMessage(xml, method);
+}
+
+/**
+ * Count libxml2 allocations for memoryStats() and report the libxml2 heap to
+ * V8 as external memory. Off by default because it adds work to every
+ * libxml2 allocation. Must be called before init().
+ */
+export function enableMemoryStats(): void {
+  binding.enableMemoryStats();
+}
+
+/**
+ * Native memory held through libxml2 and the number of live wrappers
+ * Also reports the current libxml2 heap to V8 as external memory. libxml2
+ * figures stay 0 unless enableMemoryStats() was called.
+ */
+export function memoryStats(): MemoryStats {
+  return binding.memoryStats();
+}
+
+/**
+ * Capture Lasso and glib log output in a native ring buffer instead of
+ * writing it to stderr; read it back with drainLogs(). Each log domain is
+ * rate limited, and records over the limit or arriving while the ring is
+ * full are counted in logStats() and dropped.
+ * @param options - Rate limit and levels, or null to restore stderr output
+ */
+export function setLogCapture(options?: LogCaptureOptions | null): void {
+  binding.setLogCapture(options);
+}
+
+/**
+ * Take captured log records, oldest first
+ * @param max - Maximum number of records to return (default: all pending)
+ */
+export function drainLogs(max?: number): LogRecord[] {
+  return binding.drainLogs(max);
+}
+
+/**
+ * Log capture counters
+ */
+export function logStats(): LogStats {
+  return binding.logStats();
+}
+
+/**
+ * Pay Lasso's one-time start-up costs (GType registration, xmlsec and
+ * OpenSSL setup, loading the key material) before serving traffic, by
+ * signing, verifying and parsing synthetic messages with the server's keys.
+ * Call after init() and before reporting ready.
+ * @returns Duration of each warm-up stage
+ */
+export function warmup(server: Server): WarmupTimings {
+  return binding.warmup(server);
+}
+
 // Re-export native classes with TypeScript interfaces
 
 import type {
+  ArtifactResolveResult,
+  AttributeDefinition,
+  ArtifactStoreOptions,
   HttpMethod,
+  LogCaptureOptions,
+  LogRecord,
+  LogStats,
+  MemoryStats,
   MessageResult,
+  NameIdGeneratorOptions,
   NameIdFormatType,
+  ParserLimits,
+  PrefilterOptions,
+  ProcessResult,
+  ProviderFiles,
   ProviderInfo,
+  ProviderMatch,
+  ProviderSearchOptions,
+  RequestTrackingOptions,
   SamlAttribute,
+  SearchIndexStats,
+  SessionEntry,
+  SessionStoreOptions,
+  SignatureMethod,
+  WarmupTimings,
 } from "./types";
 
 // Server class interface
@@ -89,7 +193,21 @@ interface ServerConstructor {
     certificate: string | Buffer,
     privateKeyPassword?: string,
   ): Server;
+  /**
+   * Same as fromBuffers(), with metadata and keys parsed on a worker thread
+   */
+  fromBuffersAsync(
+    metadata: string | Buffer,
+    privateKey: string | Buffer,
+    certificate: string | Buffer,
+    privateKeyPassword?: string,
+  ): Promise<Server>;
   fromDump(dump: string): Server;
+  /**
+   * Signature methods a provider's metadata asks for (SAML algorithm support
+   * extension), most preferred first, limited to those Lasso can produce
+   */
+  signatureMethodsFromMetadata(metadata: string | Buffer): SignatureMethod[];
 }
 
 /**
@@ -98,13 +216,25 @@ interface ServerConstructor {
 export interface Server {
   /** Entity ID of this server */
   readonly entityId: string;
+  /** Number of outstanding AuthnRequests (0 when tracking is disabled) */
+  readonly pendingRequests: number;
+  /** Number of issued artifacts not yet resolved or expired (IdP) */
+  readonly pendingArtifacts: number;
+  /** Number of IdPs with a compiled AuthnRequest */
+  readonly authnRequestTemplates: number;
+  /** Method of signatures made with the server's key */
+  readonly signatureMethod: SignatureMethod;
+  /** Size of the searchProviders() index */
+  readonly searchIndexStats: SearchIndexStats;
 
   /**
    * Add a provider from metadata file
    * @param providerId - Entity ID of the provider
    * @param metadataPath - Path to metadata file
    * @param publicKeyPath - Path to public key file (optional)
-   * @param caCertPath - Path to CA certificate file (optional)
+   * @param caCertPath - Path to CA certificate file (optional). Lasso then
+   *   validates the signer's chain through xmlsec on every signature; pin
+   *   the signing certificate in the metadata instead where traffic is high.
    */
   addProvider(
     providerId: string,
@@ -125,6 +255,24 @@ export interface Server {
     publicKey?: string,
   ): void;
 
+  /**
+   * Same as addProviderFromBuffer(), with the metadata parsed on a worker
+   * thread; the provider is added to the server when the promise resolves
+   */
+  addProviderFromBufferAsync(
+    providerId: string,
+    metadata: string | Buffer,
+    publicKey?: string,
+  ): Promise<void>;
+
+  /**
+   * Load a batch of providers from files off the event loop. Metadata files
+   * are memory mapped and parsed in parallel; the providers are added to the
+   * server together once all of them loaded, and none are added if any fails.
+   * @returns Entity IDs of the added providers, in input order
+   */
+  addProviders(entries: ProviderFiles[]): Promise<string[]>;
+
   /**
    * Get a provider by entity ID
    * @param providerId - Entity ID of the provider
@@ -132,11 +280,92 @@ export interface Server {
    */
   getProvider(providerId: string): ProviderInfo | null;
 
+  /**
+   * Search the loaded providers for a discovery page. Matches MDUI
+   * DisplayName, Keywords, shibmd:Scope / DomainHint and entity ID by
+   * prefix and trigram (accents and case ignored); an email address or
+   * domain matches the providers scoped to it. Every query word must match.
+   * @param query - Search text
+   * @returns [entityId, displayName, score] tuples, best match first
+   */
+  searchProviders(query: string, options?: ProviderSearchOptions): ProviderMatch[];
+
   /**
    * Dump server configuration to string
    * Can be used to restore server later with Server.fromDump()
    */
   dump(): string;
+
+  /**
+   * Track outstanding AuthnRequest IDs (SP)
+   * Login.buildAuthnRequestMsg() records each request ID along with the
+   * RelayState, and Login.processResponseMsg() rejects responses whose
+   * InResponseTo is unknown, expired or replayed.
+   * @param options - Store size, TTL and unsolicited response policy
+   */
+  enableRequestTracking(options?: RequestTrackingOptions): void;
+
+  /**
+   * Stop tracking AuthnRequest IDs
+   */
+  disableRequestTracking(): void;
+
+  /**
+   * Configure the store of Responses issued through HTTP-Artifact (IdP)
+   * Replaces the current store, dropping unresolved artifacts.
+   * @param options - Store size and TTL
+   */
+  configureArtifactStore(options?: ArtifactStoreOptions): void;
+
+  /**
+   * Screen inbound messages before the full parse and signature check
+   * Unknown issuers, unexpected destinations, stale instants and deeply
+   * nested documents are rejected with an ErrorCode (category "prefilter").
+   * @param options - Checks to run, or null to disable the pre-filter
+   */
+  setPrefilter(options?: PrefilterOptions | null): void;
+
+  /**
+   * Bound the resources an inbound document may use while it is parsed
+   * The streaming parse stops at the first limit exceeded, with
+   * ErrorCode.PARSER_LIMIT (or MESSAGE_TOO_DEEP for nesting).
+   * @param limits - Limits to enforce, or null to disable them
+   */
+  setParserLimits(limits?: ParserLimits | null): void;
+
+  /**
+   * Cache compiled HTTP-Redirect AuthnRequests per IdP: the first
+   * buildAuthnRequestMsg() for an IdP goes through Lasso, later ones only
+   * fill in a new ID and IssueInstant before deflating and signing. Used
+   * when initAuthnRequest() is given the IdP entity ID. Adding providers
+   * drops the cache.
+   */
+  enableAuthnRequestTemplates(): void;
+
+  /**
+   * Build every AuthnRequest through Lasso again
+   */
+  disableAuthnRequestTemplates(): void;
+
+  /**
+   * Set the attributes released to an SP (IdP). Login.setAttributes() then
+   * only includes these, in this order and with these name formats.
+   * @param providerId - SP entity ID
+   * @param attributes - Released attributes, or null to release all as given
+   */
+  setAttributePolicy(providerId: string, attributes: AttributeDefinition[] | null): void;
+
+  /**
+   * Set the method of signatures made with the server's key. Only RSA
+   * methods are available: Lasso has no ECDSA support.
+   */
+  setSignatureMethod(method: SignatureMethod): void;
+
+  /**
+   * Sign messages to one provider with its own method, e.g. the first of
+   * Server.signatureMethodsFromMetadata(); null follows the server's again
+   */
+  setProviderSignatureMethod(providerId: string, method: SignatureMethod | null): void;
 }
 
 export const Server: ServerConstructor = binding.Server;
@@ -144,6 +373,12 @@ export const Server: ServerConstructor = binding.Server;
 // Login class interface
 interface LoginConstructor {
   new (server: Server): Login;
+  /**
+   * Restore a login saved with dump(), e.g. after the IdP login page
+   * @param server - Server the login was created with
+   * @param dump - Output of Login.dump()
+   */
+  fromDump(server: Server, dump: string): Login;
 }
 
 /**
@@ -166,6 +401,10 @@ export interface Login {
   readonly msgUrl: string | null;
   /** Message body after building */
   readonly msgBody: string | null;
+  /** ID of the current request (AuthnRequest built or received) */
+  readonly requestId: string | null;
+  /** InResponseTo of the processed response */
+  readonly inResponseTo: string | null;
 
   // IdP methods
 
@@ -176,6 +415,13 @@ export interface Login {
    */
   processAuthnRequestMsg(message: string, method?: HttpMethod): void;
 
+  /**
+   * Process an incoming AuthnRequest without throwing on rejection (IdP)
+   * @param message - The SAML AuthnRequest (base64 or URL-encoded)
+   * @returns Result object, reused across calls on this login
+   */
+  tryProcessAuthnRequestMsg(message: string): ProcessResult;
+
   /**
    * Validate the AuthnRequest (IdP)
    */
@@ -197,6 +443,8 @@ export interface Login {
 
   /**
    * Set user attributes in the assertion (IdP)
+   * Can be called before or after buildAssertion(). The server's attribute
+   * release policy for the SP, if set, filters and names them.
    * @param attributes - Array of attributes
    */
   setAttributes(attributes: SamlAttribute[]): void;
@@ -206,6 +454,20 @@ export interface Login {
    */
   buildResponseMsg(): MessageResult;
 
+  /**
+   * Build the Response for the HTTP-Artifact binding (IdP)
+   * The Response is kept in the server's artifact store and only the
+   * artifact is sent through the browser.
+   * @param method - ARTIFACT_GET (default) or ARTIFACT_POST
+   */
+  buildArtifactMsg(method?: HttpMethod): MessageResult;
+
+  /**
+   * Answer an ArtifactResolve SOAP request from the artifact store (IdP)
+   * @param message - The SOAP ArtifactResolve request body
+   */
+  processArtifactResolve(message: string): ArtifactResolveResult;
+
   // SP methods
 
   /**
@@ -222,14 +484,58 @@ export interface Login {
 
   /**
    * Process a SAML Response (SP)
+   * When request tracking is enabled on the server, InResponseTo must match
+   * an outstanding AuthnRequest and the RelayState recorded with it is
+   * restored on the login.
    * @param message - The SAML Response
    */
   processResponseMsg(message: string): void;
 
+  /**
+   * Process a SAML Response without throwing on rejection (SP)
+   * Rejections build no Error or stack trace, keeping forged traffic cheap.
+   * @param message - The SAML Response
+   * @returns Result object, reused across calls on this login
+   */
+  tryProcessResponseMsg(message: string): ProcessResult;
+
+  /**
+   * Process a SAML Response on a worker thread (SP)
+   * Signature verification of responses carrying several signed assertions
+   * runs off the event loop; messages smaller than threshold bytes are
+   * processed inline. Every other method and property of the login throws
+   * until the promise settles; adding providers or changing signature
+   * methods on the server waits for the worker.
+   * @param message - The SAML Response
+   * @param options - threshold: smallest message sent to a worker (default: 16 KB)
+   */
+  processResponseMsgAsync(message: string, options?: { threshold?: number }): Promise<void>;
+
   /**
    * Accept the SSO (SP)
    */
   acceptSso(): void;
+
+  /**
+   * Initialize an ArtifactResolve request (SP)
+   * @param message - Query string holding SAMLart (ARTIFACT_GET) or the SAMLart value (ARTIFACT_POST)
+   * @param method - ARTIFACT_GET (default) or ARTIFACT_POST
+   */
+  initRequest(message: string, method?: HttpMethod): void;
+
+  /**
+   * Build the ArtifactResolve SOAP request (SP)
+   * Send responseBody to responseUrl and pass the reply to processResponseMsg().
+   */
+  buildRequestMsg(): MessageResult;
+
+  /**
+   * Serialize the profile state (parsed request, remote provider, relay
+   * state, request ID) to resume it with Login.fromDump() without parsing
+   * and verifying the original message again. Identity and session are not
+   * included. The dump is not signed: keep it server-side.
+   */
+  dump(): string;
 }
 
 export const Login: LoginConstructor = binding.Login;
@@ -271,6 +577,13 @@ export interface Logout {
    */
   processRequestMsg(message: string, method?: HttpMethod): void;
 
+  /**
+   * Process an incoming LogoutRequest without throwing on rejection
+   * @param message - The SAML LogoutRequest
+   * @returns Result object, reused across calls on this logout
+   */
+  tryProcessRequestMsg(message: string): ProcessResult;
+
   /**
    * Validate the logout request
    */
@@ -287,6 +600,13 @@ export interface Logout {
    */
   processResponseMsg(message: string): void;
 
+  /**
+   * Process an incoming LogoutResponse without throwing on rejection
+   * @param message - The SAML LogoutResponse
+   * @returns Result object, reused across calls on this logout
+   */
+  tryProcessResponseMsg(message: string): ProcessResult;
+
   /**
    * Get the next provider to notify (for IdP-initiated SLO)
    * @returns Provider ID or null if no more providers
@@ -299,10 +619,46 @@ export interface Logout {
    * @param format - The name ID format (optional)
    */
   setNameId(nameId: string, format?: NameIdFormatType): void;
+
+  /**
+   * Build SOAP LogoutRequests for the other providers of the session (IdP)
+   * Requests are built off the main thread; send them with soapSingleLogout().
+   * @param options - Provider to skip (defaults to the logout initiator)
+   */
+  buildSoapRequestsAsync(options?: { exclude?: string }): Promise<SoapLogoutRequest[]>;
+}
+
+/**
+ * LogoutRequest built for one provider by Logout.buildSoapRequestsAsync()
+ */
+export interface SoapLogoutRequest {
+  /** Entity ID of the provider */
+  providerId: string;
+  /** SOAP endpoint of the provider */
+  responseUrl?: string;
+  /** SOAP envelope holding the LogoutRequest */
+  responseBody?: string;
+  /** Logout to process the provider's response with */
+  logout?: Logout;
+  /** Why no request could be built (e.g. no SOAP SingleLogoutService) */
+  error?: string;
+  /** Lasso error code */
+  code?: number;
 }
 
 export const Logout: LogoutConstructor = binding.Logout;
 
+// SOAP back-channel exports
+export {
+  SoapClient,
+  resolveArtifact,
+  soapSingleLogout,
+  type SingleLogoutOutcome,
+  type SingleLogoutResult,
+  type SoapClientOptions,
+  type SoapTransport,
+} from "./soap";
+
 // Express middleware exports
 export {
   createSamlSp,
@@ -366,6 +722,146 @@ export interface Session {
    * @returns Session index or null
    */
   getProviderIndex(providerId: string): string | null;
+
+  /**
+   * Get the providers the session holds assertions from
+   * @returns Array of provider entity IDs
+   */
+  getProviderIds(): string[];
+
+  /**
+   * Get every session index for a provider
+   * @param providerId - Provider entity ID
+   * @returns Array of session indexes
+   */
+  getSessionIndexes(providerId: string): string[];
+
+  /**
+   * Describe each provider's assertion (NameID, session indexes, validity)
+   * read from the in-memory session, without dumping or parsing XML
+   */
+  describe(): SessionEntry[];
 }
 
 export const Session: SessionConstructor = binding.Session;
+
+// SessionStore class interface
+interface SessionStoreConstructor {
+  new (options?: SessionStoreOptions): SessionStore;
+}
+
+/**
+ * Native in-process store of live sessions and identities (IdP)
+ *
+ * Keeps the parsed Lasso objects per user key instead of their dumps, so SSO
+ * and SLO hops attach them to a profile without parsing XML. Keys are spread
+ * over lock-striped shards with LRU eviction; a session expires at the latest
+ * SessionNotOnOrAfter of its assertions, an assertion without one counting
+ * as `ttl` after the save.
+ */
+export interface SessionStore {
+  /** Number of stored sessions, including expired ones not swept yet */
+  readonly size: number;
+
+  /**
+   * Keep the session (and identity) of a profile by reference. A profile
+   * whose session is empty, such as after logout, removes the entry.
+   * @param key - User key
+   * @param profile - Login or Logout
+   * @returns true if the session was stored
+   */
+  save(key: string, profile: Login | Logout): boolean;
+
+  /**
+   * Attach the stored session (and identity) to a profile. The profile
+   * shares the stored objects rather than a copy; do not attach one session
+   * to two profiles processed at the same time.
+   * @param key - User key
+   * @param profile - Login or Logout
+   * @returns false if no live session is stored under key
+   */
+  load(key: string, profile: Login | Logout): boolean;
+
+  /**
+   * Store a Session (and Identity) by reference
+   * @param key - User key
+   */
+  put(key: string, session: Session, identity?: Identity | null): void;
+
+  /**
+   * Get the stored objects, shared with the store
+   * @param key - User key
+   */
+  get(key: string): { session: Session; identity: Identity | null } | null;
+
+  /**
+   * Remove a stored session
+   * @returns true if an entry was removed
+   */
+  delete(key: string): boolean;
+
+  /**
+   * Drop expired sessions
+   * @returns Number of sessions removed
+   */
+  sweep(): number;
+
+  /** Remove every stored session */
+  clear(): void;
+
+  /**
+   * Write the live sessions to a file (created 0600, replaced atomically),
+   * e.g. before a graceful restart
+   * @returns Number of sessions written
+   */
+  snapshot(path: string): number;
+
+  /**
+   * Load a snapshot written by snapshot(), skipping expired sessions
+   * @returns Number of sessions restored
+   */
+  restore(path: string): number;
+}
+
+export const SessionStore: SessionStoreConstructor = binding.SessionStore;
+
+// NameIdGenerator class interface
+interface NameIdGeneratorConstructor {
+  new (secret: string | Buffer, options?: NameIdGeneratorOptions): NameIdGenerator;
+}
+
+/**
+ * Stable pseudonymous persistent NameIDs (IdP)
+ *
+ * The NameID of a user at an SP is HMAC-SHA256 of the user ID under a key
+ * derived from the secret and the SP entity ID, as unpadded base64url. The
+ * same secret always gives the same NameID, so none need to be stored.
+ */
+export interface NameIdGenerator {
+  /**
+   * Persistent NameID of a user at an SP, recorded for resolve()
+   * @param userId - Local user identifier
+   * @param spEntityId - SP entity ID (e.g. login.remoteProviderId)
+   */
+  generate(userId: string, spEntityId: string): string;
+
+  /**
+   * NameIDs of many [userId, spEntityId] pairs, in order (not recorded for
+   * resolve()), e.g. to migrate stored pseudonyms
+   */
+  generateBatch(pairs: Array<[string, string]>): string[];
+
+  /**
+   * User a NameID was generated for, e.g. from a LogoutRequest
+   * @returns User ID, or null if the NameID is not in the reverse index
+   */
+  resolve(nameId: string, spEntityId: string): string | null;
+
+  /**
+   * Drop a NameID from the reverse index
+   * @returns true if it was indexed
+   */
+  forget(nameId: string, spEntityId: string): boolean;
+}
+
+export const NameIdGenerator: NameIdGeneratorConstructor = binding.NameIdGenerator;
@@ -0,0 +1,245 @@
+/**
+ * SOAP back-channel client (HTTP-Artifact resolution, Single Logout)
+ *
+ * Copyright (c) LINAGORA <https://linagora.com>
+ * License: GPL-2.0-or-later
+ */
+
+import * as http from "http";
+import * as https from "https";
+import type { Login, Logout } from "./index";
+import type { HttpMethod } from "./types";
+
+/**
+ * Sends a SOAP envelope and resolves with the response envelope
+ * Replace the default HTTP transport with a local stand-in in tests.
+ * signal is aborted once the request's deadline passes; the client gives up
+ * on the request then whether or not the transport honours it.
+ */
+export type SoapTransport = (
+  url: string,
+  body: string,
+  options: { timeout: number; maxResponseSize: number; signal: AbortSignal },
+) => Promise<string>;
+
+/**
+ * SOAP client configuration
+ */
+export interface SoapClientOptions {
+  /** Deadline of each request in ms, from connecting to the last response byte (default: 10000) */
+  timeout?: number;
+  /** Maximum concurrent sockets per host (default: 16) */
+  maxSockets?: number;
+  /** Maximum response size in bytes (default: 4 MB) */
+  maxResponseSize?: number;
+  /** Custom transport (default: pooled keep-alive HTTP(S) client) */
+  transport?: SoapTransport;
+}
+
+/**
+ * Outcome of the SOAP logout of one provider
+ */
+export interface SingleLogoutResult {
+  /** Entity ID of the provider */
+  providerId: string;
+  /** Whether the provider confirmed the logout */
+  ok: boolean;
+  /** Failure reason */
+  error?: string;
+}
+
+/**
+ * Aggregated outcome of a SOAP Single Logout fan-out
+ */
+export interface SingleLogoutOutcome {
+  /** True when every provider confirmed (false means partial logout) */
+  complete: boolean;
+  /** Per-provider outcomes */
+  results: SingleLogoutResult[];
+}
+
+// SOAPAction header mandated by the SAML SOAP binding
+const SOAP_ACTION = '"http://www.oasis-open.org/committees/security"';
+
+/**
+ * SOAP client with pooled keep-alive connections
+ *
+ * @example
+ * ```typescript
+ * const client = new SoapClient({ timeout: 5000 });
+ * await resolveArtifact(login, req.url.split("?")[1], HttpMethod.ARTIFACT_GET, client);
+ * login.acceptSso();
+ * ```
+ */
+export class SoapClient {
+  private readonly timeout: number;
+  private readonly maxResponseSize: number;
+  private readonly transport: SoapTransport;
+  private readonly httpAgent: http.Agent;
+  private readonly httpsAgent: https.Agent;
+
+  constructor(options: SoapClientOptions = {}) {
+    this.timeout = options.timeout ?? 10000;
+    this.maxResponseSize = options.maxResponseSize ?? 4 * 1024 * 1024;
+
+    const maxSockets = options.maxSockets ?? 16;
+    this.httpAgent = new http.Agent({ keepAlive: true, maxSockets });
+    this.httpsAgent = new https.Agent({ keepAlive: true, maxSockets });
+
+    this.transport = options.transport ?? ((url, body, opts) => this.request(url, body, opts));
+  }
+
+  /**
+   * POST a SOAP envelope
+   * @param url - SOAP endpoint
+   * @param body - SOAP envelope
+   * @returns The response envelope
+   */
+  post(url: string, body: string): Promise<string> {
+    // The socket timeout only fires on idle sockets: an endpoint dripping
+    // bytes would hold the request open forever without an overall deadline
+    const controller = new AbortController();
+    let timer: NodeJS.Timeout | undefined;
+    const deadline = new Promise<never>((_, reject) => {
+      timer = setTimeout(() => {
+        const error = new Error("SOAP request timed out");
+        controller.abort(error);
+        reject(error);
+      }, this.timeout);
+    });
+
+    const response = this.transport(url, body, {
+      timeout: this.timeout,
+      maxResponseSize: this.maxResponseSize,
+      signal: controller.signal,
+    });
+    return Promise.race([response, deadline]).finally(() => clearTimeout(timer));
+  }
+
+  /**
+   * Close pooled connections
+   */
+  destroy(): void {
+    this.httpAgent.destroy();
+    this.httpsAgent.destroy();
+  }
+
+  private request(
+    url: string,
+    body: string,
+    options: { timeout: number; maxResponseSize: number; signal: AbortSignal },
+  ): Promise<string> {
+    const target = new URL(url);
+    if (target.protocol !== "https:" && target.protocol !== "http:") {
+      return Promise.reject(new Error(`Unsupported SOAP endpoint protocol: ${target.protocol}`));
+    }
+
+    const isHttps = target.protocol === "https:";
+    const client = isHttps ? https : http;
+
+    return new Promise((resolve, reject) => {
+      const req = client.request(
+        target,
+        {
+          method: "POST",
+          agent: isHttps ? this.httpsAgent : this.httpAgent,
+          timeout: options.timeout,
+          signal: options.signal,
+          headers: {
+            "Content-Type": "text/xml; charset=utf-8",
+            "Content-Length": Buffer.byteLength(body),
+            SOAPAction: SOAP_ACTION,
+          },
+        },
+        (res) => {
+          const chunks: Buffer[] = [];
+          let size = 0;
+
+          res.on("data", (chunk: Buffer) => {
+            size += chunk.length;
+            // Security: Bound the response size to prevent DoS
+            if (size > options.maxResponseSize) {
+              req.destroy(new Error("SOAP response too large"));
+              return;
+            }
+            chunks.push(chunk);
+          });
+          res.on("end", () => {
+            if (res.statusCode !== 200) {
+              reject(new Error(`SOAP endpoint returned HTTP ${res.statusCode}`));
+              return;
+            }
+            resolve(Buffer.concat(chunks).toString("utf-8"));
+          });
+          res.on("error", reject);
+        },
+      );
+
+      req.on("timeout", () => req.destroy(new Error("SOAP request timed out")));
+      req.on("error", reject);
+      req.end(body);
+    });
+  }
+}
+
+/**
+ * Resolve an artifact received on the Assertion Consumer Service (SP)
+ * Builds the ArtifactResolve request, sends it to the IdP and processes the
+ * ArtifactResponse, after which login.acceptSso() can be called.
+ * @param login - Login bound to the SP server
+ * @param message - Query string holding SAMLart (ARTIFACT_GET) or the SAMLart value (ARTIFACT_POST)
+ * @param method - ARTIFACT_GET or ARTIFACT_POST
+ * @param client - SOAP client used for the back-channel
+ */
+export async function resolveArtifact(
+  login: Login,
+  message: string,
+  method: HttpMethod,
+  client: SoapClient,
+): Promise<void> {
+  login.initRequest(message, method);
+  const request = login.buildRequestMsg();
+
+  if (!request.responseUrl || !request.responseBody) {
+    throw new Error("No artifact resolution service for the identity provider");
+  }
+
+  const response = await client.post(request.responseUrl, request.responseBody);
+  login.processResponseMsg(response);
+}
+
+/**
+ * Log the session out of its other providers over SOAP (IdP)
+ * Requests are sent concurrently, each bounded by the client timeout as an
+ * overall deadline, so the fan-out takes as long as the slowest provider
+ * (at most the timeout) rather than their sum.
+ * @param logout - Logout holding the session (and the processed request, if any)
+ * @param client - SOAP client used for the back-channel
+ * @param options - Provider to skip (defaults to the logout initiator)
+ */
+export async function soapSingleLogout(
+  logout: Logout,
+  client: SoapClient,
+  options?: { exclude?: string },
+): Promise<SingleLogoutOutcome> {
+  const requests = await logout.buildSoapRequestsAsync(options);
+
+  const results = await Promise.all(
+    requests.map(async (request): Promise<SingleLogoutResult> => {
+      const { providerId } = request;
+      if (!request.logout || !request.responseUrl || !request.responseBody) {
+        return { providerId, ok: false, error: request.error || "No SOAP logout endpoint" };
+      }
+
+      try {
+        const response = await client.post(request.responseUrl, request.responseBody);
+        request.logout.processResponseMsg(response);
+        return { providerId, ok: true };
+      } catch (err) {
+        return { providerId, ok: false, error: err instanceof Error ? err.message : String(err) };
+      }
+    }),
+  );
+
+  return { complete: results.every((result) => result.ok), results };
+}
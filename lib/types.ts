@@ -1,24 +1,25 @@
 /**
  * HTTP methods for SAML message binding
+ * Values match LassoHttpMethod
  */
 export enum HttpMethod {
-  NONE = 0,
-  GET = 1,
-  POST = 2,
-  REDIRECT = 3,
-  SOAP = 4,
-  ARTIFACT_GET = 5,
-  ARTIFACT_POST = 6,
+  NONE = -1,
+  GET = 2,
+  POST = 3,
+  REDIRECT = 4,
+  SOAP = 5,
+  ARTIFACT_GET = 6,
+  ARTIFACT_POST = 7,
 }
 
 /**
- * Signature methods for SAML messages
+ * Signature methods for SAML messages (values match Lasso's)
  */
 export enum SignatureMethod {
   RSA_SHA1 = 1,
-  RSA_SHA256 = 2,
-  RSA_SHA384 = 3,
-  RSA_SHA512 = 4,
+  RSA_SHA256 = 4,
+  RSA_SHA384 = 6,
+  RSA_SHA512 = 8,
 }
 
 /**
@@ -35,6 +36,54 @@ export const NameIdFormat = {
 
 export type NameIdFormatType = (typeof NameIdFormat)[keyof typeof NameIdFormat];
 
+/**
+ * Binding-side error codes reported by the try* methods
+ * (Lasso's own codes are passed through unchanged)
+ */
+export const ErrorCode = {
+  MESSAGE_TOO_LARGE: -10001,
+  UNSOLICITED_RESPONSE: -10002,
+  UNKNOWN_IN_RESPONSE_TO: -10003,
+  UNKNOWN_ISSUER: -10004,
+  WRONG_DESTINATION: -10005,
+  STALE_ISSUE_INSTANT: -10006,
+  MALFORMED_MESSAGE: -10007,
+  MESSAGE_TOO_DEEP: -10008,
+  PARSER_LIMIT: -10009,
+  UNKNOWN_SIGNING_KEY: -10010,
+  STORE_FULL: -10011,
+} as const;
+
+/**
+ * Coarse error category of a result code
+ */
+export type ErrorCategory =
+  | "ok"
+  | "binding"
+  | "prefilter"
+  | "lasso"
+  | "xml"
+  | "signature"
+  | "server"
+  | "logout"
+  | "profile"
+  | "param"
+  | "login";
+
+/**
+ * Result of a non-throwing try* process method
+ * The same object is reused by every call on a given Login/Logout, so read
+ * it before processing the next message.
+ */
+export interface ProcessResult {
+  /** Whether the message was accepted */
+  ok: boolean;
+  /** 0, a Lasso error code or an ErrorCode value */
+  code: number;
+  /** Error category */
+  category: ErrorCategory;
+}
+
 /**
  * SAML 2.0 Authentication context classes
  */
@@ -63,6 +112,18 @@ export interface ProviderOptions {
   caCert?: string | Buffer;
 }
 
+/**
+ * Provider files for Server.addProviders()
+ */
+export interface ProviderFiles {
+  /** Path to the metadata XML file */
+  metadataPath: string;
+  /** Path to the public key PEM file (optional) */
+  publicKeyPath?: string;
+  /** Path to the CA certificate PEM file (optional) */
+  caCertPath?: string;
+}
+
 /**
  * Options for creating a server
  */
@@ -89,8 +150,244 @@ export interface MessageResult {
   httpMethod: HttpMethod;
   /** RelayState value */
   relayState?: string;
+  /** ID of the built request (AuthnRequest) */
+  requestId?: string;
+  /** Artifact standing in for the Response (HTTP-Artifact binding) */
+  artifact?: string;
+}
+
+/**
+ * Result from answering an ArtifactResolve request (IdP)
+ */
+export interface ArtifactResolveResult {
+  /** SOAP ArtifactResponse to send back to the SP */
+  responseBody: string;
+  /** Whether the artifact matched a stored Response issued to the requester */
+  resolved: boolean;
+}
+
+/**
+ * Options for tracking outstanding AuthnRequests on a Server
+ */
+export interface RequestTrackingOptions {
+  /**
+   * Maximum number of outstanding requests kept (default: 10000). While full,
+   * each new request evicts the oldest one, whose response is then rejected.
+   */
+  maxEntries?: number;
+  /** Time in ms after which an unanswered request expires (default: 300000) */
+  ttl?: number;
+  /** Accept responses without InResponseTo (IdP-initiated SSO, default: false) */
+  allowUnsolicited?: boolean;
+}
+
+/**
+ * Options for a native SessionStore
+ */
+export interface SessionStoreOptions {
+  /** Number of lock-striped shards keys are spread over (default: 16, max 1024) */
+  shards?: number;
+  /** Maximum number of stored sessions, split evenly between shards (default: 100000) */
+  maxEntries?: number;
+  /** Lifetime in ms of sessions whose assertions carry no SessionNotOnOrAfter (default: 8 hours) */
+  ttl?: number;
+}
+
+/**
+ * Options for the reverse index of a NameIdGenerator
+ */
+export interface NameIdGeneratorOptions {
+  /** Maximum number of NameIDs resolve() knows (default: 100000) */
+  maxEntries?: number;
+  /** Time in ms a generated NameID stays resolvable (default: 30 days) */
+  ttl?: number;
+}
+
+/**
+ * Options for the store of Responses issued through HTTP-Artifact (IdP)
+ */
+export interface ArtifactStoreOptions {
+  /**
+   * Maximum number of unresolved artifacts kept (default: 10000). While full,
+   * buildArtifactMsg() throws rather than drop unresolved artifacts.
+   */
+  maxEntries?: number;
+  /** Time in ms after which an unresolved artifact expires (default: 120000) */
+  ttl?: number;
+}
+
+/**
+ * Checks run on inbound messages before the full parse and signature check
+ */
+export interface PrefilterOptions {
+  /** Reject messages whose Issuer is not a registered provider (default: true) */
+  knownIssuer?: boolean;
+  /** Accepted Destination values; messages without Destination pass (default: any) */
+  destinations?: string[];
+  /** Oldest accepted IssueInstant in ms, 0 to skip the check (default: 300000) */
+  maxAge?: number;
+  /** Accepted IssueInstant drift into the future in ms (default: 180000) */
+  clockSkew?: number;
+  /** Deepest accepted element nesting, 0 for no limit (default: 64) */
+  maxDepth?: number;
+  /**
+   * Reject messages whose own signature has a KeyInfo certificate or KeyName
+   * matching none of the issuer's metadata signing keys (default: false)
+   */
+  knownKey?: boolean;
+}
+
+/**
+ * Resource bounds on inbound documents, enforced while they are parsed
+ */
+export interface ParserLimits {
+  /** Deepest element nesting, 0 for no limit (default: 64) */
+  maxDepth?: number;
+  /** Element, text and comment nodes per document (default: 20000) */
+  maxNodes?: number;
+  /** Attributes on a single element (default: 64) */
+  maxAttributes?: number;
+  /** Bytes in a single text node (default: 1048576) */
+  maxTextSize?: number;
+  /** Namespace declarations per document (default: 256) */
+  maxNamespaces?: number;
 }
 
+/**
+ * Native memory usage returned by memoryStats()
+ */
+export interface MemoryStats {
+  /** Whether libxml2 allocations are counted (see enableMemoryStats()) */
+  enabled: boolean;
+  /** Live bytes allocated by libxml2 (documents, nodes, strings) */
+  xmlBytes: number;
+  /** Live libxml2 allocations */
+  xmlAllocations: number;
+  /** Bytes currently reported to V8 as external memory */
+  externalBytes: number;
+  /** Live native wrappers by type */
+  objects: {
+    server: number;
+    login: number;
+    logout: number;
+    identity: number;
+    session: number;
+  };
+}
+
+/**
+ * Options for capturing Lasso and glib log output
+ */
+export interface LogCaptureOptions {
+  /** Records kept per log domain per second, 0 for no limit (default: 50) */
+  rateLimit?: number;
+  /** Also capture info and debug records (default: false) */
+  debug?: boolean;
+}
+
+/**
+ * Captured log record returned by drainLogs()
+ */
+export interface LogRecord {
+  /** Time the record was logged (ms since the epoch) */
+  time: number;
+  level: "critical" | "warning" | "message" | "info" | "debug";
+  /** glib log domain ("Lasso", "GLib", ...) */
+  domain: string;
+  /** Message, truncated to 479 bytes */
+  message: string;
+}
+
+/**
+ * Log capture counters returned by logStats()
+ */
+export interface LogStats {
+  capturing: boolean;
+  /** Records written to the ring */
+  captured: number;
+  /** Records lost because the ring was full */
+  dropped: number;
+  /** Records suppressed by the per-domain rate limit */
+  rateLimited: number;
+  /** Records waiting to be drained */
+  pending: number;
+  /** Counters per log domain ("other" once 15 domains are tracked) */
+  domains: Record<string, { captured: number; dropped: number; rateLimited: number }>;
+}
+
+/**
+ * Stage durations in milliseconds reported by warmup()
+ */
+export interface WarmupTimings {
+  /** Instantiating every SAML 2.0 node and profile type */
+  types: number;
+  /** Loading the server's private key */
+  keys: number;
+  /** XML and query signing, null when the server has no private key */
+  sign: number | null;
+  /** XML and query signature verification, null without a private key */
+  verify: number | null;
+  /** Serializing and re-parsing each protocol message type */
+  parse: number;
+  total: number;
+}
+
+/**
+ * Per-provider summary returned by Session.describe()
+ */
+export interface SessionEntry {
+  /** Entity ID of the provider the assertion came from */
+  providerId: string;
+  /** NameID value, null when the assertion has none */
+  nameId: string | null;
+  /** NameID Format */
+  nameIdFormat?: string;
+  /** NameID NameQualifier */
+  nameQualifier?: string;
+  /** NameID SPNameQualifier */
+  spNameQualifier?: string;
+  /** Session indexes held for the provider */
+  sessionIndexes: string[];
+  /** AuthnInstant of the AuthnStatement */
+  authnInstant?: string;
+  /** NotOnOrAfter of the assertion Conditions */
+  notOnOrAfter?: string;
+  /** SessionNotOnOrAfter of the AuthnStatement */
+  sessionNotOnOrAfter?: string;
+}
+
+/**
+ * Options for Server.searchProviders()
+ */
+export interface ProviderSearchOptions {
+  /** Maximum number of results (default: 10, max 1000) */
+  limit?: number;
+  /** Only return identity or service providers */
+  role?: "idp" | "sp";
+}
+
+/**
+ * Size of the provider search index (Server.searchIndexStats)
+ */
+export interface SearchIndexStats {
+  /** Providers that can be found */
+  providers: number;
+  /** Indexed documents, including those of replaced providers awaiting compaction */
+  documents: number;
+  /** Indexed terms across all documents */
+  postings: number;
+  /** Distinct trigrams */
+  trigrams: number;
+  /** Distinct scopes and domain hints */
+  domains: number;
+}
+
+/**
+ * A Server.searchProviders() result: entity ID, display name (MDUI, else the
+ * organization's, null if neither) and relevance score
+ */
+export type ProviderMatch = [entityId: string, displayName: string | null, score: number];
+
 /**
  * Provider information returned by Server.getProvider()
  */
@@ -99,6 +396,8 @@ export interface ProviderInfo {
   entityId: string;
   /** Provider metadata XML (if available) */
   metadata?: string;
+  /** Signing keys listed in the metadata, when loaded through this binding */
+  signingKeys?: Array<{ sha256?: string; keyName?: string }>;
 }
 
 /**
@@ -112,3 +411,15 @@ export interface SamlAttribute {
   /** Attribute values */
   values: string[];
 }
+
+/**
+ * An attribute released to an SP, see Server.setAttributePolicy()
+ */
+export interface AttributeDefinition {
+  /** Attribute name */
+  name: string;
+  /** Attribute name format (default: basic) */
+  nameFormat?: string;
+  /** Friendly name (optional) */
+  friendlyName?: string;
+}
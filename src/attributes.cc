@@ -0,0 +1,83 @@
+#include "attributes.h"
+
+namespace lasso_js {
+
+AttributeRelease::AttributeRelease(std::vector<AttributeDefinition> definitions)
+    : definitions_(std::move(definitions)) {
+  for (size_t i = 0; i < definitions_.size(); i++) {
+    index_.emplace(definitions_[i].name, static_cast<int>(i));
+  }
+}
+
+int AttributeRelease::Find(const std::string& name) const {
+  auto it = index_.find(name);
+  return it == index_.end() ? -1 : it->second;
+}
+
+static LassoSaml2Attribute* NewAttribute(const std::string& name,
+                                         const std::string& nameFormat,
+                                         const std::string& friendlyName,
+                                         const std::vector<std::string>& values) {
+  LassoSaml2Attribute* attribute = LASSO_SAML2_ATTRIBUTE(lasso_saml2_attribute_new());
+  attribute->Name = g_strdup(name.c_str());
+  attribute->NameFormat = g_strdup(
+    nameFormat.empty() ? LASSO_SAML2_ATTRIBUTE_NAME_FORMAT_BASIC : nameFormat.c_str());
+  if (!friendlyName.empty()) {
+    attribute->FriendlyName = g_strdup(friendlyName.c_str());
+  }
+
+  for (const std::string& value : values) {
+    LassoMiscTextNode* text = LASSO_MISC_TEXT_NODE(
+      lasso_misc_text_node_new_with_string(value.c_str()));
+    text->text_child = TRUE;
+
+    LassoSaml2AttributeValue* node =
+      LASSO_SAML2_ATTRIBUTE_VALUE(lasso_saml2_attribute_value_new());
+    node->any = g_list_append(nullptr, text);
+    attribute->AttributeValue = g_list_append(attribute->AttributeValue, node);
+  }
+
+  return attribute;
+}
+
+LassoSaml2AttributeStatement* BuildAttributeStatement(
+    const std::vector<AttributeValues>& attributes, const AttributeRelease* policy) {
+  GList* list = nullptr;
+
+  if (policy) {
+    // Order the values by policy, dropping what the SP may not see
+    const std::vector<AttributeDefinition>& definitions = policy->Definitions();
+    std::vector<const AttributeValues*> slots(definitions.size(), nullptr);
+    for (const AttributeValues& attribute : attributes) {
+      int i = policy->Find(attribute.name);
+      if (i >= 0) {
+        slots[i] = &attribute;
+      }
+    }
+
+    for (size_t i = 0; i < definitions.size(); i++) {
+      if (!slots[i] || slots[i]->values.empty()) {
+        continue;
+      }
+      const AttributeDefinition& definition = definitions[i];
+      list = g_list_prepend(list, NewAttribute(definition.name, definition.nameFormat,
+                                               definition.friendlyName, slots[i]->values));
+    }
+  } else {
+    for (const AttributeValues& attribute : attributes) {
+      list = g_list_prepend(list, NewAttribute(attribute.name, attribute.nameFormat,
+                                               std::string(), attribute.values));
+    }
+  }
+
+  if (!list) {
+    return nullptr;
+  }
+
+  LassoSaml2AttributeStatement* statement =
+    LASSO_SAML2_ATTRIBUTE_STATEMENT(lasso_saml2_attribute_statement_new());
+  statement->Attribute = g_list_reverse(list);
+  return statement;
+}
+
+} // namespace lasso_js
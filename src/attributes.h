@@ -0,0 +1,60 @@
+#ifndef LASSO_JS_ATTRIBUTES_H
+#define LASSO_JS_ATTRIBUTES_H
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lasso_js {
+
+// An attribute and its values as passed to Login.setAttributes()
+struct AttributeValues {
+  std::string name;
+  std::string nameFormat;  // Empty = basic, or the release policy's format
+  std::vector<std::string> values;
+};
+
+// One attribute an SP may receive
+struct AttributeDefinition {
+  std::string name;
+  std::string nameFormat;
+  std::string friendlyName;
+};
+
+/**
+ * AttributeRelease - Attribute release policy of one SP
+ *
+ * Which attributes are released to the SP, in which order, and with which
+ * NameFormat and FriendlyName. The name index is built when the policy is
+ * set; the Attribute nodes are still created per assertion.
+ */
+class AttributeRelease {
+ public:
+  explicit AttributeRelease(std::vector<AttributeDefinition> definitions);
+
+  const std::vector<AttributeDefinition>& Definitions() const { return definitions_; }
+
+  // Index of an attribute in the policy, or -1 if it is not released
+  int Find(const std::string& name) const;
+
+ private:
+  std::vector<AttributeDefinition> definitions_;
+  std::unordered_map<std::string, int> index_;
+};
+
+/**
+ * Build an AttributeStatement from attribute values. With a policy, only
+ * released attributes are included, in policy order and with the policy's
+ * NameFormat and FriendlyName. Returns null when nothing is released.
+ */
+LassoSaml2AttributeStatement* BuildAttributeStatement(
+    const std::vector<AttributeValues>& attributes, const AttributeRelease* policy);
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_ATTRIBUTES_H
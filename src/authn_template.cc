@@ -0,0 +1,177 @@
+#include "authn_template.h"
+#include "codec.h"
+#include "utils.h"
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/random.h>  // getentropy() is declared here on macOS
+#endif
+
+namespace lasso_js {
+
+// Same shape as Lasso's own IDs: '_' and 40 hex digits (160 random bits)
+static bool NewRequestId(std::string* id) {
+  unsigned char bytes[20];
+  if (getentropy(bytes, sizeof(bytes)) != 0) {
+    return false;
+  }
+
+  static const char hex[] = "0123456789ABCDEF";
+  id->assign(1, '_');
+  for (unsigned char b : bytes) {
+    id->push_back(hex[b >> 4]);
+    id->push_back(hex[b & 0x0f]);
+  }
+  return true;
+}
+
+static std::string CurrentInstant() {
+  time_t now = time(nullptr);
+  struct tm tm;
+  gmtime_r(&now, &tm);
+
+  char buf[32];
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return buf;
+}
+
+// Position of the value of attribute name="value", or npos
+static size_t FindAttributeValue(const std::string& xml, const char* name, const char* value) {
+  std::string needle = std::string(" ") + name + "=\"" + value + "\"";
+  size_t pos = xml.find(needle);
+  if (pos == std::string::npos || xml.find(needle, pos + 1) != std::string::npos) {
+    return std::string::npos;  // Absent or ambiguous
+  }
+  return pos + needle.size() - strlen(value) - 1;
+}
+
+AuthnRequestTemplates::AuthnRequestTemplates(LassoServer* server) : server_(server) {}
+
+AuthnRequestTemplates::~AuthnRequestTemplates() {
+  if (!IsLassoInitialized()) {
+    return;
+  }
+  for (auto& entry : keys_) {
+    g_object_unref(entry.second);
+  }
+}
+
+std::shared_ptr<const AuthnRequestTemplate> AuthnRequestTemplates::Find(
+    const std::string& providerId) const {
+  auto it = templates_.find(providerId);
+  return it == templates_.end() ? nullptr : it->second;
+}
+
+void AuthnRequestTemplates::Compile(const std::string& providerId, LassoProfile* profile) {
+  if (!profile->msg_url || !profile->request ||
+      !LASSO_IS_SAMLP2_REQUEST_ABSTRACT(profile->request)) {
+    return;
+  }
+  LassoSamlp2RequestAbstract* request = LASSO_SAMLP2_REQUEST_ABSTRACT(profile->request);
+  if (!request->ID || !request->IssueInstant) {
+    return;
+  }
+
+  std::string url = profile->msg_url;
+  size_t query = url.find("SAMLRequest=");
+  if (query == std::string::npos) {
+    return;
+  }
+
+  // Work from the XML Lasso actually sent
+  std::string xml;
+  if (DecodeSamlMessage(url.substr(query), &xml) != DecodeStatus::kOk) {
+    return;
+  }
+
+  size_t id = FindAttributeValue(xml, "ID", request->ID);
+  size_t instant = FindAttributeValue(xml, "IssueInstant", request->IssueInstant);
+  if (id == std::string::npos || instant == std::string::npos) {
+    return;
+  }
+
+  auto tmpl = std::make_shared<AuthnRequestTemplate>();
+  tmpl->endpoint = url.substr(0, query);
+  tmpl->sign = url.find("&Signature=", query) != std::string::npos;
+  tmpl->idFirst = id < instant;
+
+  size_t first = tmpl->idFirst ? id : instant;
+  size_t firstEnd = first + strlen(tmpl->idFirst ? request->ID : request->IssueInstant);
+  size_t second = tmpl->idFirst ? instant : id;
+  size_t secondEnd = second + strlen(tmpl->idFirst ? request->IssueInstant : request->ID);
+  tmpl->head = xml.substr(0, first);
+  tmpl->middle = xml.substr(firstEnd, second - firstEnd);
+  tmpl->tail = xml.substr(secondEnd);
+
+  // Sign with the method Lasso chose for this IdP (see setProviderSignatureMethod)
+  tmpl->method = LASSO_SIGNATURE_METHOD_NONE;
+  if (tmpl->sign) {
+    size_t sigAlg = url.find("&SigAlg=", query);
+    if (sigAlg != std::string::npos) {
+      sigAlg += strlen("&SigAlg=");
+      size_t end = url.find('&', sigAlg);
+      std::string uri = UrlDecode(url.data() + sigAlg,
+                                  (end == std::string::npos ? url.size() : end) - sigAlg);
+      tmpl->method = SignatureMethodFromUri(uri.c_str());
+    }
+    if (tmpl->method == LASSO_SIGNATURE_METHOD_NONE || !server_->private_key) {
+      return;
+    }
+    if (!keys_.count(tmpl->method)) {
+      LassoKey* key = lasso_key_new_for_signature_from_file(
+        server_->private_key,
+        server_->private_key_password,
+        tmpl->method,
+        server_->certificate
+      );
+      if (!key) {
+        return;
+      }
+      keys_[tmpl->method] = key;
+    }
+  }
+
+  templates_[providerId] = std::move(tmpl);
+}
+
+bool AuthnRequestTemplates::Build(const AuthnRequestTemplate& tmpl, const char* relayState,
+                                  std::string* url, std::string* requestId) {
+  if (!NewRequestId(requestId)) {
+    return false;
+  }
+  std::string instant = CurrentInstant();
+
+  const std::string& first = tmpl.idFirst ? *requestId : instant;
+  const std::string& second = tmpl.idFirst ? instant : *requestId;
+  std::string xml;
+  xml.reserve(tmpl.head.size() + tmpl.middle.size() + tmpl.tail.size() + 64);
+  xml.append(tmpl.head).append(first).append(tmpl.middle).append(second).append(tmpl.tail);
+
+  std::string encoded;
+  if (!EncodeSamlMessage(xml, MessageEncoding::kRedirect, &encoded)) {
+    return false;
+  }
+
+  // Parameter order matters: the signature covers the query as built
+  std::string query = "SAMLRequest=" + encoded;
+  if (relayState && *relayState) {
+    query += "&RelayState=" + UrlEncode(relayState);
+  }
+
+  if (tmpl.sign) {
+    auto key = keys_.find(tmpl.method);
+    char* signedQuery = key != keys_.end() ? lasso_key_query_sign(key->second, query.c_str())
+                                           : nullptr;
+    if (!signedQuery) {
+      return false;
+    }
+    query = signedQuery;
+    g_free(signedQuery);
+  }
+
+  *url = tmpl.endpoint + query;
+  return true;
+}
+
+} // namespace lasso_js
@@ -0,0 +1,72 @@
+#ifndef LASSO_JS_AUTHN_TEMPLATE_H
+#define LASSO_JS_AUTHN_TEMPLATE_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+
+namespace lasso_js {
+
+/**
+ * AuthnRequestTemplate - A compiled HTTP-Redirect AuthnRequest for one IdP
+ *
+ * Holds the XML Lasso produced for the IdP, split around the only two
+ * per-request values (ID and IssueInstant), and the endpoint URL. Filling it
+ * in costs a string concatenation, DEFLATE, base64 and the query signature.
+ */
+struct AuthnRequestTemplate {
+  std::string endpoint;  // SSO URL up to the SAMLRequest parameter ('?' or '&' included)
+  std::string head;      // XML before the first variable value
+  std::string middle;    // XML between the two values
+  std::string tail;      // XML after the second value
+  bool idFirst;          // ID attribute precedes IssueInstant
+  bool sign;             // Lasso signed the query string
+  LassoSignatureMethod method;  // SigAlg Lasso signed it with
+};
+
+/**
+ * AuthnRequestTemplates - Per-server cache of compiled AuthnRequests
+ *
+ * Keyed by IdP entity ID (the Redirect binding is the only one cached, and
+ * initAuthnRequest() takes no other options). Compiled from the first
+ * request Lasso builds for an IdP. Used on the JS thread only.
+ */
+class AuthnRequestTemplates {
+ public:
+  explicit AuthnRequestTemplates(LassoServer* server);
+  ~AuthnRequestTemplates();
+
+  AuthnRequestTemplates(const AuthnRequestTemplates&) = delete;
+  AuthnRequestTemplates& operator=(const AuthnRequestTemplates&) = delete;
+
+  std::shared_ptr<const AuthnRequestTemplate> Find(const std::string& providerId) const;
+
+  // Compile from a profile whose Redirect AuthnRequest Lasso just built.
+  // Messages that don't split cleanly are simply not cached.
+  void Compile(const std::string& providerId, LassoProfile* profile);
+
+  // Fill in a fresh ID and IssueInstant, returns false if signing failed
+  bool Build(const AuthnRequestTemplate& tmpl, const char* relayState,
+             std::string* url, std::string* requestId);
+
+  // Drop every template (provider metadata changed)
+  void Clear() { templates_.clear(); }
+
+  size_t Size() const { return templates_.size(); }
+
+ private:
+  LassoServer* server_;
+  // Query signing keys per signature method, loaded on first use
+  std::unordered_map<int, LassoKey*> keys_;
+  std::unordered_map<std::string, std::shared_ptr<const AuthnRequestTemplate>> templates_;
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_AUTHN_TEMPLATE_H
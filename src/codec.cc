@@ -0,0 +1,645 @@
+#include "codec.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <zlib.h>
+
+namespace lasso_js {
+
+static const char kBase64Chars[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Decoding table markers (valid sextets are 0-63)
+static const uint8_t kB64Invalid = 0xFF;
+static const uint8_t kB64Skip = 0xFE;
+static const uint8_t kB64Pad = 0xFD;
+
+static const std::array<uint8_t, 256> kBase64Table = [] {
+  std::array<uint8_t, 256> table{};
+  table.fill(kB64Invalid);
+  for (uint8_t i = 0; i < 64; i++) {
+    table[static_cast<uint8_t>(kBase64Chars[i])] = i;
+  }
+  table['='] = kB64Pad;
+  table[' '] = kB64Skip;
+  table['\t'] = kB64Skip;
+  table['\r'] = kB64Skip;
+  table['\n'] = kB64Skip;
+  return table;
+}();
+
+std::string Base64Encode(const unsigned char* data, size_t len) {
+  std::string out;
+  out.resize((len + 2) / 3 * 4);
+  char* dst = &out[0];
+
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3) {
+    uint32_t v = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+    *dst++ = kBase64Chars[(v >> 18) & 0x3F];
+    *dst++ = kBase64Chars[(v >> 12) & 0x3F];
+    *dst++ = kBase64Chars[(v >> 6) & 0x3F];
+    *dst++ = kBase64Chars[v & 0x3F];
+  }
+
+  size_t rest = len - i;
+  if (rest > 0) {
+    uint32_t v = uint32_t(data[i]) << 16;
+    if (rest == 2) {
+      v |= uint32_t(data[i + 1]) << 8;
+    }
+    *dst++ = kBase64Chars[(v >> 18) & 0x3F];
+    *dst++ = kBase64Chars[(v >> 12) & 0x3F];
+    *dst++ = rest == 2 ? kBase64Chars[(v >> 6) & 0x3F] : '=';
+    *dst++ = '=';
+  }
+
+  return out;
+}
+
+DecodeStatus Base64Decode(const char* in, size_t len, std::string* out, size_t maxSize) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+
+  // Output never exceeds 3 bytes per 4 input characters
+  size_t capacity = std::min(len / 4 * 3 + 3, maxSize + 3);
+  out->resize(capacity);
+  uint8_t* dst = reinterpret_cast<uint8_t*>(&(*out)[0]);
+  size_t o = 0;
+
+  uint32_t quad = 0;
+  int n = 0;
+  int pad = 0;
+  size_t i = 0;
+
+  while (i < len) {
+    // Fast path: four significant characters in a row (the common case)
+    if (n == 0 && i + 4 <= len) {
+      uint32_t a = kBase64Table[p[i]];
+      uint32_t b = kBase64Table[p[i + 1]];
+      uint32_t c = kBase64Table[p[i + 2]];
+      uint32_t d = kBase64Table[p[i + 3]];
+      if (((a | b | c | d) & 0xC0) == 0) {
+        if (pad || o + 3 > capacity) {
+          return pad ? DecodeStatus::kInvalid : DecodeStatus::kTooLarge;
+        }
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        dst[o++] = static_cast<uint8_t>(v >> 16);
+        dst[o++] = static_cast<uint8_t>(v >> 8);
+        dst[o++] = static_cast<uint8_t>(v);
+        i += 4;
+        continue;
+      }
+    }
+
+    // Slow path: whitespace, padding and invalid characters
+    uint8_t v = kBase64Table[p[i++]];
+    if (v == kB64Skip) {
+      continue;
+    }
+    if (v == kB64Invalid) {
+      return DecodeStatus::kInvalid;
+    }
+    if (v == kB64Pad) {
+      // Padding may only complete the last quartet: "xx==" or "xxx="
+      if (n < 2) {
+        return DecodeStatus::kInvalid;
+      }
+      pad++;
+      v = 0;
+    } else if (pad) {
+      // Data after padding
+      return DecodeStatus::kInvalid;
+    }
+
+    quad = (quad << 6) | v;
+    if (++n == 4) {
+      int bytes = 3 - pad;
+      if (o + bytes > capacity) {
+        return DecodeStatus::kTooLarge;
+      }
+      dst[o++] = static_cast<uint8_t>(quad >> 16);
+      if (bytes > 1) {
+        dst[o++] = static_cast<uint8_t>(quad >> 8);
+      }
+      if (bytes > 2) {
+        dst[o++] = static_cast<uint8_t>(quad);
+      }
+      quad = 0;
+      n = 0;
+    }
+  }
+
+  if (n != 0) {
+    return DecodeStatus::kInvalid;
+  }
+
+  out->resize(o);
+  return o > maxSize ? DecodeStatus::kTooLarge : DecodeStatus::kOk;
+}
+
+bool RawDeflate(const std::string& in, std::string* out) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+
+  // Negative window bits: raw DEFLATE without zlib header, as SAML requires
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  out->resize(deflateBound(&zs, in.size()));
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+  zs.avail_out = static_cast<uInt>(out->size());
+
+  int rc = deflate(&zs, Z_FINISH);
+  out->resize(zs.total_out);
+  deflateEnd(&zs);
+
+  return rc == Z_STREAM_END;
+}
+
+DecodeStatus RawInflate(const std::string& in, std::string* out, size_t maxSize) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+
+  if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+    return DecodeStatus::kInvalid;
+  }
+
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+
+  if (out) {
+    out->clear();
+  }
+
+  // Inflate chunk by chunk so a decompression bomb is stopped at maxSize
+  // instead of after it has been fully materialized
+  unsigned char chunk[16384];
+  size_t total = 0;
+  int rc = Z_OK;
+
+  while (rc != Z_STREAM_END) {
+    zs.next_out = chunk;
+    zs.avail_out = sizeof(chunk);
+
+    rc = inflate(&zs, Z_NO_FLUSH);
+    if (rc != Z_OK && rc != Z_STREAM_END) {
+      inflateEnd(&zs);
+      return DecodeStatus::kInvalid;
+    }
+
+    size_t produced = sizeof(chunk) - zs.avail_out;
+    total += produced;
+    if (total > maxSize) {
+      inflateEnd(&zs);
+      return DecodeStatus::kTooLarge;
+    }
+    if (out) {
+      out->append(reinterpret_cast<char*>(chunk), produced);
+    }
+
+    // Truncated stream: no more input and no progress
+    if (rc == Z_OK && zs.avail_in == 0 && produced == 0) {
+      inflateEnd(&zs);
+      return DecodeStatus::kInvalid;
+    }
+  }
+
+  inflateEnd(&zs);
+  return DecodeStatus::kOk;
+}
+
+std::string UrlEncode(const std::string& in) {
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string out;
+  out.reserve(in.size() + in.size() / 4);
+
+  for (unsigned char c : in) {
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+        c == '-' || c == '_' || c == '.' || c == '~') {
+      out.push_back(static_cast<char>(c));
+    } else {
+      out.push_back('%');
+      out.push_back(kHex[c >> 4]);
+      out.push_back(kHex[c & 0x0F]);
+    }
+  }
+
+  return out;
+}
+
+static int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+std::string UrlDecode(const char* in, size_t len) {
+  std::string out;
+  out.reserve(len);
+
+  for (size_t i = 0; i < len; i++) {
+    char c = in[i];
+    if (c == '+') {
+      out.push_back(' ');
+    } else if (c == '%' && i + 2 < len && HexValue(in[i + 1]) >= 0 &&
+               HexValue(in[i + 2]) >= 0) {
+      out.push_back(static_cast<char>((HexValue(in[i + 1]) << 4) | HexValue(in[i + 2])));
+      i += 2;
+    } else {
+      out.push_back(c);
+    }
+  }
+
+  return out;
+}
+
+// Offset of the first query string parameter. A leading URL or '?' is
+// skipped only when it comes before any parameter: a '?' inside a value (an
+// unencoded RelayState) does not start the query.
+static size_t QueryStart(const std::string& query) {
+  size_t mark = query.find('?');
+  if (mark == std::string::npos) {
+    return 0;
+  }
+  size_t param = query.find_first_of("=&");
+  if (param != std::string::npos && param < mark) {
+    return 0;
+  }
+  return mark + 1;
+}
+
+// Locate a parameter's raw value as [*start, *end). Detection and extraction
+// both go through here, so a message is only classified as a Redirect query
+// if its SAML parameter can actually be read back.
+static bool FindQueryParam(const std::string& query, const char* name,
+                           size_t* start, size_t* end) {
+  size_t nameLen = strlen(name);
+  size_t pos = QueryStart(query);
+
+  while (pos <= query.size()) {
+    size_t next = query.find('&', pos);
+    if (next == std::string::npos) {
+      next = query.size();
+    }
+
+    if (next - pos > nameLen && query.compare(pos, nameLen, name) == 0 &&
+        query[pos + nameLen] == '=') {
+      *start = pos + nameLen + 1;
+      *end = next;
+      return true;
+    }
+
+    pos = next + 1;
+  }
+
+  return false;
+}
+
+bool GetQueryParam(const std::string& query, const char* name, std::string* value) {
+  size_t start = 0;
+  size_t end = 0;
+  if (!FindQueryParam(query, name, &start, &end)) {
+    return false;
+  }
+  *value = UrlDecode(query.data() + start, end - start);
+  return true;
+}
+
+// '?' and '&' are not base64 characters and a base64 body can't start with
+// a parameter name followed by '=', so a POST body never parses as a query
+static bool HasQueryParam(const std::string& message, const char* name) {
+  size_t start = 0;
+  size_t end = 0;
+  return FindQueryParam(message, name, &start, &end);
+}
+
+MessageEncoding DetectMessageEncoding(const std::string& message) {
+  size_t first = message.find_first_not_of(" \t\r\n");
+  if (first != std::string::npos && message[first] == '<') {
+    return MessageEncoding::kXml;
+  }
+  if (HasQueryParam(message, "SAMLRequest") || HasQueryParam(message, "SAMLResponse")) {
+    return MessageEncoding::kRedirect;
+  }
+  return MessageEncoding::kBase64;
+}
+
+// Decoded payload looks like XML (possibly with a UTF-8 BOM or leading whitespace)
+static bool LooksLikeXml(const unsigned char* data, size_t len) {
+  size_t i = 0;
+  if (len >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+    i = 3;
+  }
+  while (i < len && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) {
+    i++;
+  }
+  return i < len && data[i] == '<';
+}
+
+// Base64 payload that is itself raw DEFLATE (a bare SAMLRequest parameter value)
+static DecodeStatus InflateIfDeflated(std::string* decoded, std::string* xml, size_t maxSize) {
+  if (LooksLikeXml(reinterpret_cast<const unsigned char*>(decoded->data()), decoded->size())) {
+    if (xml) {
+      xml->swap(*decoded);
+    }
+    return DecodeStatus::kOk;
+  }
+  return RawInflate(*decoded, xml, maxSize);
+}
+
+/**
+ * Size guard for base64(deflate(xml)): the base64 text is decoded a block at
+ * a time straight into inflate, and the inflated output goes to a scratch
+ * chunk that is overwritten, so neither the compressed nor the inflated
+ * message is ever held in memory. Stops as soon as maxSize is passed.
+ */
+static DecodeStatus CheckInflatedSize(const char* in, size_t len, size_t maxSize) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+
+  if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+    return DecodeStatus::kInvalid;
+  }
+
+  unsigned char packed[12288];
+  unsigned char sink[16384];
+  size_t packedLen = 0;
+  size_t compressed = 0;
+  size_t total = 0;
+  bool ended = false;
+
+  // Inflate the decoded block, discarding the output
+  auto drain = [&]() -> DecodeStatus {
+    zs.next_in = packed;
+    zs.avail_in = static_cast<uInt>(packedLen);
+    packedLen = 0;
+
+    while (!ended) {
+      zs.next_out = sink;
+      zs.avail_out = sizeof(sink);
+
+      int rc = inflate(&zs, Z_NO_FLUSH);
+      if (rc == Z_STREAM_END) {
+        ended = true;
+      } else if (rc == Z_BUF_ERROR) {
+        break;  // Needs more input
+      } else if (rc != Z_OK) {
+        return DecodeStatus::kInvalid;
+      }
+
+      total += sizeof(sink) - zs.avail_out;
+      if (total > maxSize) {
+        return DecodeStatus::kTooLarge;
+      }
+      if (zs.avail_in == 0 && zs.avail_out != 0) {
+        break;
+      }
+    }
+    return DecodeStatus::kOk;
+  };
+
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(in);
+  uint32_t quad = 0;
+  int n = 0;
+  int pad = 0;
+  DecodeStatus status = DecodeStatus::kOk;
+
+  for (size_t i = 0; i < len && status == DecodeStatus::kOk; i++) {
+    uint8_t v = kBase64Table[p[i]];
+    if (v == kB64Skip) {
+      continue;
+    }
+    if (v == kB64Invalid || (v == kB64Pad && n < 2) || (v != kB64Pad && pad)) {
+      status = DecodeStatus::kInvalid;
+      break;
+    }
+    if (v == kB64Pad) {
+      pad++;
+      v = 0;
+    }
+
+    quad = (quad << 6) | v;
+    if (++n < 4) {
+      continue;
+    }
+
+    int bytes = 3 - pad;
+    packed[packedLen++] = static_cast<uint8_t>(quad >> 16);
+    if (bytes > 1) {
+      packed[packedLen++] = static_cast<uint8_t>(quad >> 8);
+    }
+    if (bytes > 2) {
+      packed[packedLen++] = static_cast<uint8_t>(quad);
+    }
+    compressed += bytes;
+    quad = 0;
+    n = 0;
+
+    if (compressed > maxSize) {
+      status = DecodeStatus::kTooLarge;
+    } else if (packedLen + 3 > sizeof(packed)) {
+      status = drain();
+    }
+  }
+
+  if (status == DecodeStatus::kOk && n != 0) {
+    status = DecodeStatus::kInvalid;
+  }
+  if (status == DecodeStatus::kOk && packedLen > 0) {
+    status = drain();
+  }
+  if (status == DecodeStatus::kOk && !ended) {
+    status = DecodeStatus::kInvalid;  // Truncated stream
+  }
+
+  inflateEnd(&zs);
+  return status;
+}
+
+DecodeStatus DecodeSamlMessage(const std::string& message, std::string* xml, size_t maxSize) {
+  switch (DetectMessageEncoding(message)) {
+    case MessageEncoding::kXml:
+      if (message.size() > maxSize) {
+        return DecodeStatus::kTooLarge;
+      }
+      if (xml) {
+        *xml = message;
+      }
+      return DecodeStatus::kOk;
+
+    case MessageEncoding::kRedirect: {
+      std::string encoded;
+      if (!GetQueryParam(message, "SAMLRequest", &encoded) &&
+          !GetQueryParam(message, "SAMLResponse", &encoded)) {
+        return DecodeStatus::kInvalid;
+      }
+      if (!xml) {
+        return CheckInflatedSize(encoded.data(), encoded.size(), maxSize);
+      }
+      std::string deflated;
+      DecodeStatus status = Base64Decode(encoded.data(), encoded.size(), &deflated, maxSize);
+      if (status != DecodeStatus::kOk) {
+        return status;
+      }
+      return RawInflate(deflated, xml, maxSize);
+    }
+
+    case MessageEncoding::kBase64: {
+      // O(1) rejection from the encoded length
+      if (message.size() / 4 * 3 > maxSize + maxSize / 8 + 3) {
+        return DecodeStatus::kTooLarge;
+      }
+
+      if (!xml) {
+        // Peek at the first quartet: plain base64 XML needs no further work
+        std::string head;
+        size_t first = message.find_first_not_of(" \t\r\n");
+        if (first != std::string::npos && first + 4 <= message.size() &&
+            Base64Decode(message.data() + first, 4, &head, 3) == DecodeStatus::kOk &&
+            LooksLikeXml(reinterpret_cast<const unsigned char*>(head.data()), head.size())) {
+          return message.size() / 4 * 3 > maxSize + 3 ? DecodeStatus::kTooLarge : DecodeStatus::kOk;
+        }
+
+        // A bare deflated SAMLRequest value; anything else is left to Lasso
+        // once the encoded length is within the cap
+        DecodeStatus status = CheckInflatedSize(message.data(), message.size(), maxSize);
+        if (status == DecodeStatus::kInvalid && message.size() / 4 * 3 > maxSize + 3) {
+          return DecodeStatus::kTooLarge;
+        }
+        return status;
+      }
+
+      std::string decoded;
+      DecodeStatus status = Base64Decode(message.data(), message.size(), &decoded, maxSize);
+      if (status != DecodeStatus::kOk) {
+        return status;
+      }
+      return InflateIfDeflated(&decoded, xml, maxSize);
+    }
+  }
+
+  return DecodeStatus::kInvalid;
+}
+
+bool EncodeSamlMessage(const std::string& xml, MessageEncoding encoding, std::string* out) {
+  switch (encoding) {
+    case MessageEncoding::kXml:
+      *out = xml;
+      return true;
+
+    case MessageEncoding::kBase64:
+      *out = Base64Encode(reinterpret_cast<const unsigned char*>(xml.data()), xml.size());
+      return true;
+
+    case MessageEncoding::kRedirect: {
+      std::string deflated;
+      if (!RawDeflate(xml, &deflated)) {
+        return false;
+      }
+      *out = UrlEncode(Base64Encode(
+        reinterpret_cast<const unsigned char*>(deflated.data()), deflated.size()));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int MessageSizeError(const std::string& message) {
+  switch (DecodeSamlMessage(message, nullptr)) {
+    case DecodeStatus::kOk:
+      return 0;
+    case DecodeStatus::kTooLarge:
+      return LASSO_JS_ERROR_MESSAGE_TOO_LARGE;
+    case DecodeStatus::kInvalid:
+      break;
+  }
+
+  // Lasso inflates Redirect payloads without a bound, so one whose size
+  // could not be established must not reach it. Other malformed encodings
+  // are left to Lasso, which reports them precisely.
+  if (DetectMessageEncoding(message) == MessageEncoding::kRedirect) {
+    return LASSO_JS_ERROR_MALFORMED_MESSAGE;
+  }
+  return 0;
+}
+
+/**
+ * Decode an inbound SAML message (POST, Redirect query string or raw XML)
+ * @param message - The encoded message
+ * @param maxSize - Maximum decoded size in bytes (optional)
+ * @returns {string} The message XML
+ */
+Napi::Value DecodeMessage(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+
+  size_t maxSize = MAX_MESSAGE_SIZE;
+  if (info.Length() > 1 && info[1].IsNumber()) {
+    int64_t n = info[1].As<Napi::Number>().Int64Value();
+    if (n <= 0) {
+      throw Napi::RangeError::New(env, "maxSize must be a positive number");
+    }
+    maxSize = static_cast<size_t>(n);
+  }
+
+  std::string xml;
+  switch (DecodeSamlMessage(message, &xml, maxSize)) {
+    case DecodeStatus::kOk:
+      return Napi::String::New(env, xml);
+    case DecodeStatus::kTooLarge:
+      throw Napi::Error::New(env, "Message too large");
+    case DecodeStatus::kInvalid:
+      break;
+  }
+
+  throw Napi::Error::New(env, "Invalid SAML message encoding");
+}
+
+/**
+ * Encode a SAML message for an HTTP binding
+ * @param xml - The message XML
+ * @param method - HttpMethod.POST (base64) or HttpMethod.REDIRECT
+ *                 (URL-encoded base64 of raw DEFLATE, ready for the query string)
+ * @returns {string} The encoded message
+ */
+Napi::Value EncodeMessage(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected xml string as first argument");
+  }
+
+  std::string xml = info[0].As<Napi::String>().Utf8Value();
+
+  MessageEncoding encoding = MessageEncoding::kBase64;
+  if (info.Length() > 1 && info[1].IsNumber()) {
+    int method = info[1].As<Napi::Number>().Int32Value();
+    if (method == LASSO_HTTP_METHOD_REDIRECT) {
+      encoding = MessageEncoding::kRedirect;
+    } else if (method != LASSO_HTTP_METHOD_POST) {
+      throw Napi::TypeError::New(env, "method must be HttpMethod.POST or HttpMethod.REDIRECT");
+    }
+  }
+
+  std::string encoded;
+  if (!EncodeSamlMessage(xml, encoding, &encoded)) {
+    throw Napi::Error::New(env, "Failed to encode message");
+  }
+
+  return Napi::String::New(env, encoded);
+}
+
+} // namespace lasso_js
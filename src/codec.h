@@ -0,0 +1,68 @@
+#ifndef LASSO_JS_CODEC_H
+#define LASSO_JS_CODEC_H
+
+#include <napi.h>
+#include <cstddef>
+#include <string>
+
+namespace lasso_js {
+
+// Security: Maximum decoded size of an inbound SAML message to prevent DoS
+// (decompression bombs in the HTTP-Redirect binding, oversized POST bodies)
+static const size_t MAX_MESSAGE_SIZE = 4 * 1024 * 1024; // 4 MB
+
+// How a SAML message travels over HTTP
+enum class MessageEncoding {
+  kXml,       // Raw XML (SOAP, artifact resolution)
+  kBase64,    // HTTP-POST binding: base64(xml)
+  kRedirect,  // HTTP-Redirect binding: query string with urlencode(base64(deflate(xml)))
+};
+
+enum class DecodeStatus {
+  kOk,
+  kInvalid,
+  kTooLarge,
+};
+
+// Base64 (RFC 4648). Whitespace in the input is skipped.
+std::string Base64Encode(const unsigned char* data, size_t len);
+DecodeStatus Base64Decode(const char* in, size_t len, std::string* out, size_t maxSize);
+
+// Raw DEFLATE (RFC 1951) as used by the HTTP-Redirect binding
+bool RawDeflate(const std::string& in, std::string* out);
+DecodeStatus RawInflate(const std::string& in, std::string* out, size_t maxSize);
+
+// URL encoding of query string components
+std::string UrlEncode(const std::string& in);
+std::string UrlDecode(const char* in, size_t len);
+
+// Find a query string parameter, returns false if it is absent
+bool GetQueryParam(const std::string& query, const char* name, std::string* value);
+
+// Detect the binding encoding of an inbound message
+MessageEncoding DetectMessageEncoding(const std::string& message);
+
+/**
+ * Decode an inbound SAML message to XML, capped at maxSize decoded bytes.
+ * When xml is null only the size cap is enforced: POST messages are then
+ * checked in O(1) from their encoded length, and DEFLATE payloads are
+ * base64-decoded block by block into an inflate whose output is discarded,
+ * stopping at maxSize.
+ */
+DecodeStatus DecodeSamlMessage(const std::string& message, std::string* xml,
+                               size_t maxSize = MAX_MESSAGE_SIZE);
+
+// Encode XML for the given binding (POST: base64, Redirect: deflate + base64 + urlencode)
+bool EncodeSamlMessage(const std::string& xml, MessageEncoding encoding, std::string* out);
+
+// Error code for an inbound message: 0, LASSO_JS_ERROR_MESSAGE_TOO_LARGE, or
+// LASSO_JS_ERROR_MALFORMED_MESSAGE for a Redirect query that does not decode
+int MessageSizeError(const std::string& message);
+
+// JS bindings
+Napi::Value DecodeMessage(const Napi::CallbackInfo& info);
+Napi::Value EncodeMessage(const Napi::CallbackInfo& info);
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_CODEC_H
@@ -1,5 +1,6 @@
 #include "identity.h"
 #include "utils.h"
+#include "xml_memory.h"
 
 namespace lasso_js {
 
@@ -52,13 +53,31 @@ Napi::Object Identity::NewInstance(Napi::Env env, LassoIdentity* identity) {
   return obj;
 }
 
+Napi::Object Identity::NewShared(Napi::Env env, LassoIdentity* identity) {
+  Napi::Object obj = constructor.New({});
+  Identity* wrapper = Napi::ObjectWrap<Identity>::Unwrap(obj);
+
+  if (wrapper->identity_) {
+    lasso_identity_destroy(wrapper->identity_);
+  }
+  // lasso_identity_destroy() drops this reference when the wrapper goes away
+  wrapper->identity_ = LASSO_IDENTITY(g_object_ref(identity));
+  wrapper->owns_identity_ = true;
+
+  return obj;
+}
+
 Identity::Identity(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<Identity>(info), identity_(nullptr), owns_identity_(true) {
   // Create a new empty identity
   identity_ = lasso_identity_new();
+  TrackObject(NativeObject::kIdentity, 1);
+  SyncExternalMemory(info.Env());
 }
 
 Identity::~Identity() {
+  TrackObject(NativeObject::kIdentity, -1);
+
   // Only cleanup if lasso is still initialized
   if (identity_ && owns_identity_ && IsLassoInitialized()) {
     lasso_identity_destroy(identity_);
@@ -15,11 +15,14 @@ class Identity : public Napi::ObjectWrap<Identity> {
  public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports);
   static Napi::Object NewInstance(Napi::Env env, LassoIdentity* identity);
+  // Wrap a reference to identity instead of a copy (the object is shared)
+  static Napi::Object NewShared(Napi::Env env, LassoIdentity* identity);
 
   Identity(const Napi::CallbackInfo& info);
   ~Identity();
 
   LassoIdentity* GetIdentity() const { return identity_; }
+  static bool IsInstance(const Napi::Object& obj) { return obj.InstanceOf(constructor.Value()); }
 
  private:
   static Napi::FunctionReference constructor;
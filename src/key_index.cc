@@ -0,0 +1,185 @@
+#include "key_index.h"
+#include "codec.h"
+#include <cstring>
+
+namespace lasso_js {
+
+static const char* MD_NS = "urn:oasis:names:tc:SAML:2.0:metadata";
+static const char* DSIG_NS = "http://www.w3.org/2000/09/xmldsig#";
+
+// Certificates are a few KB; anything larger is not one
+static const size_t MAX_CERTIFICATE_SIZE = 64 * 1024;
+
+std::string CertificateFingerprint(const char* base64, size_t len) {
+  std::string der;
+  if (Base64Decode(base64, len, &der, MAX_CERTIFICATE_SIZE) != DecodeStatus::kOk ||
+      der.empty()) {
+    return std::string();
+  }
+
+  GChecksum* checksum = g_checksum_new(G_CHECKSUM_SHA256);
+  g_checksum_update(checksum, reinterpret_cast<const guchar*>(der.data()), der.size());
+  guint8 digest[32];
+  gsize digestLen = sizeof(digest);
+  g_checksum_get_digest(checksum, digest, &digestLen);
+  g_checksum_free(checksum);
+
+  return std::string(reinterpret_cast<const char*>(digest), digestLen);
+}
+
+static bool ElementIs(xmlNode* node, const char* ns, const char* name) {
+  return node->type == XML_ELEMENT_NODE && node->ns &&
+         strcmp(reinterpret_cast<const char*>(node->ns->href), ns) == 0 &&
+         strcmp(reinterpret_cast<const char*>(node->name), name) == 0;
+}
+
+static std::string Trimmed(xmlNode* node) {
+  xmlChar* content = xmlNodeGetContent(node);
+  if (!content) {
+    return std::string();
+  }
+  gchar* text = g_strstrip(g_strdup(reinterpret_cast<const char*>(content)));
+  std::string result = text;
+  g_free(text);
+  xmlFree(content);
+  return result;
+}
+
+// Add the certificates and key names below a KeyDescriptor
+static void CollectKeyInfo(xmlNode* node, std::vector<ProviderKey>* keys) {
+  for (; node; node = node->next) {
+    if (ElementIs(node, DSIG_NS, "X509Certificate")) {
+      xmlChar* content = xmlNodeGetContent(node);
+      if (content) {
+        ProviderKey key;
+        key.fingerprint = CertificateFingerprint(reinterpret_cast<const char*>(content),
+                                                 strlen(reinterpret_cast<const char*>(content)));
+        xmlFree(content);
+        if (!key.fingerprint.empty()) {
+          keys->push_back(std::move(key));
+        }
+      }
+    } else if (ElementIs(node, DSIG_NS, "KeyName")) {
+      ProviderKey key;
+      key.keyName = Trimmed(node);
+      if (!key.keyName.empty()) {
+        keys->push_back(std::move(key));
+      }
+    } else if (node->type == XML_ELEMENT_NODE) {
+      CollectKeyInfo(node->children, keys);
+    }
+  }
+}
+
+static void CollectSigningKeys(xmlNode* node, std::vector<ProviderKey>* keys) {
+  for (; node; node = node->next) {
+    if (node->type != XML_ELEMENT_NODE) {
+      continue;
+    }
+    if (ElementIs(node, MD_NS, "KeyDescriptor")) {
+      xmlChar* use = xmlGetNoNsProp(node, BAD_CAST "use");
+      bool signing = !use || xmlStrEqual(use, BAD_CAST "signing");
+      xmlFree(use);
+      if (signing) {
+        CollectKeyInfo(node->children, keys);
+      }
+      continue;
+    }
+    CollectSigningKeys(node->children, keys);
+  }
+}
+
+std::vector<ProviderKey> ParseSigningKeys(const char* metadata, size_t len,
+                                          std::string* entityId, DiscoveryInfo* discovery) {
+  std::vector<ProviderKey> keys;
+
+  xmlDoc* doc = xmlReadMemory(metadata, static_cast<int>(len), nullptr, nullptr,
+                              XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+  if (!doc) {
+    return keys;
+  }
+  xmlNode* root = xmlDocGetRootElement(doc);
+  if (entityId && root) {
+    xmlChar* id = xmlGetNoNsProp(root, BAD_CAST "entityID");
+    *entityId = id ? reinterpret_cast<const char*>(id) : "";
+    xmlFree(id);
+  }
+  CollectSigningKeys(root, &keys);
+  if (discovery) {
+    ParseDiscoveryInfo(root, discovery);
+  }
+  xmlFreeDoc(doc);
+
+  // The same certificate is often listed under several roles
+  std::vector<ProviderKey> unique;
+  for (ProviderKey& key : keys) {
+    bool seen = false;
+    for (const ProviderKey& other : unique) {
+      seen = seen || (key.fingerprint == other.fingerprint && key.keyName == other.keyName);
+    }
+    if (!seen) {
+      unique.push_back(std::move(key));
+    }
+  }
+  return unique;
+}
+
+void KeyIndex::Set(const std::string& providerId, std::vector<ProviderKey> keys) {
+  if (keys.empty()) {
+    entries_.erase(providerId);
+    return;
+  }
+  Entry& entry = entries_[providerId];
+  entry.keys = std::move(keys);
+  entry.last = 0;
+}
+
+const std::vector<ProviderKey>* KeyIndex::Find(const std::string& providerId) const {
+  auto it = entries_.find(providerId);
+  return it == entries_.end() ? nullptr : &it->second.keys;
+}
+
+KeyIndex::Match KeyIndex::Lookup(const std::string& providerId, const std::string& certificate,
+                                 const std::string& keyName) {
+  auto it = entries_.find(providerId);
+  if (it == entries_.end()) {
+    return kNotIndexed;
+  }
+  Entry& entry = it->second;
+
+  // Compare by certificate when both sides have one, else by key name
+  bool hasFingerprints = false;
+  bool hasKeyNames = false;
+  for (const ProviderKey& key : entry.keys) {
+    hasFingerprints = hasFingerprints || !key.fingerprint.empty();
+    hasKeyNames = hasKeyNames || !key.keyName.empty();
+  }
+
+  std::string fingerprint;
+  if (!certificate.empty() && hasFingerprints) {
+    fingerprint = CertificateFingerprint(certificate.data(), certificate.size());
+    if (fingerprint.empty()) {
+      return kUnknownKey;
+    }
+  } else if (keyName.empty() || !hasKeyNames) {
+    return kNotIndexed;  // No hint comparable with the metadata
+  }
+
+  auto matches = [&](const ProviderKey& key) {
+    return fingerprint.empty() ? key.keyName == keyName : key.fingerprint == fingerprint;
+  };
+
+  // During a rollover most traffic is signed with the same key
+  if (matches(entry.keys[entry.last])) {
+    return kMatched;
+  }
+  for (size_t i = 0; i < entry.keys.size(); i++) {
+    if (matches(entry.keys[i])) {
+      entry.last = i;
+      return kMatched;
+    }
+  }
+  return kUnknownKey;
+}
+
+} // namespace lasso_js
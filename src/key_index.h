@@ -0,0 +1,67 @@
+#ifndef LASSO_JS_KEY_INDEX_H
+#define LASSO_JS_KEY_INDEX_H
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+#include "provider_search.h"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lasso_js {
+
+// A signing key listed in provider metadata
+struct ProviderKey {
+  std::string fingerprint;  // SHA-256 of the DER certificate (raw bytes), may be empty
+  std::string keyName;      // ds:KeyName, may be empty
+};
+
+// SHA-256 of a base64 ds:X509Certificate, empty if it doesn't decode
+std::string CertificateFingerprint(const char* base64, size_t len);
+
+// Signing keys (KeyDescriptor without use, or use="signing") of a metadata
+// document, its entityID when entityId is not null and its discovery
+// information when discovery is not null. Safe to call off the JS thread.
+std::vector<ProviderKey> ParseSigningKeys(const char* metadata, size_t len,
+                                          std::string* entityId = nullptr,
+                                          DiscoveryInfo* discovery = nullptr);
+
+/**
+ * KeyIndex - Signing keys of each provider, by certificate digest and name
+ *
+ * Built when providers are loaded, so the KeyInfo hint of an inbound
+ * signature can be checked against the issuer's keys without touching
+ * Lasso. The key that matched last is compared first. Used on the JS
+ * thread only.
+ */
+class KeyIndex {
+ public:
+  enum Match {
+    kNotIndexed,  // No keys known for the provider, or no comparable hint
+    kMatched,
+    kUnknownKey,  // The hint names none of the provider's keys
+  };
+
+  void Set(const std::string& providerId, std::vector<ProviderKey> keys);
+  const std::vector<ProviderKey>* Find(const std::string& providerId) const;
+
+  // Look up a KeyInfo hint (base64 certificate and/or KeyName)
+  Match Lookup(const std::string& providerId, const std::string& certificate,
+               const std::string& keyName);
+
+ private:
+  struct Entry {
+    std::vector<ProviderKey> keys;
+    size_t last = 0;  // Index of the key that matched last
+  };
+
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_KEY_INDEX_H
@@ -10,11 +10,17 @@
 // Now include lasso - its extern "C" won't re-include the problematic headers
 #include <lasso/lasso.h>
 #include "utils.h"
+#include "codec.h"
+#include "xml_memory.h"
+#include "log_capture.h"
+#include "warmup.h"
 #include "server.h"
 #include "login.h"
 #include "logout.h"
 #include "identity.h"
 #include "session.h"
+#include "session_store.h"
+#include "name_id_generator.h"
 
 namespace lasso_js {
 
@@ -123,6 +129,14 @@ Napi::Object InitModule(Napi::Env env, Napi::Object exports) {
   exports.Set("shutdown", Napi::Function::New(env, Shutdown));
   exports.Set("checkVersion", Napi::Function::New(env, CheckVersion));
   exports.Set("isInitialized", Napi::Function::New(env, IsInitialized));
+  exports.Set("decodeMessage", Napi::Function::New(env, DecodeMessage));
+  exports.Set("encodeMessage", Napi::Function::New(env, EncodeMessage));
+  exports.Set("enableMemoryStats", Napi::Function::New(env, EnableMemoryStats));
+  exports.Set("memoryStats", Napi::Function::New(env, MemoryStats));
+  exports.Set("setLogCapture", Napi::Function::New(env, SetLogCapture));
+  exports.Set("drainLogs", Napi::Function::New(env, DrainLogs));
+  exports.Set("logStats", Napi::Function::New(env, LogStats));
+  exports.Set("warmup", Napi::Function::New(env, Warmup));
 
   // Classes
   Server::Init(env, exports);
@@ -130,6 +144,8 @@ Napi::Object InitModule(Napi::Env env, Napi::Object exports) {
   Logout::Init(env, exports);
   Identity::Init(env, exports);
   Session::Init(env, exports);
+  SessionStore::Init(env, exports);
+  NameIdGenerator::Init(env, exports);
 
   // Constants - HTTP methods
   Napi::Object httpMethod = Napi::Object::New(env);
@@ -160,6 +176,20 @@ Napi::Object InitModule(Napi::Env env, Napi::Object exports) {
   nameIdFormat.Set("KERBEROS", Napi::String::New(env, LASSO_SAML2_NAME_IDENTIFIER_FORMAT_KERBEROS));
   exports.Set("NameIdFormat", nameIdFormat);
 
+  // Constants - Binding error codes (returned by the try* methods)
+  Napi::Object errorCode = Napi::Object::New(env);
+  errorCode.Set("MESSAGE_TOO_LARGE", Napi::Number::New(env, LASSO_JS_ERROR_MESSAGE_TOO_LARGE));
+  errorCode.Set("UNSOLICITED_RESPONSE", Napi::Number::New(env, LASSO_JS_ERROR_UNSOLICITED_RESPONSE));
+  errorCode.Set("UNKNOWN_IN_RESPONSE_TO", Napi::Number::New(env, LASSO_JS_ERROR_UNKNOWN_IN_RESPONSE_TO));
+  errorCode.Set("UNKNOWN_ISSUER", Napi::Number::New(env, LASSO_JS_ERROR_UNKNOWN_ISSUER));
+  errorCode.Set("WRONG_DESTINATION", Napi::Number::New(env, LASSO_JS_ERROR_WRONG_DESTINATION));
+  errorCode.Set("STALE_ISSUE_INSTANT", Napi::Number::New(env, LASSO_JS_ERROR_STALE_ISSUE_INSTANT));
+  errorCode.Set("MALFORMED_MESSAGE", Napi::Number::New(env, LASSO_JS_ERROR_MALFORMED_MESSAGE));
+  errorCode.Set("MESSAGE_TOO_DEEP", Napi::Number::New(env, LASSO_JS_ERROR_MESSAGE_TOO_DEEP));
+  errorCode.Set("PARSER_LIMIT", Napi::Number::New(env, LASSO_JS_ERROR_PARSER_LIMIT));
+  errorCode.Set("UNKNOWN_SIGNING_KEY", Napi::Number::New(env, LASSO_JS_ERROR_UNKNOWN_SIGNING_KEY));
+  exports.Set("ErrorCode", errorCode);
+
   return exports;
 }
 
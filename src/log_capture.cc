@@ -0,0 +1,349 @@
+#include "log_capture.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+
+namespace lasso_js {
+
+static const size_t LOG_RING_CAPACITY = 1024;  // Must be a power of two
+static const size_t LOG_DOMAIN_SIZE = 32;
+static const size_t LOG_MESSAGE_SIZE = 480;
+static const size_t MAX_LOG_DOMAINS = 16;      // The last one collects the overflow
+static const uint32_t DEFAULT_RATE_LIMIT = 50;  // Records per domain per second
+
+struct LogRecord {
+  int64_t time;  // ms since the epoch
+  GLogLevelFlags level;
+  char domain[LOG_DOMAIN_SIZE];
+  char message[LOG_MESSAGE_SIZE];
+};
+
+/**
+ * LogRing - Bounded multi-producer multi-consumer queue of log records
+ *
+ * Each slot carries a sequence number telling producers and consumers whose
+ * turn it is, so pushes and pops only contend on one atomic index each and
+ * never block. A push into a full ring fails instead of waiting.
+ */
+class LogRing {
+ public:
+  LogRing() {
+    for (size_t i = 0; i < LOG_RING_CAPACITY; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Claim a slot and let fill() write the record in place
+  template <typename Fill>
+  bool Push(Fill fill) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos & (LOG_RING_CAPACITY - 1)];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          fill(&slot.record);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // Full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool Pop(LogRecord* out) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos & (LOG_RING_CAPACITY - 1)];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          *out = slot.record;
+          slot.sequence.store(pos + LOG_RING_CAPACITY, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t Size() const {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    LogRecord record;
+  };
+
+  // Separate cache lines so producers and the consumer don't false-share
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<size_t> head_{0};
+  Slot slots_[LOG_RING_CAPACITY];
+};
+
+// Per-domain rate limit window and counters
+struct LogDomain {
+  std::atomic<int> state{0};  // 0 free, 1 being claimed, 2 ready
+  char name[LOG_DOMAIN_SIZE];
+  std::atomic<int64_t> window{0};
+  std::atomic<uint32_t> inWindow{0};
+  std::atomic<uint64_t> captured{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> rateLimited{0};
+};
+
+static LogRing g_ring;
+static LogDomain g_domains[MAX_LOG_DOMAINS];
+
+static std::atomic<bool> g_capturing(false);
+static std::atomic<uint32_t> g_rate_limit(DEFAULT_RATE_LIMIT);
+static std::atomic<int> g_level_mask(0);
+static std::atomic<uint64_t> g_captured(0);
+static std::atomic<uint64_t> g_dropped(0);
+static std::atomic<uint64_t> g_rate_limited(0);
+static GLogFunc g_previous_handler = nullptr;
+
+static const int DEFAULT_LEVELS =
+  G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING | G_LOG_LEVEL_MESSAGE;
+static const int DEBUG_LEVELS = G_LOG_LEVEL_INFO | G_LOG_LEVEL_DEBUG;
+
+static void CopyTruncated(char* dst, size_t size, const char* src) {
+  size_t len = strnlen(src, size - 1);
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+// Find or claim the counters of a domain without taking a lock
+static LogDomain* FindDomain(const char* name) {
+  for (size_t i = 0; i < MAX_LOG_DOMAINS - 1; i++) {
+    LogDomain& domain = g_domains[i];
+    int state = domain.state.load(std::memory_order_acquire);
+
+    if (state == 0) {
+      int expected = 0;
+      if (domain.state.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+        CopyTruncated(domain.name, LOG_DOMAIN_SIZE, name);
+        domain.state.store(2, std::memory_order_release);
+        return &domain;
+      }
+      state = expected;
+    }
+    // Another thread is naming this slot; it may be ours
+    while (state == 1) {
+      state = domain.state.load(std::memory_order_acquire);
+    }
+    if (strncmp(domain.name, name, LOG_DOMAIN_SIZE - 1) == 0) {
+      return &domain;
+    }
+  }
+  return &g_domains[MAX_LOG_DOMAINS - 1];
+}
+
+static bool TakeRateToken(LogDomain* domain) {
+  uint32_t limit = g_rate_limit.load(std::memory_order_relaxed);
+  if (limit == 0) {
+    return true;
+  }
+
+  int64_t second = g_get_monotonic_time() / 1000000;
+  int64_t window = domain->window.load(std::memory_order_relaxed);
+  if (window != second &&
+      domain->window.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+    domain->inWindow.store(0, std::memory_order_relaxed);
+  }
+  return domain->inWindow.fetch_add(1, std::memory_order_relaxed) < limit;
+}
+
+static void CaptureLogHandler(const gchar* logDomain, GLogLevelFlags level,
+                              const gchar* message, gpointer /*data*/) {
+  // glib aborts after fatal records, so they must reach stderr now
+  if ((level & (G_LOG_FLAG_FATAL | G_LOG_LEVEL_ERROR)) || !g_capturing.load()) {
+    if (g_previous_handler) {
+      g_previous_handler(logDomain, level, message, nullptr);
+    }
+    return;
+  }
+  if (!(level & g_level_mask.load(std::memory_order_relaxed))) {
+    return;
+  }
+
+  LogDomain* domain = FindDomain(logDomain ? logDomain : "default");
+  if (!TakeRateToken(domain)) {
+    domain->rateLimited.fetch_add(1, std::memory_order_relaxed);
+    g_rate_limited.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  int64_t now = g_get_real_time() / 1000;
+  bool pushed = g_ring.Push([&](LogRecord* record) {
+    record->time = now;
+    record->level = static_cast<GLogLevelFlags>(level & G_LOG_LEVEL_MASK);
+    CopyTruncated(record->domain, LOG_DOMAIN_SIZE, logDomain ? logDomain : "default");
+    CopyTruncated(record->message, LOG_MESSAGE_SIZE, message ? message : "");
+  });
+
+  if (pushed) {
+    domain->captured.fetch_add(1, std::memory_order_relaxed);
+    g_captured.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    domain->dropped.fetch_add(1, std::memory_order_relaxed);
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static const char* LevelName(GLogLevelFlags level) {
+  if (level & G_LOG_LEVEL_CRITICAL) return "critical";
+  if (level & G_LOG_LEVEL_WARNING) return "warning";
+  if (level & G_LOG_LEVEL_MESSAGE) return "message";
+  if (level & G_LOG_LEVEL_INFO) return "info";
+  return "debug";
+}
+
+/**
+ * Capture Lasso and glib log output instead of writing it to stderr
+ * @param options - { rateLimit?: number (records per domain per second,
+ *                  0 = unlimited), debug?: boolean (include info and debug) }
+ *                  or null to restore the previous handler
+ */
+Napi::Value SetLogCapture(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() > 0 && info[0].IsNull()) {
+    if (g_capturing.exchange(false)) {
+      g_log_set_default_handler(g_previous_handler ? g_previous_handler : g_log_default_handler,
+                                nullptr);
+    }
+    return env.Undefined();
+  }
+
+  uint32_t rateLimit = DEFAULT_RATE_LIMIT;
+  int levels = DEFAULT_LEVELS;
+
+  if (info.Length() > 0 && !info[0].IsUndefined()) {
+    if (!info[0].IsObject()) {
+      throw Napi::TypeError::New(env, "options must be an object or null");
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+
+    Napi::Value value = options.Get("rateLimit");
+    if (value.IsNumber()) {
+      int64_t n = value.As<Napi::Number>().Int64Value();
+      if (n < 0) {
+        throw Napi::RangeError::New(env, "rateLimit must not be negative");
+      }
+      rateLimit = static_cast<uint32_t>(n);
+    }
+
+    value = options.Get("debug");
+    if (value.IsBoolean() && value.As<Napi::Boolean>().Value()) {
+      levels |= DEBUG_LEVELS;
+    }
+  }
+
+  g_rate_limit.store(rateLimit);
+  g_level_mask.store(levels);
+
+  if (!g_capturing.exchange(true)) {
+    GLogFunc previous = g_log_set_default_handler(CaptureLogHandler, nullptr);
+    if (previous != CaptureLogHandler) {
+      g_previous_handler = previous;
+    }
+  }
+
+  return env.Undefined();
+}
+
+/**
+ * Take captured log records out of the ring, oldest first
+ * @param max - Maximum number of records to return (default: all pending)
+ * @returns {Array<{ time: number, level: string, domain: string, message: string }>}
+ */
+Napi::Value DrainLogs(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  size_t max = LOG_RING_CAPACITY;
+  if (info.Length() > 0 && info[0].IsNumber()) {
+    int64_t n = info[0].As<Napi::Number>().Int64Value();
+    if (n <= 0) {
+      throw Napi::RangeError::New(env, "max must be a positive number");
+    }
+    max = static_cast<size_t>(n);
+  }
+
+  Napi::Array result = Napi::Array::New(env);
+  LogRecord record;
+  uint32_t count = 0;
+
+  while (count < max && g_ring.Pop(&record)) {
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("time", Napi::Number::New(env, static_cast<double>(record.time)));
+    entry.Set("level", Napi::String::New(env, LevelName(record.level)));
+    entry.Set("domain", Napi::String::New(env, record.domain));
+    entry.Set("message", Napi::String::New(env, record.message));
+    result.Set(count++, entry);
+  }
+
+  return result;
+}
+
+/**
+ * Log capture counters
+ * @returns {{ capturing: boolean, captured: number, dropped: number,
+ *             rateLimited: number, pending: number,
+ *             domains: Record<string, { captured: number, dropped: number, rateLimited: number }> }}
+ */
+Napi::Value LogStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("capturing", Napi::Boolean::New(env, g_capturing.load()));
+  result.Set("captured", Napi::Number::New(env, static_cast<double>(g_captured.load())));
+  result.Set("dropped", Napi::Number::New(env, static_cast<double>(g_dropped.load())));
+  result.Set("rateLimited", Napi::Number::New(env, static_cast<double>(g_rate_limited.load())));
+  result.Set("pending", Napi::Number::New(env, static_cast<double>(g_ring.Size())));
+
+  Napi::Object domains = Napi::Object::New(env);
+  for (size_t i = 0; i < MAX_LOG_DOMAINS; i++) {
+    LogDomain& domain = g_domains[i];
+    bool overflow = i == MAX_LOG_DOMAINS - 1;
+    if (!overflow && domain.state.load(std::memory_order_acquire) != 2) {
+      continue;
+    }
+    uint64_t captured = domain.captured.load();
+    uint64_t dropped = domain.dropped.load();
+    uint64_t rateLimited = domain.rateLimited.load();
+    if (overflow && captured + dropped + rateLimited == 0) {
+      continue;
+    }
+
+    Napi::Object counters = Napi::Object::New(env);
+    counters.Set("captured", Napi::Number::New(env, static_cast<double>(captured)));
+    counters.Set("dropped", Napi::Number::New(env, static_cast<double>(dropped)));
+    counters.Set("rateLimited", Napi::Number::New(env, static_cast<double>(rateLimited)));
+    domains.Set(overflow ? "other" : domain.name, counters);
+  }
+  result.Set("domains", domains);
+
+  return result;
+}
+
+} // namespace lasso_js
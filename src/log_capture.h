@@ -0,0 +1,25 @@
+#ifndef LASSO_JS_LOG_CAPTURE_H
+#define LASSO_JS_LOG_CAPTURE_H
+
+#include <napi.h>
+
+namespace lasso_js {
+
+/**
+ * Lasso and glib log capture
+ *
+ * When enabled, the g_log default handler formats records into a fixed-size
+ * lock-free ring instead of writing them to stderr. Each log domain is rate
+ * limited per second, records over the limit or arriving while the ring is
+ * full are counted and dropped, and JS drains the ring on its own schedule.
+ * Fatal records still go to the previous handler before glib aborts.
+ */
+
+// JS bindings
+Napi::Value SetLogCapture(const Napi::CallbackInfo& info);
+Napi::Value DrainLogs(const Napi::CallbackInfo& info);
+Napi::Value LogStats(const Napi::CallbackInfo& info);
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_LOG_CAPTURE_H
@@ -2,28 +2,43 @@
 #include "identity.h"
 #include "session.h"
 #include "utils.h"
+#include "xml_memory.h"
 
 namespace lasso_js {
 
+// Smallest Response, in bytes, processResponseMsgAsync() hands to a worker
+static const size_t ASYNC_RESPONSE_THRESHOLD = 16 * 1024;
+
 Napi::FunctionReference Login::constructor;
 
 Napi::Object Login::Init(Napi::Env env, Napi::Object exports) {
   Napi::Function func = DefineClass(env, "Login", {
+    // Static methods
+    StaticMethod("fromDump", &Login::FromDump),
+
     // IdP methods
     InstanceMethod("processAuthnRequestMsg", &Login::ProcessAuthnRequestMsg),
+    InstanceMethod("tryProcessAuthnRequestMsg", &Login::TryProcessAuthnRequestMsg),
     InstanceMethod("validateRequestMsg", &Login::ValidateRequestMsg),
     InstanceMethod("buildAssertion", &Login::BuildAssertion),
     InstanceMethod("buildResponseMsg", &Login::BuildResponseMsg),
+    InstanceMethod("buildArtifactMsg", &Login::BuildArtifactMsg),
+    InstanceMethod("processArtifactResolve", &Login::ProcessArtifactResolve),
 
     // SP methods
     InstanceMethod("initAuthnRequest", &Login::InitAuthnRequest),
     InstanceMethod("buildAuthnRequestMsg", &Login::BuildAuthnRequestMsg),
     InstanceMethod("processResponseMsg", &Login::ProcessResponseMsg),
+    InstanceMethod("tryProcessResponseMsg", &Login::TryProcessResponseMsg),
+    InstanceMethod("processResponseMsgAsync", &Login::ProcessResponseMsgAsync),
     InstanceMethod("acceptSso", &Login::AcceptSso),
+    InstanceMethod("initRequest", &Login::InitRequest),
+    InstanceMethod("buildRequestMsg", &Login::BuildRequestMsg),
 
     // Common methods
     InstanceMethod("setNameId", &Login::SetNameId),
     InstanceMethod("setAttributes", &Login::SetAttributes),
+    InstanceMethod("dump", &Login::Dump),
 
     // Getters/Setters
     InstanceAccessor("identity", &Login::GetIdentity, &Login::SetIdentity),
@@ -34,6 +49,8 @@ Napi::Object Login::Init(Napi::Env env, Napi::Object exports) {
     InstanceAccessor("relayState", &Login::GetRelayState, &Login::SetRelayState),
     InstanceAccessor("msgUrl", &Login::GetMsgUrl, nullptr),
     InstanceAccessor("msgBody", &Login::GetMsgBody, nullptr),
+    InstanceAccessor("requestId", &Login::GetRequestId, nullptr),
+    InstanceAccessor("inResponseTo", &Login::GetInResponseTo, nullptr),
   });
 
   constructor = Napi::Persistent(func);
@@ -44,7 +61,7 @@ Napi::Object Login::Init(Napi::Env env, Napi::Object exports) {
 }
 
 Login::Login(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<Login>(info), login_(nullptr) {
+    : Napi::ObjectWrap<Login>(info), login_(nullptr), server_(nullptr) {
   Napi::Env env = info.Env();
 
   if (info.Length() < 1) {
@@ -59,6 +76,7 @@ Login::Login(const Napi::CallbackInfo& info)
   }
 
   // Keep reference to server to prevent GC
+  server_ = server;
   server_ref_ = Napi::Persistent(serverObj);
   // Prevent the reference destructor from throwing during V8 shutdown
   server_ref_.SuppressDestruct();
@@ -67,9 +85,15 @@ Login::Login(const Napi::CallbackInfo& info)
   if (!login_) {
     throw Napi::Error::New(env, "Failed to create Lasso login");
   }
+
+  // A new profile per message: report what the previous ones left behind
+  TrackObject(NativeObject::kLogin, 1);
+  SyncExternalMemory(env);
 }
 
 Login::~Login() {
+  TrackObject(NativeObject::kLogin, -1);
+
   // Only cleanup if lasso is still initialized
   // During V8 shutdown, lasso may already be shut down
   if (login_ && IsLassoInitialized()) {
@@ -82,8 +106,55 @@ Login::~Login() {
   // The Napi::Reference destructor handles cleanup safely.
 }
 
+// ID of the request held by the profile (AuthnRequest on the SP side)
+static const char* ProfileRequestId(LassoProfile* profile) {
+  if (!profile->request || !LASSO_IS_SAMLP2_REQUEST_ABSTRACT(profile->request)) {
+    return nullptr;
+  }
+  return LASSO_SAMLP2_REQUEST_ABSTRACT(profile->request)->ID;
+}
+
+// InResponseTo of the response held by the profile
+static const char* ProfileInResponseTo(LassoProfile* profile) {
+  if (!profile->response || !LASSO_IS_SAMLP2_STATUS_RESPONSE(profile->response)) {
+    return nullptr;
+  }
+  return LASSO_SAMLP2_STATUS_RESPONSE(profile->response)->InResponseTo;
+}
+
+// Read an optional HTTP-Artifact binding argument (ARTIFACT_GET by default)
+static LassoHttpMethod ArtifactMethodArg(const Napi::CallbackInfo& info, size_t index) {
+  if (info.Length() <= index || !info[index].IsNumber()) {
+    return LASSO_HTTP_METHOD_ARTIFACT_GET;
+  }
+
+  int method = info[index].As<Napi::Number>().Int32Value();
+  if (method != LASSO_HTTP_METHOD_ARTIFACT_GET && method != LASSO_HTTP_METHOD_ARTIFACT_POST) {
+    throw Napi::TypeError::New(info.Env(),
+      "method must be HttpMethod.ARTIFACT_GET or HttpMethod.ARTIFACT_POST");
+  }
+  return static_cast<LassoHttpMethod>(method);
+}
+
+void Login::CheckIdle(Napi::Env env) const {
+  // The worker owns login_ until the promise settles
+  if (busy_) {
+    throw Napi::Error::New(env, "A response is already being processed");
+  }
+}
+
 // ===== IdP Methods =====
 
+// Process an AuthnRequest without throwing, returns 0 or an error code
+int Login::ProcessAuthnRequest(const std::string& message) {
+  int rc = server_->ScreenMessage(message);
+  if (rc != 0) {
+    return rc;
+  }
+
+  return lasso_login_process_authn_request_msg(login_, message.c_str());
+}
+
 /**
  * Process an incoming AuthnRequest (IdP)
  * @param message - The SAML AuthnRequest (base64 or URL-encoded)
@@ -91,29 +162,44 @@ Login::~Login() {
  */
 Napi::Value Login::ProcessAuthnRequestMsg(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   if (info.Length() < 1 || !info[0].IsString()) {
     throw Napi::TypeError::New(env, "Expected message string as first argument");
   }
 
   std::string message = info[0].As<Napi::String>().Utf8Value();
-  LassoHttpMethod method = LASSO_HTTP_METHOD_REDIRECT;
-
-  if (info.Length() > 1 && info[1].IsNumber()) {
-    method = static_cast<LassoHttpMethod>(info[1].As<Napi::Number>().Int32Value());
-  }
 
-  int rc = lasso_login_process_authn_request_msg(login_, message.c_str());
+  int rc = ProcessAuthnRequest(message);
   ThrowIfError(env, rc, "lasso_login_process_authn_request_msg");
 
   return env.Undefined();
 }
 
+/**
+ * Process an incoming AuthnRequest without throwing on rejection (IdP)
+ * @param message - The SAML AuthnRequest (base64 or URL-encoded)
+ * @returns {{ ok: boolean, code: number, category: string }} reused across calls
+ */
+Napi::Value Login::TryProcessAuthnRequestMsg(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+
+  return ResultObject(env, &result_, ProcessAuthnRequest(message));
+}
+
 /**
  * Validate the AuthnRequest (IdP)
  */
 Napi::Value Login::ValidateRequestMsg(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   int rc = lasso_login_validate_request_msg(
     login_,
@@ -132,6 +218,7 @@ Napi::Value Login::ValidateRequestMsg(const Napi::CallbackInfo& info) {
  */
 Napi::Value Login::BuildAssertion(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   std::string authMethod = LASSO_SAML2_AUTHN_CONTEXT_PASSWORD;
   if (info.Length() > 0 && info[0].IsString()) {
@@ -153,6 +240,9 @@ Napi::Value Login::BuildAssertion(const Napi::CallbackInfo& info) {
   );
   ThrowIfError(env, rc, "lasso_login_build_assertion");
 
+  // Attributes set before the assertion existed
+  ThrowIfError(env, AddPendingAttributes(), "setAttributes");
+
   return env.Undefined();
 }
 
@@ -162,6 +252,7 @@ Napi::Value Login::BuildAssertion(const Napi::CallbackInfo& info) {
  */
 Napi::Value Login::BuildResponseMsg(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   int rc = lasso_login_build_response_msg(login_, nullptr);
   ThrowIfError(env, rc, "lasso_login_build_response_msg");
@@ -184,6 +275,106 @@ Napi::Value Login::BuildResponseMsg(const Napi::CallbackInfo& info) {
   return result;
 }
 
+/**
+ * Build the Response for the HTTP-Artifact binding (IdP)
+ * The Response stays in the server's artifact store until the SP resolves
+ * the artifact over SOAP; only the artifact travels through the browser.
+ * @param method - HttpMethod.ARTIFACT_GET (default) or HttpMethod.ARTIFACT_POST
+ * @returns {{ responseUrl?: string, responseBody?: string, httpMethod: number, artifact: string }}
+ */
+Napi::Value Login::BuildArtifactMsg(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  LassoHttpMethod method = ArtifactMethodArg(info, 0);
+
+  int rc = lasso_login_build_artifact_msg(login_, method);
+  ThrowIfError(env, rc, "lasso_login_build_artifact_msg");
+
+  LassoProfile* profile = LASSO_PROFILE(login_);
+  gchar* artifact = lasso_login_get_artifact(login_);
+  gchar* message = lasso_login_get_artifact_message(login_);
+  if (!artifact || !message) {
+    g_free(artifact);
+    g_free(message);
+    throw Napi::Error::New(env, "Failed to build artifact");
+  }
+
+  if (!server_->GetArtifactStore()->Put(artifact,
+        ArtifactEntry{GCharToString(profile->remote_providerID), message})) {
+    g_free(artifact);
+    g_free(message);
+    throw LassoError(env, LASSO_JS_ERROR_STORE_FULL);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  if (profile->msg_url) {
+    result.Set("responseUrl", Napi::String::New(env, profile->msg_url));
+  }
+  if (profile->msg_body) {
+    result.Set("responseBody", Napi::String::New(env, profile->msg_body));
+  }
+  result.Set("httpMethod", Napi::Number::New(env, method));
+  result.Set("artifact", Napi::String::New(env, artifact));
+
+  if (profile->msg_relayState) {
+    result.Set("relayState", Napi::String::New(env, profile->msg_relayState));
+  }
+
+  g_free(artifact);
+  g_free(message);
+
+  return result;
+}
+
+/**
+ * Answer an ArtifactResolve SOAP request from the artifact store (IdP)
+ * @param message - The SOAP ArtifactResolve request body
+ * @returns {{ responseBody: string, resolved: boolean }}
+ */
+Napi::Value Login::ProcessArtifactResolve(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+  ThrowIfError(env, server_->ScreenMessage(message));
+
+  gchar* msg = g_strdup(message.c_str());
+  int rc = lasso_login_process_request_msg(login_, msg);
+  g_free(msg);
+  ThrowIfError(env, rc, "lasso_login_process_request_msg");
+
+  LassoProfile* profile = LASSO_PROFILE(login_);
+  bool resolved = false;
+
+  gchar* artifact = lasso_login_get_artifact(login_);
+  if (artifact) {
+    // Security: Artifacts are single use and only released to the SP they
+    // were issued to. A mismatching requester still burns the artifact.
+    ArtifactEntry entry;
+    if (server_->GetArtifactStore()->Take(artifact, &entry) &&
+        entry.providerId == GCharToString(profile->remote_providerID)) {
+      lasso_login_set_artifact_message(login_, entry.message.c_str());
+      resolved = true;
+    }
+    g_free(artifact);
+  }
+
+  // Without a message Lasso answers with an empty ArtifactResponse
+  rc = lasso_login_build_response_msg(login_, nullptr);
+  ThrowIfError(env, rc, "lasso_login_build_response_msg");
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("responseBody", Napi::String::New(env, GCharToString(profile->msg_body)));
+  result.Set("resolved", Napi::Boolean::New(env, resolved));
+
+  return result;
+}
+
 // ===== SP Methods =====
 
 /**
@@ -193,6 +384,7 @@ Napi::Value Login::BuildResponseMsg(const Napi::CallbackInfo& info) {
  */
 Napi::Value Login::InitAuthnRequest(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   const char* providerId = nullptr;
   std::string providerIdStr;
@@ -206,25 +398,72 @@ Napi::Value Login::InitAuthnRequest(const Napi::CallbackInfo& info) {
     method = static_cast<LassoHttpMethod>(info[1].As<Napi::Number>().Int32Value());
   }
 
+  template_.reset();
+  template_request_id_.clear();
+  compile_template_for_.clear();
+
+  // Redirect requests to a named IdP can come from a compiled template
+  AuthnRequestTemplates* templates = server_->GetAuthnRequestTemplates();
+  if (templates && providerId && method == LASSO_HTTP_METHOD_REDIRECT) {
+    template_ = templates->Find(providerIdStr);
+    if (template_) {
+      LassoProfile* profile = LASSO_PROFILE(login_);
+      g_free(profile->remote_providerID);
+      profile->remote_providerID = g_strdup(providerId);
+      return env.Undefined();
+    }
+    compile_template_for_ = providerIdStr;
+  }
+
   int rc = lasso_login_init_authn_request(login_, providerId, method);
   ThrowIfError(env, rc, "lasso_login_init_authn_request");
 
   return env.Undefined();
 }
 
+// Fill in the compiled template chosen by initAuthnRequest()
+static int BuildFromTemplate(AuthnRequestTemplates* templates,
+                             const AuthnRequestTemplate& tmpl,
+                             LassoProfile* profile, std::string* requestId) {
+  std::string url;
+  if (!templates->Build(tmpl, profile->msg_relayState, &url, requestId)) {
+    return LASSO_PROFILE_ERROR_BUILDING_QUERY_FAILED;
+  }
+
+  g_free(profile->msg_url);
+  profile->msg_url = g_strdup(url.c_str());
+  g_free(profile->msg_body);
+  profile->msg_body = nullptr;
+  profile->http_request_method = LASSO_HTTP_METHOD_REDIRECT;
+  return 0;
+}
+
 /**
  * Build the AuthnRequest message (SP)
  * @returns {{ responseUrl: string, responseBody?: string, httpMethod: number }}
  */
 Napi::Value Login::BuildAuthnRequestMsg(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
-  int rc = lasso_login_build_authn_request_msg(login_);
-  ThrowIfError(env, rc, "lasso_login_build_authn_request_msg");
+  LassoProfile* profile = LASSO_PROFILE(login_);
+  AuthnRequestTemplates* templates = server_->GetAuthnRequestTemplates();
+
+  if (template_ && templates) {
+    int rc = BuildFromTemplate(templates, *template_, profile, &template_request_id_);
+    ThrowIfError(env, rc, "buildAuthnRequestMsg");
+  } else {
+    template_.reset();
+    int rc = lasso_login_build_authn_request_msg(login_);
+    ThrowIfError(env, rc, "lasso_login_build_authn_request_msg");
+
+    if (templates && !compile_template_for_.empty()) {
+      templates->Compile(compile_template_for_, profile);
+    }
+  }
 
   Napi::Object result = Napi::Object::New(env);
 
-  LassoProfile* profile = LASSO_PROFILE(login_);
   if (profile->msg_url) {
     result.Set("responseUrl", Napi::String::New(env, profile->msg_url));
   }
@@ -233,15 +472,74 @@ Napi::Value Login::BuildAuthnRequestMsg(const Napi::CallbackInfo& info) {
   }
   result.Set("httpMethod", Napi::Number::New(env, profile->http_request_method));
 
+  const char* requestId = template_ ? template_request_id_.c_str() : ProfileRequestId(profile);
+  if (requestId) {
+    result.Set("requestId", Napi::String::New(env, requestId));
+
+    // Remember the request so the response can be matched without a session.
+    // A full store forgets its oldest request: refusing new ones would let
+    // anyone hitting the login page lock every user out. The browser binding
+    // (the Express request cookie) keeps an evicted slot from being reused.
+    TtlMap<std::string>* store = server_->GetRequestStore();
+    if (store) {
+      store->PutEvicting(requestId, GCharToString(profile->msg_relayState));
+    }
+  }
+
   return result;
 }
 
+// Process a Response without throwing, returns 0 or an error code
+int Login::ProcessResponse(const std::string& message) {
+  int rc = server_->ScreenMessage(message);
+  if (rc != 0) {
+    return rc;
+  }
+
+  gchar* msg = g_strdup(message.c_str());
+  rc = lasso_login_process_response_msg(login_, msg);
+  g_free(msg);
+  if (rc != 0) {
+    return rc;
+  }
+
+  return CheckInResponseTo();
+}
+
+// Security: Match InResponseTo against the outstanding AuthnRequests.
+// Called after signature verification so forged responses can't burn IDs.
+int Login::CheckInResponseTo() {
+  TtlMap<std::string>* store = server_->GetRequestStore();
+  if (store) {
+    LassoProfile* profile = LASSO_PROFILE(login_);
+    const char* inResponseTo = ProfileInResponseTo(profile);
+
+    if (!inResponseTo || !*inResponseTo) {
+      if (!server_->AllowsUnsolicited()) {
+        return LASSO_JS_ERROR_UNSOLICITED_RESPONSE;
+      }
+    } else {
+      std::string relayState;
+      if (!store->Take(inResponseTo, &relayState)) {
+        return LASSO_JS_ERROR_UNKNOWN_IN_RESPONSE_TO;
+      }
+      // Restore the RelayState recorded with the request
+      if (!relayState.empty() && !profile->msg_relayState) {
+        profile->msg_relayState = g_strdup(relayState.c_str());
+      }
+    }
+  }
+
+  return 0;
+}
+
 /**
  * Process a SAML Response (SP)
  * @param message - The SAML Response
  */
 Napi::Value Login::ProcessResponseMsg(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   if (info.Length() < 1 || !info[0].IsString()) {
     throw Napi::TypeError::New(env, "Expected message string as first argument");
@@ -249,19 +547,146 @@ Napi::Value Login::ProcessResponseMsg(const Napi::CallbackInfo& info) {
 
   std::string message = info[0].As<Napi::String>().Utf8Value();
 
-  gchar* msg = g_strdup(message.c_str());
-  int rc = lasso_login_process_response_msg(login_, msg);
-  g_free(msg);
+  int rc = ProcessResponse(message);
   ThrowIfError(env, rc, "lasso_login_process_response_msg");
 
   return env.Undefined();
 }
 
+/**
+ * Process a SAML Response without throwing on rejection (SP)
+ * Rejections cost no exception, error message or stack trace, which keeps
+ * floods of forged responses cheap to turn away.
+ * @param message - The SAML Response
+ * @returns {{ ok: boolean, code: number, category: string }} reused across calls
+ */
+Napi::Value Login::TryProcessResponseMsg(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+
+  return ResultObject(env, &result_, ProcessResponse(message));
+}
+
+/**
+ * Runs the signature checks and assertion parsing of a Response on the
+ * libuv thread pool. The request store is only touched back on the main
+ * thread, in OnOK.
+ */
+class ProcessResponseWorker : public Napi::AsyncWorker {
+ public:
+  ProcessResponseWorker(Napi::Env env, Login* login, std::string message)
+      : Napi::AsyncWorker(env, "LassoProcessResponse"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        login_(login),
+        message_(std::move(message)),
+        rc_(0) {
+    // Keep the Login (and through it the Server) alive until settled
+    login_ref_ = Napi::Persistent(login->Value());
+    login_->busy_ = true;
+  }
+
+  Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    // Server writes on the JS thread wait until verification is done
+    std::shared_lock<std::shared_mutex> lock(login_->server_->GetLassoLock());
+    gchar* msg = g_strdup(message_.c_str());
+    rc_ = lasso_login_process_response_msg(login_->GetLogin(), msg);
+    g_free(msg);
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    login_->busy_ = false;
+
+    int rc = rc_ != 0 ? rc_ : login_->CheckInResponseTo();
+    if (rc != 0) {
+      deferred_.Reject(LassoError(env, rc, "lasso_login_process_response_msg").Value());
+      return;
+    }
+    deferred_.Resolve(env.Undefined());
+  }
+
+  void OnError(const Napi::Error& error) override {
+    login_->busy_ = false;
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  Napi::ObjectReference login_ref_;
+  Login* login_;
+  std::string message_;
+  int rc_;
+};
+
+/**
+ * Process a SAML Response off the main thread (SP)
+ * Responses carrying several signed assertions spend most of their time in
+ * signature verification; from threshold bytes on that runs on a worker so
+ * concurrent responses are verified in parallel. Smaller messages are
+ * processed inline. Until the promise settles every other method of the
+ * login throws, and changes to the server's providers or signature methods
+ * wait for the worker.
+ * @param message - The SAML Response
+ * @param options - { threshold?: number } smallest message, in bytes, sent
+ *                  to a worker (default 16 KB, 0 always offloads)
+ * @returns {Promise<void>}
+ */
+Napi::Value Login::ProcessResponseMsgAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  size_t threshold = ASYNC_RESPONSE_THRESHOLD;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Value value = info[1].As<Napi::Object>().Get("threshold");
+    if (!value.IsUndefined()) {
+      if (!value.IsNumber() || value.As<Napi::Number>().DoubleValue() < 0) {
+        throw Napi::RangeError::New(env, "threshold must be a non-negative number");
+      }
+      threshold = static_cast<size_t>(value.As<Napi::Number>().DoubleValue());
+    }
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+
+  // Junk is turned away by the pre-filter before it costs a thread hop
+  int rc = message.size() < threshold ? ProcessResponse(message)
+                                      : server_->ScreenMessage(message);
+  if (rc != 0 || message.size() < threshold) {
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    if (rc != 0) {
+      deferred.Reject(LassoError(env, rc, "lasso_login_process_response_msg").Value());
+    } else {
+      deferred.Resolve(env.Undefined());
+    }
+    return deferred.Promise();
+  }
+
+  ProcessResponseWorker* worker = new ProcessResponseWorker(env, this, std::move(message));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+
+  return promise;
+}
+
 /**
  * Accept the SSO (SP)
  */
 Napi::Value Login::AcceptSso(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   int rc = lasso_login_accept_sso(login_);
   ThrowIfError(env, rc, "lasso_login_accept_sso");
@@ -269,6 +694,56 @@ Napi::Value Login::AcceptSso(const Napi::CallbackInfo& info) {
   return env.Undefined();
 }
 
+/**
+ * Initialize an ArtifactResolve request (SP)
+ * @param message - Query string holding SAMLart (ARTIFACT_GET) or the SAMLart value (ARTIFACT_POST)
+ * @param method - HttpMethod.ARTIFACT_GET (default) or HttpMethod.ARTIFACT_POST
+ */
+Napi::Value Login::InitRequest(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected artifact string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+  LassoHttpMethod method = ArtifactMethodArg(info, 1);
+
+  gchar* msg = g_strdup(message.c_str());
+  int rc = lasso_login_init_request(login_, msg, method);
+  g_free(msg);
+  ThrowIfError(env, rc, "lasso_login_init_request");
+
+  return env.Undefined();
+}
+
+/**
+ * Build the ArtifactResolve SOAP request (SP)
+ * Send responseBody to responseUrl and pass the reply to processResponseMsg().
+ * @returns {{ responseUrl: string, responseBody: string, httpMethod: number }}
+ */
+Napi::Value Login::BuildRequestMsg(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  int rc = lasso_login_build_request_msg(login_);
+  ThrowIfError(env, rc, "lasso_login_build_request_msg");
+
+  Napi::Object result = Napi::Object::New(env);
+
+  LassoProfile* profile = LASSO_PROFILE(login_);
+  if (profile->msg_url) {
+    result.Set("responseUrl", Napi::String::New(env, profile->msg_url));
+  }
+  if (profile->msg_body) {
+    result.Set("responseBody", Napi::String::New(env, profile->msg_body));
+  }
+  result.Set("httpMethod", Napi::Number::New(env, LASSO_HTTP_METHOD_SOAP));
+
+  return result;
+}
+
 // ===== Common Methods =====
 
 /**
@@ -278,6 +753,7 @@ Napi::Value Login::AcceptSso(const Napi::CallbackInfo& info) {
  */
 Napi::Value Login::SetNameId(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   if (info.Length() < 1 || !info[0].IsString()) {
     throw Napi::TypeError::New(env, "Expected nameId string as first argument");
@@ -312,26 +788,161 @@ Napi::Value Login::SetNameId(const Napi::CallbackInfo& info) {
 
 /**
  * Set user attributes in the assertion (IdP)
+ * Added to the assertion right away if buildAssertion() already ran,
+ * otherwise when it does. The server's attribute release policy for the SP,
+ * if any, decides which attributes are included and how they are named.
  * @param attributes - Array of { name, nameFormat?, values: string[] }
  */
 Napi::Value Login::SetAttributes(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   if (info.Length() < 1 || !info[0].IsArray()) {
     throw Napi::TypeError::New(env, "Expected array of attributes");
   }
 
-  // Note: Setting attributes requires accessing the assertion directly
-  // This is a simplified implementation
-  // Full implementation would iterate through the attributes and add them
+  Napi::Array list = info[0].As<Napi::Array>();
+  std::vector<AttributeValues> attributes;
+  attributes.reserve(list.Length());
+
+  for (uint32_t i = 0; i < list.Length(); i++) {
+    Napi::Value item = list.Get(i);
+    if (!item.IsObject()) {
+      throw Napi::TypeError::New(env, "Attributes must be objects");
+    }
+    Napi::Object object = item.As<Napi::Object>();
+
+    AttributeValues attribute;
+    Napi::Value name = object.Get("name");
+    if (!name.IsString()) {
+      throw Napi::TypeError::New(env, "Attribute name must be a string");
+    }
+    attribute.name = name.As<Napi::String>().Utf8Value();
+
+    Napi::Value nameFormat = object.Get("nameFormat");
+    if (nameFormat.IsString()) {
+      attribute.nameFormat = nameFormat.As<Napi::String>().Utf8Value();
+    }
+
+    Napi::Value values = object.Get("values");
+    if (!values.IsArray()) {
+      throw Napi::TypeError::New(env, "Attribute values must be an array of strings");
+    }
+    Napi::Array array = values.As<Napi::Array>();
+    for (uint32_t j = 0; j < array.Length(); j++) {
+      Napi::Value value = array.Get(j);
+      if (!value.IsString()) {
+        throw Napi::TypeError::New(env, "Attribute values must be an array of strings");
+      }
+      attribute.values.push_back(value.As<Napi::String>().Utf8Value());
+    }
+
+    attributes.push_back(std::move(attribute));
+  }
+
+  pending_attributes_ = std::move(attributes);
+
+  LassoNode* assertion = lasso_login_get_assertion(login_);
+  if (assertion) {
+    g_object_unref(assertion);
+    ThrowIfError(env, AddPendingAttributes(), "setAttributes");
+  }
 
   return env.Undefined();
 }
 
+// Move the pending attributes into the assertion, returns 0 or an error code
+int Login::AddPendingAttributes() {
+  if (pending_attributes_.empty()) {
+    return 0;
+  }
+
+  LassoNode* node = lasso_login_get_assertion(login_);
+  if (!node || !LASSO_IS_SAML2_ASSERTION(node)) {
+    if (node) {
+      g_object_unref(node);
+    }
+    return LASSO_PROFILE_ERROR_MISSING_ASSERTION;
+  }
+
+  std::shared_ptr<const AttributeRelease> policy =
+    server_->GetAttributeRelease(LASSO_PROFILE(login_)->remote_providerID);
+  LassoSaml2AttributeStatement* statement =
+    BuildAttributeStatement(pending_attributes_, policy.get());
+  if (statement) {
+    LassoSaml2Assertion* assertion = LASSO_SAML2_ASSERTION(node);
+    assertion->AttributeStatement = g_list_append(assertion->AttributeStatement, statement);
+  }
+
+  g_object_unref(node);
+  pending_attributes_.clear();
+  return 0;
+}
+
+/**
+ * Serialize the profile state (parsed request, remote provider, relay state,
+ * NameID, assertion) so the login can be resumed in a later HTTP request
+ * without parsing and verifying the original message again. Identity and
+ * session are not included; set them again after fromDump().
+ * @returns {string} Dump to keep server-side (it is not signed)
+ */
+Napi::Value Login::Dump(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  // Security: The signature status is not part of the dump, a restored
+  // profile would look verified. An unsigned request is recorded as
+  // SIGNATURE_NOT_FOUND but was already accepted under the SP's signing
+  // policy, so only refuse signatures that failed verification.
+  gint signature_status = LASSO_PROFILE(login_)->signature_status;
+  if (signature_status != 0 && signature_status != LASSO_DS_ERROR_SIGNATURE_NOT_FOUND) {
+    throw LassoError(env, signature_status, "dump");
+  }
+
+  gchar* dump = lasso_login_dump(login_);
+  if (!dump) {
+    throw Napi::Error::New(env, "Failed to dump login");
+  }
+
+  Napi::String result = Napi::String::New(env, dump);
+  g_free(dump);
+
+  return result;
+}
+
+/**
+ * Restore a login saved with dump()
+ * @param server - Server the login was created with
+ * @param dump - Output of Login.dump()
+ * @returns {Login}
+ */
+Napi::Value Login::FromDump(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsString()) {
+    throw Napi::TypeError::New(env, "Expected Server and dump string");
+  }
+
+  Napi::Object obj = constructor.New({ info[0] });
+  Login* wrapper = Napi::ObjectWrap<Login>::Unwrap(obj);
+
+  std::string dump = info[1].As<Napi::String>().Utf8Value();
+  LassoLogin* login = lasso_login_new_from_dump(wrapper->server_->GetServer(), dump.c_str());
+  if (!login) {
+    throw Napi::Error::New(env, "Failed to restore Lasso login from dump");
+  }
+
+  g_object_unref(wrapper->login_);
+  wrapper->login_ = login;
+
+  return obj;
+}
+
 // ===== Getters/Setters =====
 
 Napi::Value Login::GetIdentity(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->identity) {
@@ -342,6 +953,7 @@ Napi::Value Login::GetIdentity(const Napi::CallbackInfo& info) {
 }
 
 void Login::SetIdentity(const Napi::CallbackInfo& info, const Napi::Value& value) {
+  CheckIdle(info.Env());
   if (value.IsNull() || value.IsUndefined()) {
     LassoProfile* profile = LASSO_PROFILE(login_);
     if (profile->identity) {
@@ -354,13 +966,15 @@ void Login::SetIdentity(const Napi::CallbackInfo& info, const Napi::Value& value
   Napi::Object identityObj = value.As<Napi::Object>();
   Identity* identity = Napi::ObjectWrap<Identity>::Unwrap(identityObj);
   if (identity && identity->GetIdentity()) {
-    lasso_profile_set_identity_from_dump(LASSO_PROFILE(login_),
-      lasso_identity_dump(identity->GetIdentity()));
+    gchar* dump = lasso_identity_dump(identity->GetIdentity());
+    lasso_profile_set_identity_from_dump(LASSO_PROFILE(login_), dump);
+    g_free(dump);
   }
 }
 
 Napi::Value Login::GetSession(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->session) {
@@ -371,6 +985,7 @@ Napi::Value Login::GetSession(const Napi::CallbackInfo& info) {
 }
 
 void Login::SetSession(const Napi::CallbackInfo& info, const Napi::Value& value) {
+  CheckIdle(info.Env());
   if (value.IsNull() || value.IsUndefined()) {
     LassoProfile* profile = LASSO_PROFILE(login_);
     if (profile->session) {
@@ -383,13 +998,15 @@ void Login::SetSession(const Napi::CallbackInfo& info, const Napi::Value& value)
   Napi::Object sessionObj = value.As<Napi::Object>();
   Session* session = Napi::ObjectWrap<Session>::Unwrap(sessionObj);
   if (session && session->GetSession()) {
-    lasso_profile_set_session_from_dump(LASSO_PROFILE(login_),
-      lasso_session_dump(session->GetSession()));
+    gchar* dump = lasso_session_dump(session->GetSession());
+    lasso_profile_set_session_from_dump(LASSO_PROFILE(login_), dump);
+    g_free(dump);
   }
 }
 
 Napi::Value Login::GetRemoteProviderId(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->remote_providerID) {
@@ -401,6 +1018,7 @@ Napi::Value Login::GetRemoteProviderId(const Napi::CallbackInfo& info) {
 
 Napi::Value Login::GetNameId(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->nameIdentifier) {
@@ -417,6 +1035,7 @@ Napi::Value Login::GetNameId(const Napi::CallbackInfo& info) {
 
 Napi::Value Login::GetNameIdFormat(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->nameIdentifier) {
@@ -433,6 +1052,7 @@ Napi::Value Login::GetNameIdFormat(const Napi::CallbackInfo& info) {
 
 Napi::Value Login::GetRelayState(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->msg_relayState) {
@@ -443,6 +1063,7 @@ Napi::Value Login::GetRelayState(const Napi::CallbackInfo& info) {
 }
 
 void Login::SetRelayState(const Napi::CallbackInfo& info, const Napi::Value& value) {
+  CheckIdle(info.Env());
   LassoProfile* profile = LASSO_PROFILE(login_);
 
   if (value.IsNull() || value.IsUndefined()) {
@@ -458,6 +1079,7 @@ void Login::SetRelayState(const Napi::CallbackInfo& info, const Napi::Value& val
 
 Napi::Value Login::GetMsgUrl(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->msg_url) {
@@ -469,6 +1091,7 @@ Napi::Value Login::GetMsgUrl(const Napi::CallbackInfo& info) {
 
 Napi::Value Login::GetMsgBody(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  CheckIdle(env);
 
   LassoProfile* profile = LASSO_PROFILE(login_);
   if (!profile->msg_body) {
@@ -478,4 +1101,31 @@ Napi::Value Login::GetMsgBody(const Napi::CallbackInfo& info) {
   return Napi::String::New(env, profile->msg_body);
 }
 
+Napi::Value Login::GetRequestId(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  const char* requestId = ProfileRequestId(LASSO_PROFILE(login_));
+  if (!requestId && !template_request_id_.empty()) {
+    requestId = template_request_id_.c_str();
+  }
+  if (!requestId) {
+    return env.Null();
+  }
+
+  return Napi::String::New(env, requestId);
+}
+
+Napi::Value Login::GetInResponseTo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CheckIdle(env);
+
+  const char* inResponseTo = ProfileInResponseTo(LASSO_PROFILE(login_));
+  if (!inResponseTo) {
+    return env.Null();
+  }
+
+  return Napi::String::New(env, inResponseTo);
+}
+
 } // namespace lasso_js
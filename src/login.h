@@ -14,25 +14,40 @@ class Login : public Napi::ObjectWrap<Login> {
   ~Login();
 
   LassoLogin* GetLogin() const { return login_; }
+  static bool IsInstance(const Napi::Object& obj) { return obj.InstanceOf(constructor.Value()); }
+
+  // Throws while processResponseMsgAsync() has the profile on a worker
+  void CheckIdle(Napi::Env env) const;
 
  private:
   static Napi::FunctionReference constructor;
 
+  // Static methods
+  static Napi::Value FromDump(const Napi::CallbackInfo& info);
+
   // IdP methods
   Napi::Value ProcessAuthnRequestMsg(const Napi::CallbackInfo& info);
+  Napi::Value TryProcessAuthnRequestMsg(const Napi::CallbackInfo& info);
   Napi::Value ValidateRequestMsg(const Napi::CallbackInfo& info);
   Napi::Value BuildAssertion(const Napi::CallbackInfo& info);
   Napi::Value BuildResponseMsg(const Napi::CallbackInfo& info);
+  Napi::Value BuildArtifactMsg(const Napi::CallbackInfo& info);
+  Napi::Value ProcessArtifactResolve(const Napi::CallbackInfo& info);
 
   // SP methods
   Napi::Value InitAuthnRequest(const Napi::CallbackInfo& info);
   Napi::Value BuildAuthnRequestMsg(const Napi::CallbackInfo& info);
   Napi::Value ProcessResponseMsg(const Napi::CallbackInfo& info);
+  Napi::Value TryProcessResponseMsg(const Napi::CallbackInfo& info);
+  Napi::Value ProcessResponseMsgAsync(const Napi::CallbackInfo& info);
   Napi::Value AcceptSso(const Napi::CallbackInfo& info);
+  Napi::Value InitRequest(const Napi::CallbackInfo& info);
+  Napi::Value BuildRequestMsg(const Napi::CallbackInfo& info);
 
   // Common methods
   Napi::Value SetNameId(const Napi::CallbackInfo& info);
   Napi::Value SetAttributes(const Napi::CallbackInfo& info);
+  Napi::Value Dump(const Napi::CallbackInfo& info);
 
   // Getters/Setters
   Napi::Value GetIdentity(const Napi::CallbackInfo& info);
@@ -46,9 +61,33 @@ class Login : public Napi::ObjectWrap<Login> {
   void SetRelayState(const Napi::CallbackInfo& info, const Napi::Value& value);
   Napi::Value GetMsgUrl(const Napi::CallbackInfo& info);
   Napi::Value GetMsgBody(const Napi::CallbackInfo& info);
+  Napi::Value GetRequestId(const Napi::CallbackInfo& info);
+  Napi::Value GetInResponseTo(const Napi::CallbackInfo& info);
+
+  // Non-throwing cores of the process methods (0 or an error code)
+  int ProcessAuthnRequest(const std::string& message);
+  int ProcessResponse(const std::string& message);
+  int CheckInResponseTo();
+  int AddPendingAttributes();
 
   LassoLogin* login_;
+  Server* server_;
   Napi::ObjectReference server_ref_;
+  Napi::ObjectReference result_;  // Reused by the try* methods
+
+  // AuthnRequest template filled in instead of calling Lasso, and the ID it
+  // was given; or the IdP to compile a template for once Lasso has built one
+  std::shared_ptr<const AuthnRequestTemplate> template_;
+  std::string template_request_id_;
+  std::string compile_template_for_;
+
+  // Attributes set before buildAssertion()
+  std::vector<AttributeValues> pending_attributes_;
+
+  // A Response is being processed on a worker thread
+  bool busy_ = false;
+
+  friend class ProcessResponseWorker;
 };
 
 } // namespace lasso_js
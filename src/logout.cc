@@ -2,6 +2,8 @@
 #include "identity.h"
 #include "session.h"
 #include "utils.h"
+#include "xml_memory.h"
+#include <vector>
 
 namespace lasso_js {
 
@@ -13,11 +15,14 @@ Napi::Object Logout::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("initRequest", &Logout::InitRequest),
     InstanceMethod("buildRequestMsg", &Logout::BuildRequestMsg),
     InstanceMethod("processRequestMsg", &Logout::ProcessRequestMsg),
+    InstanceMethod("tryProcessRequestMsg", &Logout::TryProcessRequestMsg),
     InstanceMethod("validateRequest", &Logout::ValidateRequest),
     InstanceMethod("buildResponseMsg", &Logout::BuildResponseMsg),
     InstanceMethod("processResponseMsg", &Logout::ProcessResponseMsg),
+    InstanceMethod("tryProcessResponseMsg", &Logout::TryProcessResponseMsg),
     InstanceMethod("getNextProviderId", &Logout::GetNextProviderId),
     InstanceMethod("setNameId", &Logout::SetNameId),
+    InstanceMethod("buildSoapRequestsAsync", &Logout::BuildSoapRequestsAsync),
 
     // Getters/Setters
     InstanceAccessor("identity", &Logout::GetIdentity, &Logout::SetIdentity),
@@ -33,8 +38,21 @@ Napi::Object Logout::Init(Napi::Env env, Napi::Object exports) {
   return exports;
 }
 
+Napi::Object Logout::NewInstance(Napi::Env env, Napi::Object server, LassoLogout* logout) {
+  Napi::Object obj = constructor.New({server});
+  Logout* wrapper = Napi::ObjectWrap<Logout>::Unwrap(obj);
+
+  // Replace the logout created by the constructor (takes ownership)
+  if (wrapper->logout_) {
+    g_object_unref(wrapper->logout_);
+  }
+  wrapper->logout_ = logout;
+
+  return obj;
+}
+
 Logout::Logout(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<Logout>(info), logout_(nullptr) {
+    : Napi::ObjectWrap<Logout>(info), logout_(nullptr), server_(nullptr) {
   Napi::Env env = info.Env();
 
   if (info.Length() < 1) {
@@ -47,6 +65,7 @@ Logout::Logout(const Napi::CallbackInfo& info)
     throw Napi::TypeError::New(env, "Invalid Server object");
   }
 
+  server_ = server;
   server_ref_ = Napi::Persistent(serverObj);
   // Prevent the reference destructor from throwing during V8 shutdown
   server_ref_.SuppressDestruct();
@@ -55,9 +74,15 @@ Logout::Logout(const Napi::CallbackInfo& info)
   if (!logout_) {
     throw Napi::Error::New(env, "Failed to create Lasso logout");
   }
+
+  // A new profile per message: report what the previous ones left behind
+  TrackObject(NativeObject::kLogout, 1);
+  SyncExternalMemory(env);
 }
 
 Logout::~Logout() {
+  TrackObject(NativeObject::kLogout, -1);
+
   // Only cleanup if lasso is still initialized
   // During V8 shutdown, lasso may already be shut down
   if (logout_ && IsLassoInitialized()) {
@@ -119,6 +144,19 @@ Napi::Value Logout::BuildRequestMsg(const Napi::CallbackInfo& info) {
   return result;
 }
 
+// Process a LogoutRequest without throwing, returns 0 or an error code
+int Logout::ProcessRequest(const std::string& message) {
+  int rc = server_->ScreenMessage(message);
+  if (rc != 0) {
+    return rc;
+  }
+
+  gchar* msg = g_strdup(message.c_str());
+  rc = lasso_logout_process_request_msg(logout_, msg);
+  g_free(msg);
+  return rc;
+}
+
 /**
  * Process an incoming LogoutRequest
  * @param message - The SAML LogoutRequest
@@ -133,14 +171,29 @@ Napi::Value Logout::ProcessRequestMsg(const Napi::CallbackInfo& info) {
 
   std::string message = info[0].As<Napi::String>().Utf8Value();
 
-  gchar* msg = g_strdup(message.c_str());
-  int rc = lasso_logout_process_request_msg(logout_, msg);
-  g_free(msg);
+  int rc = ProcessRequest(message);
   ThrowIfError(env, rc, "lasso_logout_process_request_msg");
 
   return env.Undefined();
 }
 
+/**
+ * Process an incoming LogoutRequest without throwing on rejection
+ * @param message - The SAML LogoutRequest
+ * @returns {{ ok: boolean, code: number, category: string }} reused across calls
+ */
+Napi::Value Logout::TryProcessRequestMsg(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+
+  return ResultObject(env, &result_, ProcessRequest(message));
+}
+
 /**
  * Validate the logout request
  */
@@ -176,6 +229,19 @@ Napi::Value Logout::BuildResponseMsg(const Napi::CallbackInfo& info) {
   return result;
 }
 
+// Process a LogoutResponse without throwing, returns 0 or an error code
+int Logout::ProcessResponse(const std::string& message) {
+  int rc = server_->ScreenMessage(message);
+  if (rc != 0) {
+    return rc;
+  }
+
+  gchar* msg = g_strdup(message.c_str());
+  rc = lasso_logout_process_response_msg(logout_, msg);
+  g_free(msg);
+  return rc;
+}
+
 /**
  * Process an incoming LogoutResponse
  * @param message - The SAML LogoutResponse
@@ -189,14 +255,29 @@ Napi::Value Logout::ProcessResponseMsg(const Napi::CallbackInfo& info) {
 
   std::string message = info[0].As<Napi::String>().Utf8Value();
 
-  gchar* msg = g_strdup(message.c_str());
-  int rc = lasso_logout_process_response_msg(logout_, msg);
-  g_free(msg);
+  int rc = ProcessResponse(message);
   ThrowIfError(env, rc, "lasso_logout_process_response_msg");
 
   return env.Undefined();
 }
 
+/**
+ * Process an incoming LogoutResponse without throwing on rejection
+ * @param message - The SAML LogoutResponse
+ * @returns {{ ok: boolean, code: number, category: string }} reused across calls
+ */
+Napi::Value Logout::TryProcessResponseMsg(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected message string as first argument");
+  }
+
+  std::string message = info[0].As<Napi::String>().Utf8Value();
+
+  return ResultObject(env, &result_, ProcessResponse(message));
+}
+
 /**
  * Get the next provider to notify (for IdP-initiated SLO)
  * @returns Provider ID or null
@@ -241,8 +322,9 @@ void Logout::SetIdentity(const Napi::CallbackInfo& info, const Napi::Value& valu
   Napi::Object identityObj = value.As<Napi::Object>();
   Identity* identity = Napi::ObjectWrap<Identity>::Unwrap(identityObj);
   if (identity && identity->GetIdentity()) {
-    lasso_profile_set_identity_from_dump(LASSO_PROFILE(logout_),
-      lasso_identity_dump(identity->GetIdentity()));
+    gchar* dump = lasso_identity_dump(identity->GetIdentity());
+    lasso_profile_set_identity_from_dump(LASSO_PROFILE(logout_), dump);
+    g_free(dump);
   }
 }
 
@@ -270,8 +352,9 @@ void Logout::SetSession(const Napi::CallbackInfo& info, const Napi::Value& value
   Napi::Object sessionObj = value.As<Napi::Object>();
   Session* session = Napi::ObjectWrap<Session>::Unwrap(sessionObj);
   if (session && session->GetSession()) {
-    lasso_profile_set_session_from_dump(LASSO_PROFILE(logout_),
-      lasso_session_dump(session->GetSession()));
+    gchar* dump = lasso_session_dump(session->GetSession());
+    lasso_profile_set_session_from_dump(LASSO_PROFILE(logout_), dump);
+    g_free(dump);
   }
 }
 
@@ -340,4 +423,174 @@ Napi::Value Logout::SetNameId(const Napi::CallbackInfo& info) {
   return env.Undefined();
 }
 
+// ===== SOAP Single Logout =====
+
+/**
+ * Builds one SOAP LogoutRequest per session provider off the main thread.
+ * Requests are built one after another on a single worker holding the
+ * server's lock shared, so providers and signing keys can't change while
+ * they are looked up and signed with; the fan-out latency is dominated by
+ * the SOAP round trips, which the caller sends concurrently.
+ */
+class SoapLogoutWorker : public Napi::AsyncWorker {
+ public:
+  SoapLogoutWorker(Napi::Env env, Napi::Object serverObj, Server* server,
+                   std::vector<std::string> providerIds,
+                   std::string sessionDump, std::string identityDump)
+      : Napi::AsyncWorker(env, "LassoSoapLogout"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        server_(server),
+        session_dump_(std::move(sessionDump)),
+        identity_dump_(std::move(identityDump)) {
+    server_ref_ = Napi::Persistent(serverObj);
+    for (std::string& providerId : providerIds) {
+      items_.push_back(Item{std::move(providerId), nullptr, 0});
+    }
+  }
+
+  ~SoapLogoutWorker() {
+    // Logouts not handed over to JS (e.g. environment teardown)
+    for (Item& item : items_) {
+      if (item.logout && IsLassoInitialized()) {
+        g_object_unref(item.logout);
+      }
+    }
+  }
+
+  Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    std::shared_lock<std::shared_mutex> lock(server_->GetLassoLock());
+
+    for (Item& item : items_) {
+      LassoLogout* logout = lasso_logout_new(server_->GetServer());
+      if (!logout) {
+        item.rc = LASSO_PARAM_ERROR_BAD_TYPE_OR_NULL_OBJ;
+        continue;
+      }
+
+      LassoProfile* profile = LASSO_PROFILE(logout);
+      int rc = lasso_profile_set_session_from_dump(profile, session_dump_.c_str());
+      if (rc == 0 && !identity_dump_.empty()) {
+        rc = lasso_profile_set_identity_from_dump(profile, identity_dump_.c_str());
+      }
+      if (rc == 0) {
+        gchar* providerId = g_strdup(item.providerId.c_str());
+        rc = lasso_logout_init_request(logout, providerId, LASSO_HTTP_METHOD_SOAP);
+        g_free(providerId);
+      }
+      if (rc == 0) {
+        rc = lasso_logout_build_request_msg(logout);
+      }
+
+      if (rc != 0) {
+        g_object_unref(logout);
+        logout = nullptr;
+      }
+      item.logout = logout;
+      item.rc = rc;
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Napi::Array result = Napi::Array::New(env, items_.size());
+
+    for (size_t i = 0; i < items_.size(); i++) {
+      Item& item = items_[i];
+      Napi::Object entry = Napi::Object::New(env);
+      entry.Set("providerId", Napi::String::New(env, item.providerId));
+
+      if (item.logout) {
+        LassoProfile* profile = LASSO_PROFILE(item.logout);
+        entry.Set("responseUrl", Napi::String::New(env, GCharToString(profile->msg_url)));
+        entry.Set("responseBody", Napi::String::New(env, GCharToString(profile->msg_body)));
+        entry.Set("logout", Logout::NewInstance(env, server_ref_.Value(), item.logout));
+        item.logout = nullptr;
+      } else {
+        entry.Set("error", LassoError(env, item.rc, "lasso_logout_build_request_msg").Message());
+        entry.Set("code", Napi::Number::New(env, item.rc));
+      }
+
+      result.Set(static_cast<uint32_t>(i), entry);
+    }
+
+    deferred_.Resolve(result);
+  }
+
+  void OnError(const Napi::Error& error) override {
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  struct Item {
+    std::string providerId;
+    LassoLogout* logout;
+    int rc;
+  };
+
+  Napi::Promise::Deferred deferred_;
+  Napi::ObjectReference server_ref_;
+  Server* server_;  // Kept alive by server_ref_
+  std::string session_dump_;
+  std::string identity_dump_;
+  std::vector<Item> items_;
+};
+
+/**
+ * Build SOAP LogoutRequests for every other provider of the session (IdP)
+ * Each entry carries its own Logout to process the matching response with.
+ * @param options - { exclude?: string } provider to skip (defaults to the
+ *                  initiator of the processed LogoutRequest)
+ * @returns {Promise<Array<{ providerId, responseUrl?, responseBody?, logout?, error?, code? }>>}
+ */
+Napi::Value Logout::BuildSoapRequestsAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  LassoProfile* profile = LASSO_PROFILE(logout_);
+  if (!profile->session) {
+    throw Napi::Error::New(env, "No session set on logout");
+  }
+
+  std::string exclude = GCharToString(profile->remote_providerID);
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Value value = info[0].As<Napi::Object>().Get("exclude");
+    if (value.IsString()) {
+      exclude = value.As<Napi::String>().Utf8Value();
+    }
+  }
+
+  std::vector<std::string> providerIds;
+  for (gint i = 0;; i++) {
+    gchar* providerId = lasso_session_get_provider_index(profile->session, i);
+    if (!providerId) {
+      break;
+    }
+    if (exclude != providerId) {
+      providerIds.push_back(providerId);
+    }
+    g_free(providerId);
+  }
+
+  // Workers get their own copies: the profile may change while they run
+  gchar* dump = lasso_session_dump(profile->session);
+  std::string sessionDump = GCharToString(dump);
+  g_free(dump);
+
+  std::string identityDump;
+  if (profile->identity) {
+    dump = lasso_identity_dump(profile->identity);
+    identityDump = GCharToString(dump);
+    g_free(dump);
+  }
+
+  SoapLogoutWorker* worker = new SoapLogoutWorker(env, server_ref_.Value(), server_,
+    std::move(providerIds), std::move(sessionDump), std::move(identityDump));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+
+  return promise;
+}
+
 } // namespace lasso_js
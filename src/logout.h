@@ -10,10 +10,13 @@ class Logout : public Napi::ObjectWrap<Logout> {
  public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports);
 
+  static Napi::Object NewInstance(Napi::Env env, Napi::Object server, LassoLogout* logout);
+
   Logout(const Napi::CallbackInfo& info);
   ~Logout();
 
   LassoLogout* GetLogout() const { return logout_; }
+  static bool IsInstance(const Napi::Object& obj) { return obj.InstanceOf(constructor.Value()); }
 
  private:
   static Napi::FunctionReference constructor;
@@ -22,11 +25,14 @@ class Logout : public Napi::ObjectWrap<Logout> {
   Napi::Value InitRequest(const Napi::CallbackInfo& info);
   Napi::Value BuildRequestMsg(const Napi::CallbackInfo& info);
   Napi::Value ProcessRequestMsg(const Napi::CallbackInfo& info);
+  Napi::Value TryProcessRequestMsg(const Napi::CallbackInfo& info);
   Napi::Value ValidateRequest(const Napi::CallbackInfo& info);
   Napi::Value BuildResponseMsg(const Napi::CallbackInfo& info);
   Napi::Value ProcessResponseMsg(const Napi::CallbackInfo& info);
+  Napi::Value TryProcessResponseMsg(const Napi::CallbackInfo& info);
   Napi::Value GetNextProviderId(const Napi::CallbackInfo& info);
   Napi::Value SetNameId(const Napi::CallbackInfo& info);
+  Napi::Value BuildSoapRequestsAsync(const Napi::CallbackInfo& info);
 
   // Getters/Setters
   Napi::Value GetIdentity(const Napi::CallbackInfo& info);
@@ -36,8 +42,14 @@ class Logout : public Napi::ObjectWrap<Logout> {
   Napi::Value GetMsgUrl(const Napi::CallbackInfo& info);
   Napi::Value GetMsgBody(const Napi::CallbackInfo& info);
 
+  // Non-throwing cores of the process methods (0 or an error code)
+  int ProcessRequest(const std::string& message);
+  int ProcessResponse(const std::string& message);
+
   LassoLogout* logout_;
+  Server* server_;
   Napi::ObjectReference server_ref_;
+  Napi::ObjectReference result_;  // Reused by the try* methods
 };
 
 } // namespace lasso_js
@@ -0,0 +1,92 @@
+#ifndef LASSO_JS_MAPPED_FILE_H
+#define LASSO_JS_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lasso_js {
+
+/**
+ * MappedFile - Read-only memory map of a file, exposed as a C string
+ *
+ * Lasso wants NUL-terminated buffers. POSIX zero-fills the rest of the last
+ * page of a mapping, so unless the file size is an exact multiple of the page
+ * size the mapping already ends with a NUL and is used in place; otherwise
+ * the contents are copied once into an owned string.
+ */
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Map path, refusing files larger than maxSize. Sets error on failure.
+  bool Open(const std::string& path, size_t maxSize, std::string* error) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      *error = "Cannot open " + path;
+      return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+      close(fd);
+      *error = "Not a regular file: " + path;
+      return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0 || size > maxSize) {
+      close(fd);
+      *error = size == 0 ? "Empty file: " + path : "File too large: " + path;
+      return false;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps its own reference to the file
+    if (data == MAP_FAILED) {
+      *error = "Cannot map " + path;
+      return false;
+    }
+
+    data_ = data;
+    size_ = size;
+
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (size % page == 0) {
+      copy_.assign(static_cast<const char*>(data), size);
+    }
+    return true;
+  }
+
+  const char* CStr() const {
+    return copy_.empty() ? static_cast<const char*>(data_) : copy_.c_str();
+  }
+
+  size_t Size() const { return size_; }
+
+  void Close() {
+    if (data_) {
+      munmap(data_, size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+    copy_.clear();
+  }
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  std::string copy_;
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_MAPPED_FILE_H
@@ -0,0 +1,259 @@
+#include "name_id_generator.h"
+#include "codec.h"
+#include <chrono>
+
+namespace lasso_js {
+
+static const size_t MIN_SECRET_SIZE = 16;
+static const size_t MAX_SP_KEYS = 4096;
+static const size_t DEFAULT_INDEXED_NAME_IDS = 100000;
+static const int64_t DEFAULT_NAME_ID_TTL_MS = 30LL * 24 * 60 * 60 * 1000; // 30 days
+static const size_t SHA256_SIZE = 32;
+
+// Domain separation for the per-SP key derivation
+static const char SP_KEY_LABEL[] = "lasso.js persistent NameID";
+
+Napi::FunctionReference NameIdGenerator::constructor;
+
+Napi::Object NameIdGenerator::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "NameIdGenerator", {
+    // Instance methods
+    InstanceMethod("generate", &NameIdGenerator::Generate),
+    InstanceMethod("generateBatch", &NameIdGenerator::GenerateBatch),
+    InstanceMethod("resolve", &NameIdGenerator::Resolve),
+    InstanceMethod("forget", &NameIdGenerator::Forget),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("NameIdGenerator", func);
+  return exports;
+}
+
+/**
+ * Create a persistent NameID generator
+ * @param secret - HMAC secret (string or Buffer, at least 16 bytes)
+ * @param options - { maxEntries?: number, ttl?: number (ms) } for the reverse index
+ */
+NameIdGenerator::NameIdGenerator(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<NameIdGenerator>(info) {
+  Napi::Env env = info.Env();
+
+  // Security: the secret only lives in a SecureString
+  if (info.Length() > 0 && info[0].IsString()) {
+    secret_ = info[0].As<Napi::String>().Utf8Value();
+  } else if (info.Length() > 0 && info[0].IsBuffer()) {
+    Napi::Buffer<char> buf = info[0].As<Napi::Buffer<char>>();
+    secret_ = SecureString(buf.Data(), buf.Length());
+  } else {
+    throw Napi::TypeError::New(env, "secret must be a string or Buffer");
+  }
+
+  if (secret_.size() < MIN_SECRET_SIZE) {
+    throw Napi::RangeError::New(env, "secret must be at least 16 bytes");
+  }
+
+  size_t maxEntries = DEFAULT_INDEXED_NAME_IDS;
+  int64_t ttl = DEFAULT_NAME_ID_TTL_MS;
+
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    Napi::Value value = options.Get("maxEntries");
+    if (value.IsNumber()) {
+      int64_t n = value.As<Napi::Number>().Int64Value();
+      if (n <= 0) {
+        throw Napi::RangeError::New(env, "maxEntries must be a positive number");
+      }
+      maxEntries = static_cast<size_t>(n);
+    }
+
+    value = options.Get("ttl");
+    if (value.IsNumber()) {
+      ttl = value.As<Napi::Number>().Int64Value();
+      if (ttl <= 0) {
+        throw Napi::RangeError::New(env, "ttl must be a positive number");
+      }
+    }
+  }
+
+  reverse_ = std::make_unique<TtlMap<std::string>>(maxEntries, std::chrono::milliseconds(ttl));
+}
+
+NameIdGenerator::~NameIdGenerator() {
+  for (auto& item : sp_hmacs_) {
+    g_hmac_unref(item.second);
+  }
+}
+
+GHmac* NameIdGenerator::SpHmac(const std::string& spEntityId) {
+  auto it = sp_hmacs_.find(spEntityId);
+  if (it != sp_hmacs_.end()) {
+    return it->second;
+  }
+
+  // Bound the cache; the keys are cheap to derive again
+  if (sp_hmacs_.size() >= MAX_SP_KEYS) {
+    for (auto& item : sp_hmacs_) {
+      g_hmac_unref(item.second);
+    }
+    sp_hmacs_.clear();
+  }
+
+  GHmac* hmac = g_hmac_new(G_CHECKSUM_SHA256,
+                           reinterpret_cast<const guchar*>(secret_.c_str()), secret_.size());
+  // The label's NUL terminator separates it from the entity ID
+  g_hmac_update(hmac, reinterpret_cast<const guchar*>(SP_KEY_LABEL), sizeof(SP_KEY_LABEL));
+  g_hmac_update(hmac, reinterpret_cast<const guchar*>(spEntityId.data()), spEntityId.size());
+
+  guint8 key[SHA256_SIZE];
+  gsize keyLength = sizeof(key);
+  g_hmac_get_digest(hmac, key, &keyLength);
+  g_hmac_unref(hmac);
+
+  hmac = g_hmac_new(G_CHECKSUM_SHA256, key, keyLength);
+  // Security: The HMAC keeps its own copy of the per-SP key
+  SecureZero(key, sizeof(key));
+
+  sp_hmacs_.emplace(spEntityId, hmac);
+  return hmac;
+}
+
+std::string NameIdGenerator::Derive(const std::string& userId, const std::string& spEntityId) {
+  // Copying the keyed state skips hashing the key pads again
+  GHmac* hmac = g_hmac_copy(SpHmac(spEntityId));
+  g_hmac_update(hmac, reinterpret_cast<const guchar*>(userId.data()), userId.size());
+
+  guint8 digest[SHA256_SIZE];
+  gsize digestLength = sizeof(digest);
+  g_hmac_get_digest(hmac, digest, &digestLength);
+  g_hmac_unref(hmac);
+
+  // Unpadded base64url (RFC 4648 section 5)
+  std::string nameId = Base64Encode(digest, digestLength);
+  while (!nameId.empty() && nameId.back() == '=') {
+    nameId.pop_back();
+  }
+  for (char& c : nameId) {
+    if (c == '+') {
+      c = '-';
+    } else if (c == '/') {
+      c = '_';
+    }
+  }
+  return nameId;
+}
+
+static std::string ReverseKey(const std::string& spEntityId, const std::string& nameId) {
+  std::string key;
+  key.reserve(spEntityId.size() + 1 + nameId.size());
+  key.append(spEntityId).push_back('\0');
+  key.append(nameId);
+  return key;
+}
+
+/**
+ * Persistent NameID of a user at an SP
+ * The NameID is recorded in the reverse index for resolve().
+ * @param userId - Local user identifier
+ * @param spEntityId - SP entity ID (e.g. login.remoteProviderId)
+ * @returns NameID
+ */
+Napi::Value NameIdGenerator::Generate(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    throw Napi::TypeError::New(env, "Expected userId and spEntityId strings");
+  }
+
+  std::string userId = info[0].As<Napi::String>().Utf8Value();
+  std::string spEntityId = info[1].As<Napi::String>().Utf8Value();
+
+  std::string nameId = Derive(userId, spEntityId);
+  reverse_->PutEvicting(ReverseKey(spEntityId, nameId), userId);
+
+  return Napi::String::New(env, nameId);
+}
+
+/**
+ * NameIDs of many (user, SP) pairs, e.g. to migrate stored pseudonyms
+ * Batch results are not added to the reverse index.
+ * @param pairs - Array of [userId, spEntityId]
+ * @returns Array of NameIDs, in order
+ */
+Napi::Value NameIdGenerator::GenerateBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    throw Napi::TypeError::New(env, "Expected an array of [userId, spEntityId] pairs");
+  }
+
+  Napi::Array pairs = info[0].As<Napi::Array>();
+  uint32_t length = pairs.Length();
+  Napi::Array result = Napi::Array::New(env, length);
+
+  for (uint32_t i = 0; i < length; i++) {
+    Napi::Value pair = pairs.Get(i);
+    if (!pair.IsArray()) {
+      throw Napi::TypeError::New(env, "Expected an array of [userId, spEntityId] pairs");
+    }
+
+    Napi::Array values = pair.As<Napi::Array>();
+    Napi::Value userId = values.Get(0u);
+    Napi::Value spEntityId = values.Get(1u);
+    if (!userId.IsString() || !spEntityId.IsString()) {
+      throw Napi::TypeError::New(env, "Expected an array of [userId, spEntityId] pairs");
+    }
+
+    std::string nameId = Derive(userId.As<Napi::String>().Utf8Value(),
+                                spEntityId.As<Napi::String>().Utf8Value());
+    result.Set(i, Napi::String::New(env, nameId));
+  }
+
+  return result;
+}
+
+/**
+ * User a NameID was generated for, e.g. from a LogoutRequest
+ * Only NameIDs returned by generate() within the index bounds are known.
+ * @param nameId - NameID value
+ * @param spEntityId - SP entity ID the NameID was issued to
+ * @returns User ID or null
+ */
+Napi::Value NameIdGenerator::Resolve(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    throw Napi::TypeError::New(env, "Expected nameId and spEntityId strings");
+  }
+
+  std::string nameId = info[0].As<Napi::String>().Utf8Value();
+  std::string spEntityId = info[1].As<Napi::String>().Utf8Value();
+
+  std::string userId;
+  if (!reverse_->Get(ReverseKey(spEntityId, nameId), &userId)) {
+    return env.Null();
+  }
+
+  return Napi::String::New(env, userId);
+}
+
+/**
+ * Drop a NameID from the reverse index (e.g. after a ManageNameID termination)
+ * @returns true if the NameID was indexed
+ */
+Napi::Value NameIdGenerator::Forget(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString()) {
+    throw Napi::TypeError::New(env, "Expected nameId and spEntityId strings");
+  }
+
+  std::string nameId = info[0].As<Napi::String>().Utf8Value();
+  std::string spEntityId = info[1].As<Napi::String>().Utf8Value();
+
+  return Napi::Boolean::New(env, reverse_->Take(ReverseKey(spEntityId, nameId)));
+}
+
+} // namespace lasso_js
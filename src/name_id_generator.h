@@ -0,0 +1,61 @@
+#ifndef LASSO_NAME_ID_GENERATOR_H
+#define LASSO_NAME_ID_GENERATOR_H
+
+#include <napi.h>
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "secure_string.h"
+#include "ttl_map.h"
+
+namespace lasso_js {
+
+/**
+ * NameIdGenerator - Stable pseudonymous persistent NameIDs (IdP)
+ *
+ * The NameID of a user at an SP is HMAC-SHA256(spKey, userId), encoded as
+ * unpadded base64url, where spKey = HMAC-SHA256(secret, SP entity ID). The
+ * same secret always yields the same NameID, so nothing needs to be stored,
+ * and NameIDs of one user at two SPs can't be linked without the secret.
+ *
+ * The keyed HMAC state of each SP is derived once and copied per NameID, so a
+ * login costs one HMAC over the user ID. NameIDs handed out are recorded in a
+ * bounded reverse index so the user of a LogoutRequest's NameID can be found.
+ */
+class NameIdGenerator : public Napi::ObjectWrap<NameIdGenerator> {
+ public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  NameIdGenerator(const Napi::CallbackInfo& info);
+  ~NameIdGenerator();
+
+ private:
+  static Napi::FunctionReference constructor;
+
+  // Methods
+  Napi::Value Generate(const Napi::CallbackInfo& info);
+  Napi::Value GenerateBatch(const Napi::CallbackInfo& info);
+  Napi::Value Resolve(const Napi::CallbackInfo& info);
+  Napi::Value Forget(const Napi::CallbackInfo& info);
+
+  // NameID of userId at spEntityId
+  std::string Derive(const std::string& userId, const std::string& spEntityId);
+
+  // HMAC state keyed for an SP, derived on first use
+  GHmac* SpHmac(const std::string& spEntityId);
+
+  SecureString secret_;
+  std::unordered_map<std::string, GHmac*> sp_hmacs_;
+  std::unique_ptr<TtlMap<std::string>> reverse_;  // SP + NameID -> user ID
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_NAME_ID_GENERATOR_H
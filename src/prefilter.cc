@@ -0,0 +1,256 @@
+#include "prefilter.h"
+#include "codec.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstring>
+#include <libxml/xmlreader.h>
+
+namespace lasso_js {
+
+static const char* SAMLP_NS = "urn:oasis:names:tc:SAML:2.0:protocol";
+static const char* SAML_NS = "urn:oasis:names:tc:SAML:2.0:assertion";
+static const char* DSIG_NS = "http://www.w3.org/2000/09/xmldsig#";
+
+PrefilterOptions DefaultPrefilterOptions() {
+  PrefilterOptions options;
+  options.knownIssuer = true;
+  options.maxAgeMs = 5 * 60 * 1000;     // 5 minutes
+  options.clockSkewMs = 3 * 60 * 1000;  // 3 minutes
+  options.maxDepth = 64;
+  options.knownKey = false;
+  return options;
+}
+
+ParserLimits DefaultParserLimits() {
+  ParserLimits limits;
+  limits.maxDepth = 64;
+  limits.maxNodes = 20000;
+  limits.maxAttributes = 64;
+  limits.maxTextSize = 1024 * 1024;  // 1 MB, room for embedded certificates
+  limits.maxNamespaces = 256;
+  return limits;
+}
+
+// Fields of the SAML message element gathered by the scan
+struct MessageHead {
+  bool found = false;
+  std::string destination;
+  std::string issueInstant;
+  std::string issuer;
+  bool wantKeyInfo = false;  // Also read the KeyInfo of the message's Signature
+  std::string certificate;   // First ds:X509Certificate in it (base64)
+  std::string keyName;       // First ds:KeyName in it
+};
+
+// Parse errors are reported through the return code, not stderr
+static void SilentReaderError(void*, const char*, xmlParserSeverities, xmlTextReaderLocatorPtr) {}
+
+static bool NamespaceIs(xmlTextReaderPtr reader, const char* ns) {
+  const xmlChar* uri = xmlTextReaderConstNamespaceUri(reader);
+  return uri && strcmp(reinterpret_cast<const char*>(uri), ns) == 0;
+}
+
+static std::string TakeXmlString(xmlChar* value) {
+  if (!value) {
+    return "";
+  }
+  std::string result(reinterpret_cast<const char*>(value));
+  xmlFree(value);
+  return result;
+}
+
+// Count the attributes and namespace declarations of the current element
+static int CheckAttributes(xmlTextReaderPtr reader, const ParserLimits& limits,
+                           size_t* namespaces) {
+  int count = xmlTextReaderAttributeCount(reader);
+  if (count <= 0) {
+    return 0;
+  }
+
+  size_t attributes = 0;
+  while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+    if (xmlTextReaderIsNamespaceDecl(reader) == 1) {
+      (*namespaces)++;
+    } else {
+      attributes++;
+    }
+  }
+  xmlTextReaderMoveToElement(reader);
+
+  if (limits.maxAttributes > 0 && attributes > limits.maxAttributes) {
+    return LASSO_JS_ERROR_PARSER_LIMIT;
+  }
+  if (limits.maxNamespaces > 0 && *namespaces > limits.maxNamespaces) {
+    return LASSO_JS_ERROR_PARSER_LIMIT;
+  }
+  return 0;
+}
+
+// Stream through the document. head may be null when only limits are checked.
+static int ScanMessage(const std::string& xml, size_t maxDepth,
+                       const ParserLimits* limits, MessageHead* head) {
+  xmlTextReaderPtr reader = xmlReaderForMemory(xml.data(), static_cast<int>(xml.size()),
+                                               nullptr, nullptr, XML_PARSE_NONET);
+  if (!reader) {
+    return LASSO_JS_ERROR_MALFORMED_MESSAGE;
+  }
+  xmlTextReaderSetErrorHandler(reader, SilentReaderError, nullptr);
+
+  int rc = 0;
+  int messageDepth = -1;
+  int children = 0;
+  bool inSignature = false;
+  bool headDone = head == nullptr;
+  size_t nodes = 0;
+  size_t namespaces = 0;
+  int ret;
+
+  while ((ret = xmlTextReaderRead(reader)) == 1) {
+    int type = xmlTextReaderNodeType(reader);
+    int depth = xmlTextReaderDepth(reader);
+
+    // Security: SAML messages never carry a DTD
+    if (type == XML_READER_TYPE_DOCUMENT_TYPE) {
+      rc = LASSO_JS_ERROR_MALFORMED_MESSAGE;
+      break;
+    }
+    if (maxDepth > 0 && static_cast<size_t>(depth) >= maxDepth) {
+      rc = LASSO_JS_ERROR_MESSAGE_TOO_DEEP;
+      break;
+    }
+
+    if (limits && type != XML_READER_TYPE_END_ELEMENT) {
+      if (limits->maxNodes > 0 && ++nodes > limits->maxNodes) {
+        rc = LASSO_JS_ERROR_PARSER_LIMIT;
+        break;
+      }
+      if (type == XML_READER_TYPE_ELEMENT) {
+        rc = CheckAttributes(reader, *limits, &namespaces);
+      } else if (limits->maxTextSize > 0 &&
+                 (type == XML_READER_TYPE_TEXT || type == XML_READER_TYPE_CDATA)) {
+        const xmlChar* value = xmlTextReaderConstValue(reader);
+        if (value && static_cast<size_t>(xmlStrlen(value)) > limits->maxTextSize) {
+          rc = LASSO_JS_ERROR_PARSER_LIMIT;
+        }
+      }
+      if (rc != 0) {
+        break;
+      }
+    }
+
+    if (type != XML_READER_TYPE_ELEMENT || headDone) {
+      continue;
+    }
+
+    if (messageDepth < 0) {
+      // First protocol element: the document root, or the SOAP Body child
+      if (NamespaceIs(reader, SAMLP_NS)) {
+        messageDepth = depth;
+        head->found = true;
+        head->destination = TakeXmlString(
+          xmlTextReaderGetAttribute(reader, BAD_CAST "Destination"));
+        head->issueInstant = TakeXmlString(
+          xmlTextReaderGetAttribute(reader, BAD_CAST "IssueInstant"));
+      }
+    } else if (depth == messageDepth + 1) {
+      // Issuer, when present, is the first child of the message and the
+      // message's Signature comes next. Texts are read in place, so they
+      // bypass the text size limit; the 4 MB message cap still bounds them.
+      const xmlChar* name = xmlTextReaderConstLocalName(reader);
+      children++;
+      inSignature = false;
+      if (children == 1 && NamespaceIs(reader, SAML_NS) && xmlStrEqual(name, BAD_CAST "Issuer")) {
+        head->issuer = TakeXmlString(xmlTextReaderReadString(reader));
+        headDone = !head->wantKeyInfo;
+      } else if (children <= 2 && head->wantKeyInfo && NamespaceIs(reader, DSIG_NS) &&
+                 xmlStrEqual(name, BAD_CAST "Signature")) {
+        inSignature = true;
+      } else {
+        headDone = true;
+      }
+    } else if (inSignature && depth > messageDepth + 1 && NamespaceIs(reader, DSIG_NS)) {
+      const xmlChar* name = xmlTextReaderConstLocalName(reader);
+      if (head->certificate.empty() && xmlStrEqual(name, BAD_CAST "X509Certificate")) {
+        head->certificate = TakeXmlString(xmlTextReaderReadString(reader));
+      } else if (head->keyName.empty() && xmlStrEqual(name, BAD_CAST "KeyName")) {
+        head->keyName = TakeXmlString(xmlTextReaderReadString(reader));
+      }
+    }
+
+    // Without bounds to enforce there is nothing left to learn from the body
+    if (headDone && maxDepth == 0 && !limits) {
+      break;
+    }
+  }
+
+  if (rc == 0 && ret < 0) {
+    rc = LASSO_JS_ERROR_MALFORMED_MESSAGE;
+  }
+
+  xmlFreeTextReader(reader);
+  return rc;
+}
+
+int PrefilterMessage(LassoServer* server, const PrefilterOptions* options,
+                     const ParserLimits* limits, KeyIndex* keys, const std::string& message) {
+  std::string xml;
+  switch (DecodeSamlMessage(message, &xml)) {
+    case DecodeStatus::kOk:
+      break;
+    case DecodeStatus::kTooLarge:
+      return LASSO_JS_ERROR_MESSAGE_TOO_LARGE;
+    case DecodeStatus::kInvalid:
+      return LASSO_JS_ERROR_MALFORMED_MESSAGE;
+  }
+
+  // The tighter of the two depth bounds applies
+  size_t maxDepth = options ? options->maxDepth : 0;
+  if (limits && limits->maxDepth > 0 && (maxDepth == 0 || limits->maxDepth < maxDepth)) {
+    maxDepth = limits->maxDepth;
+  }
+
+  MessageHead head;
+  head.wantKeyInfo = options && options->knownKey && keys;
+  int rc = ScanMessage(xml, maxDepth, limits, options ? &head : nullptr);
+  if (rc != 0 || !options) {
+    return rc;
+  }
+  if (!head.found) {
+    return LASSO_JS_ERROR_MALFORMED_MESSAGE;
+  }
+
+  if (options->knownIssuer &&
+      (head.issuer.empty() || !lasso_server_get_provider(server, head.issuer.c_str()))) {
+    return LASSO_JS_ERROR_UNKNOWN_ISSUER;
+  }
+
+  // Messages without a KeyInfo hint are left to Lasso
+  if (head.wantKeyInfo) {
+    gchar* keyName = g_strstrip(g_strdup(head.keyName.c_str()));
+    KeyIndex::Match match = keys->Lookup(head.issuer, head.certificate, keyName);
+    g_free(keyName);
+    if (match == KeyIndex::kUnknownKey) {
+      return LASSO_JS_ERROR_UNKNOWN_SIGNING_KEY;
+    }
+  }
+
+  // Destination is optional in SAML; only a present, unexpected one is rejected
+  if (!options->destinations.empty() && !head.destination.empty() &&
+      std::find(options->destinations.begin(), options->destinations.end(),
+                head.destination) == options->destinations.end()) {
+    return LASSO_JS_ERROR_WRONG_DESTINATION;
+  }
+
+  if (options->maxAgeMs > 0) {
+    int64_t instant = ParseInstant(head.issueInstant.c_str());
+    int64_t now = g_get_real_time() / 1000;
+    if (instant < 0 || instant < now - options->maxAgeMs ||
+        instant > now + options->clockSkewMs) {
+      return LASSO_JS_ERROR_STALE_ISSUE_INSTANT;
+    }
+  }
+
+  return 0;
+}
+
+} // namespace lasso_js
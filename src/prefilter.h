@@ -0,0 +1,54 @@
+#ifndef LASSO_JS_PREFILTER_H
+#define LASSO_JS_PREFILTER_H
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+#include "key_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lasso_js {
+
+// Checks applied to inbound messages before Lasso parses and verifies them
+struct PrefilterOptions {
+  bool knownIssuer;                       // Issuer must be a registered provider
+  std::vector<std::string> destinations;  // Accepted Destination values (empty = any)
+  int64_t maxAgeMs;                       // Oldest accepted IssueInstant (0 = unchecked)
+  int64_t clockSkewMs;                    // Accepted IssueInstant drift into the future
+  size_t maxDepth;                        // Deepest element nesting (0 = unchecked)
+  bool knownKey;                          // Signature KeyInfo must name an Issuer key
+};
+
+// Resource bounds on the document as a whole (0 = unchecked)
+struct ParserLimits {
+  size_t maxDepth;       // Deepest element nesting
+  size_t maxNodes;       // Elements, text and comment nodes in the document
+  size_t maxAttributes;  // Attributes on a single element
+  size_t maxTextSize;    // Bytes in a single text node
+  size_t maxNamespaces;  // Namespace declarations in the document
+};
+
+PrefilterOptions DefaultPrefilterOptions();
+ParserLimits DefaultParserLimits();
+
+/**
+ * Screen an encoded inbound message with a streaming (xmlReader) scan. The
+ * pre-filter checks the SAML message element and its Issuer; the parser
+ * limits are counted as the tokens arrive and abort the scan as soon as one
+ * is exceeded. No tree is built and no signature is checked, so junk is
+ * turned away for the cost of a tokenizer pass. Either option may be null.
+ * With knownKey, the KeyInfo of the message's own signature is looked up in
+ * keys.
+ * @returns 0 when the message is plausible, or a LASSO_JS_ERROR_* code
+ */
+int PrefilterMessage(LassoServer* server, const PrefilterOptions* options,
+                     const ParserLimits* limits, KeyIndex* keys, const std::string& message);
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_PREFILTER_H
@@ -0,0 +1,421 @@
+#include "provider_search.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace lasso_js {
+
+static const char* MD_NS = "urn:oasis:names:tc:SAML:2.0:metadata";
+static const char* MDUI_NS = "urn:oasis:names:tc:SAML:metadata:ui";
+static const char* SHIBMD_NS = "urn:mace:shibboleth:metadata:1.0";
+
+// Term weights by the field they come from
+static const uint8_t WEIGHT_DISPLAY_NAME = 4;
+static const uint8_t WEIGHT_KEYWORD = 3;
+static const uint8_t WEIGHT_DOMAIN = 3;
+static const uint8_t WEIGHT_ENTITY_ID = 1;
+
+static const float EXACT_TERM_BONUS = 1.5f;
+static const float DOMAIN_MATCH_SCORE = 10.0f;
+static const float ENTITY_ID_MATCH_SCORE = 20.0f;
+
+// Share of a query term's trigrams a provider must contain to match it
+static const double TRIGRAM_THRESHOLD = 0.6;
+
+static bool ElementIs(xmlNode* node, const char* ns, const char* name) {
+  return node->type == XML_ELEMENT_NODE && node->ns &&
+         strcmp(reinterpret_cast<const char*>(node->ns->href), ns) == 0 &&
+         strcmp(reinterpret_cast<const char*>(node->name), name) == 0;
+}
+
+static std::string Content(xmlNode* node) {
+  xmlChar* content = xmlNodeGetContent(node);
+  if (!content) {
+    return std::string();
+  }
+  gchar* text = g_strstrip(g_strdup(reinterpret_cast<const char*>(content)));
+  std::string result = text;
+  g_free(text);
+  xmlFree(content);
+  return result;
+}
+
+static void AddDisplayName(xmlNode* node, DiscoveryInfo* info, bool* english) {
+  std::string name = Content(node);
+  if (name.empty()) {
+    return;
+  }
+
+  xmlChar* lang = xmlNodeGetLang(node);
+  bool isEnglish = lang && (xmlStrEqual(lang, BAD_CAST "en") || xmlStrncmp(lang, BAD_CAST "en-", 3) == 0);
+  xmlFree(lang);
+
+  if (info->displayName.empty() || (isEnglish && !*english)) {
+    info->displayName = name;
+    *english = isEnglish;
+  }
+  info->displayNames.push_back(std::move(name));
+}
+
+// mdui:UIInfo, mdui:DiscoHints and shibmd:Scope below an md:Extensions
+static void CollectExtensions(xmlNode* node, DiscoveryInfo* info, bool* english) {
+  for (; node; node = node->next) {
+    if (node->type != XML_ELEMENT_NODE) {
+      continue;
+    }
+    if (ElementIs(node, MDUI_NS, "DisplayName")) {
+      AddDisplayName(node, info, english);
+    } else if (ElementIs(node, MDUI_NS, "Keywords")) {
+      // Space separated, "+" stands for a space inside a keyword
+      gchar** keywords = g_strsplit_set(Content(node).c_str(), " \t\r\n", -1);
+      for (gchar** k = keywords; *k; k++) {
+        if (**k) {
+          std::string keyword = *k;
+          std::replace(keyword.begin(), keyword.end(), '+', ' ');
+          info->keywords.push_back(std::move(keyword));
+        }
+      }
+      g_strfreev(keywords);
+    } else if (ElementIs(node, MDUI_NS, "DomainHint") || ElementIs(node, SHIBMD_NS, "Scope")) {
+      // Regular expression scopes can't be looked up
+      xmlChar* regexp = xmlGetNoNsProp(node, BAD_CAST "regexp");
+      bool isRegexp = regexp && (xmlStrEqual(regexp, BAD_CAST "true") || xmlStrEqual(regexp, BAD_CAST "1"));
+      xmlFree(regexp);
+
+      std::string domain = Content(node);
+      if (!isRegexp && !domain.empty()) {
+        gchar* lower = g_ascii_strdown(domain.c_str(), -1);
+        info->domains.push_back(lower);
+        g_free(lower);
+      }
+    } else if (ElementIs(node, MDUI_NS, "UIInfo") || ElementIs(node, MDUI_NS, "DiscoHints")) {
+      CollectExtensions(node->children, info, english);
+    }
+  }
+}
+
+void ParseDiscoveryInfo(xmlNode* root, DiscoveryInfo* info) {
+  if (!root) {
+    return;
+  }
+
+  bool english = false;
+
+  for (xmlNode* node = root->children; node; node = node->next) {
+    if (node->type != XML_ELEMENT_NODE) {
+      continue;
+    }
+
+    bool idp = ElementIs(node, MD_NS, "IDPSSODescriptor");
+    bool sp = ElementIs(node, MD_NS, "SPSSODescriptor");
+    info->idp = info->idp || idp;
+    info->sp = info->sp || sp;
+
+    if (idp || sp) {
+      for (xmlNode* child = node->children; child; child = child->next) {
+        if (ElementIs(child, MD_NS, "Extensions")) {
+          CollectExtensions(child->children, info, &english);
+        }
+      }
+    } else if (ElementIs(node, MD_NS, "Extensions")) {
+      CollectExtensions(node->children, info, &english);
+    }
+  }
+
+  // Providers without MDUI are shown under their organization's name
+  if (info->displayNames.empty()) {
+    bool organizationEnglish = false;
+    for (xmlNode* node = root->children; node; node = node->next) {
+      if (!ElementIs(node, MD_NS, "Organization")) {
+        continue;
+      }
+      for (xmlNode* child = node->children; child; child = child->next) {
+        if (ElementIs(child, MD_NS, "OrganizationDisplayName")) {
+          AddDisplayName(child, info, &organizationEnglish);
+        }
+      }
+    }
+  }
+}
+
+// Case folded, accent stripped text with every run of non alphanumeric
+// characters turned into a single space
+static std::string Normalize(const std::string& text) {
+  std::string out;
+
+  if (!g_utf8_validate(text.data(), static_cast<gssize>(text.size()), nullptr)) {
+    for (char c : text) {
+      if (g_ascii_isalnum(c)) {
+        out.push_back(g_ascii_tolower(c));
+      } else if (!out.empty() && out.back() != ' ') {
+        out.push_back(' ');
+      }
+    }
+  } else {
+    gchar* folded = g_utf8_casefold(text.data(), static_cast<gssize>(text.size()));
+    gchar* decomposed = g_utf8_normalize(folded, -1, G_NORMALIZE_NFKD);
+    g_free(folded);
+
+    for (const gchar* p = decomposed; p && *p; p = g_utf8_next_char(p)) {
+      gunichar c = g_utf8_get_char(p);
+      if (g_unichar_ismark(c)) {
+        continue;
+      }
+      if (g_unichar_isalnum(c)) {
+        gchar buf[6];
+        out.append(buf, g_unichar_to_utf8(c, buf));
+      } else if (!out.empty() && out.back() != ' ') {
+        out.push_back(' ');
+      }
+    }
+    g_free(decomposed);
+  }
+
+  if (!out.empty() && out.back() == ' ') {
+    out.pop_back();
+  }
+  return out;
+}
+
+static std::vector<std::string> Terms(const std::string& text) {
+  std::vector<std::string> terms;
+  std::string normalized = Normalize(text);
+
+  size_t start = 0;
+  while (start < normalized.size()) {
+    size_t end = normalized.find(' ', start);
+    if (end == std::string::npos) {
+      end = normalized.size();
+    }
+    terms.push_back(normalized.substr(start, end - start));
+    start = end + 1;
+  }
+  return terms;
+}
+
+static uint32_t Trigram(const std::string& term, size_t i) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(term[i])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(term[i + 1])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(term[i + 2]));
+}
+
+// Add the terms of text, keeping the best weight of each term
+static void AddTerms(const std::string& text, uint8_t weight,
+                     std::unordered_map<std::string, uint8_t>* terms) {
+  for (std::string& term : Terms(text)) {
+    uint8_t& best = (*terms)[term];
+    best = std::max(best, weight);
+  }
+}
+
+// Rebuild once replaced documents make up this share of the index
+static const size_t DEAD_DOCUMENT_DIVISOR = 4;
+
+void ProviderSearchIndex::Set(const std::string& entityId, DiscoveryInfo info) {
+  if (entityId.empty()) {
+    return;
+  }
+
+  // A provider loaded again replaces its old document, left in place unused
+  // until the next compaction
+  auto it = ids_.find(entityId);
+  if (it != ids_.end()) {
+    docs_[it->second].live = false;
+    dead_++;
+  }
+
+  uint32_t doc = static_cast<uint32_t>(docs_.size());
+  ids_[entityId] = doc;
+  docs_.push_back(Document{entityId, std::move(info), true});
+  Index(doc);
+
+  if (dead_ * DEAD_DOCUMENT_DIVISOR > docs_.size()) {
+    Compact();
+  }
+}
+
+void ProviderSearchIndex::Index(uint32_t doc) {
+  const Document& document = docs_[doc];
+
+  std::unordered_map<std::string, uint8_t> terms;
+  for (const std::string& name : document.info.displayNames) {
+    AddTerms(name, WEIGHT_DISPLAY_NAME, &terms);
+  }
+  for (const std::string& keyword : document.info.keywords) {
+    AddTerms(keyword, WEIGHT_KEYWORD, &terms);
+  }
+  for (const std::string& domain : document.info.domains) {
+    AddTerms(domain, WEIGHT_DOMAIN, &terms);
+    domains_[domain].push_back(doc);
+  }
+  AddTerms(document.entityId, WEIGHT_ENTITY_ID, &terms);
+
+  for (const auto& term : terms) {
+    postings_.push_back(Posting{term.first, doc, term.second});
+
+    for (size_t i = 0; i + 3 <= term.first.size(); i++) {
+      std::vector<uint32_t>& docs = trigrams_[Trigram(term.first, i)];
+      if (docs.empty() || docs.back() != doc) {
+        docs.push_back(doc);
+      }
+    }
+  }
+  sorted_ = false;
+}
+
+void ProviderSearchIndex::Compact() {
+  std::vector<Document> live;
+  live.reserve(docs_.size() - dead_);
+  for (Document& document : docs_) {
+    if (document.live) {
+      live.push_back(std::move(document));
+    }
+  }
+
+  docs_.swap(live);
+  dead_ = 0;
+  ids_.clear();
+  postings_.clear();
+  trigrams_.clear();
+  domains_.clear();
+
+  for (uint32_t doc = 0; doc < docs_.size(); doc++) {
+    ids_[docs_[doc].entityId] = doc;
+    Index(doc);
+  }
+}
+
+ProviderSearchIndex::Stats ProviderSearchIndex::GetStats() const {
+  return Stats{ids_.size(), docs_.size(), postings_.size(), trigrams_.size(), domains_.size()};
+}
+
+std::vector<ProviderSearchIndex::Match> ProviderSearchIndex::Search(const std::string& query,
+                                                                    size_t limit, Role role) {
+  std::vector<Match> matches;
+
+  if (!sorted_) {
+    std::sort(postings_.begin(), postings_.end());
+    sorted_ = true;
+  }
+
+  std::vector<std::string> terms = Terms(query);
+  size_t required = terms.size();
+
+  std::vector<float> scores(docs_.size(), 0.0f);
+  std::vector<uint16_t> matched(docs_.size(), 0);
+  std::vector<float> termScores(docs_.size(), 0.0f);
+  std::vector<uint16_t> trigramHits(docs_.size(), 0);
+  std::vector<uint32_t> touched;
+
+  for (const std::string& term : terms) {
+    touched.clear();
+    auto hit = [&](uint32_t doc, float score) {
+      if (termScores[doc] == 0.0f) {
+        touched.push_back(doc);
+      }
+      termScores[doc] = std::max(termScores[doc], score);
+    };
+
+    // Terms starting with the query term
+    auto it = std::lower_bound(postings_.begin(), postings_.end(), Posting{term, 0, 0});
+    for (; it != postings_.end() && it->term.compare(0, term.size(), term) == 0; ++it) {
+      hit(it->doc, it->weight * (it->term.size() == term.size() ? EXACT_TERM_BONUS : 1.0f));
+    }
+
+    // Terms sharing most of its trigrams: typos and matches inside a term
+    if (term.size() >= 3) {
+      std::vector<uint32_t> grams;
+      for (size_t i = 0; i + 3 <= term.size(); i++) {
+        grams.push_back(Trigram(term, i));
+      }
+      std::sort(grams.begin(), grams.end());
+      grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+      std::vector<uint32_t> candidates;
+      for (uint32_t gram : grams) {
+        auto posting = trigrams_.find(gram);
+        if (posting == trigrams_.end()) {
+          continue;
+        }
+        for (uint32_t doc : posting->second) {
+          if (trigramHits[doc]++ == 0) {
+            candidates.push_back(doc);
+          }
+        }
+      }
+
+      size_t threshold = static_cast<size_t>(std::ceil(grams.size() * TRIGRAM_THRESHOLD));
+      for (uint32_t doc : candidates) {
+        if (trigramHits[doc] >= threshold) {
+          hit(doc, static_cast<float>(trigramHits[doc]) / grams.size());
+        }
+        trigramHits[doc] = 0;
+      }
+    }
+
+    for (uint32_t doc : touched) {
+      scores[doc] += termScores[doc];
+      matched[doc]++;
+      termScores[doc] = 0.0f;
+    }
+  }
+
+  // An email address or domain matches the providers scoped to it or to
+  // one of its parent domains
+  std::string domain = query;
+  size_t at = domain.rfind('@');
+  if (at != std::string::npos) {
+    domain = domain.substr(at + 1);
+  }
+  if (domain.find('.') != std::string::npos && domain.find(' ') == std::string::npos) {
+    gchar* lower = g_ascii_strdown(domain.c_str(), -1);
+    domain = lower;
+    g_free(lower);
+
+    for (size_t pos = 0; pos != std::string::npos;) {
+      auto found = domains_.find(domain.substr(pos));
+      if (found != domains_.end()) {
+        for (uint32_t doc : found->second) {
+          scores[doc] += DOMAIN_MATCH_SCORE;
+          matched[doc] = static_cast<uint16_t>(required);
+        }
+      }
+      pos = domain.find('.', pos);
+      pos = pos == std::string::npos ? pos : pos + 1;
+    }
+  }
+
+  auto exact = ids_.find(query);
+  if (exact != ids_.end()) {
+    scores[exact->second] += ENTITY_ID_MATCH_SCORE;
+    matched[exact->second] = static_cast<uint16_t>(required);
+  }
+
+  for (uint32_t doc = 0; doc < docs_.size(); doc++) {
+    const Document& d = docs_[doc];
+    if (scores[doc] <= 0.0f || matched[doc] < required || !d.live ||
+        (role == kIdp && !d.info.idp) || (role == kSp && !d.info.sp)) {
+      continue;
+    }
+    matches.push_back(Match{&d.entityId, &d.info.displayName, scores[doc]});
+  }
+
+  auto better = [](const Match& a, const Match& b) {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    const std::string& nameA = a.displayName->empty() ? *a.entityId : *a.displayName;
+    const std::string& nameB = b.displayName->empty() ? *b.entityId : *b.displayName;
+    return nameA < nameB;
+  };
+
+  if (matches.size() > limit) {
+    std::partial_sort(matches.begin(), matches.begin() + limit, matches.end(), better);
+    matches.resize(limit);
+  } else {
+    std::sort(matches.begin(), matches.end(), better);
+  }
+  return matches;
+}
+
+} // namespace lasso_js
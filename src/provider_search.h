@@ -0,0 +1,112 @@
+#ifndef LASSO_JS_PROVIDER_SEARCH_H
+#define LASSO_JS_PROVIDER_SEARCH_H
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lasso_js {
+
+// What a discovery service shows and searches of a provider's metadata
+struct DiscoveryInfo {
+  std::string displayName;                // Preferred (English, else first) DisplayName
+  std::vector<std::string> displayNames;  // mdui:DisplayName, else OrganizationDisplayName
+  std::vector<std::string> keywords;      // mdui:Keywords
+  std::vector<std::string> domains;       // shibmd:Scope and mdui:DomainHint, lowercased
+  bool idp = false;                       // Has an IDPSSODescriptor
+  bool sp = false;                        // Has an SPSSODescriptor
+};
+
+// Fill info from the EntityDescriptor root of a metadata document
+void ParseDiscoveryInfo(xmlNode* root, DiscoveryInfo* info);
+
+/**
+ * ProviderSearchIndex - Autocomplete over the providers of a Server
+ *
+ * Display names, keywords, scopes / domain hints and entity IDs are case
+ * folded, stripped of accents and split into terms. A sorted term list
+ * answers prefix queries with a binary search, and a trigram index finds
+ * terms with typos or matching in the middle. An email address or domain
+ * also matches providers by scope, including subdomains. Each query term
+ * must match for a provider to be returned.
+ *
+ * Built as providers are added; the term list is sorted again on the first
+ * query after a change. A provider added again gets a new document and the
+ * old one is only marked dead; once dead documents make up a quarter of the
+ * index it is rebuilt from the live ones, so reloading metadata keeps the
+ * index at the size of the current providers. Used on the JS thread only.
+ */
+class ProviderSearchIndex {
+ public:
+  enum Role {
+    kAnyRole,
+    kIdp,
+    kSp,
+  };
+
+  struct Match {
+    const std::string* entityId;
+    const std::string* displayName;
+    float score;
+  };
+
+  struct Stats {
+    size_t providers;  // Live documents
+    size_t documents;  // Including replaced ones not yet compacted away
+    size_t postings;
+    size_t trigrams;
+    size_t domains;
+  };
+
+  // Add or replace a provider
+  void Set(const std::string& entityId, DiscoveryInfo info);
+
+  std::vector<Match> Search(const std::string& query, size_t limit, Role role);
+
+  size_t Size() const { return ids_.size(); }
+
+  Stats GetStats() const;
+
+ private:
+  struct Document {
+    std::string entityId;
+    DiscoveryInfo info;
+    bool live;
+  };
+
+  struct Posting {
+    std::string term;
+    uint32_t doc;
+    uint8_t weight;  // Weight of the best field the term came from
+
+    bool operator<(const Posting& other) const {
+      return term < other.term || (term == other.term && doc < other.doc);
+    }
+  };
+
+  // Add the postings, trigrams and scopes of a document
+  void Index(uint32_t doc);
+
+  // Rebuild the index from the live documents
+  void Compact();
+
+  std::vector<Document> docs_;
+  size_t dead_ = 0;
+  std::unordered_map<std::string, uint32_t> ids_;  // Entity ID -> live document
+  std::vector<Posting> postings_;
+  bool sorted_ = true;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams_;  // Trigram -> documents
+  std::unordered_map<std::string, std::vector<uint32_t>> domains_;  // Scope -> documents
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_PROVIDER_SEARCH_H
@@ -20,6 +20,23 @@
 
 namespace lasso_js {
 
+// Zero memory holding secrets in a way the compiler cannot optimize away
+inline void SecureZero(void* data, size_t size) {
+#if defined(HAVE_MEMSET_S)
+  memset_s(data, size, 0, size);
+#elif defined(HAVE_EXPLICIT_BZERO)
+  explicit_bzero(data, size);
+#elif defined(HAVE_SECURE_ZERO_MEMORY)
+  SecureZeroMemory(data, size);
+#else
+  // Fallback: use volatile to prevent compiler optimization
+  volatile char* p = static_cast<volatile char*>(data);
+  while (size--) {
+    *p++ = 0;
+  }
+#endif
+}
+
 /**
  * SecureString - A string wrapper that securely erases its contents on destruction
  *
@@ -89,20 +106,7 @@ private:
   // Securely zero out the string contents using platform-specific functions
   void secure_clear() {
     if (!data_.empty()) {
-#if defined(HAVE_MEMSET_S)
-      memset_s(&data_[0], data_.size(), 0, data_.size());
-#elif defined(HAVE_EXPLICIT_BZERO)
-      explicit_bzero(&data_[0], data_.size());
-#elif defined(HAVE_SECURE_ZERO_MEMORY)
-      SecureZeroMemory(&data_[0], data_.size());
-#else
-      // Fallback: use volatile to prevent compiler optimization
-      volatile char* p = &data_[0];
-      size_t n = data_.size();
-      while (n--) {
-        *p++ = 0;
-      }
-#endif
+      SecureZero(&data_[0], data_.size());
       data_.clear();
     }
   }
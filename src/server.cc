@@ -1,28 +1,73 @@
 #include "server.h"
 #include "utils.h"
+#include "codec.h"
+#include "xml_memory.h"
 #include "secure_string.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 namespace lasso_js {
 
 // Security: Maximum size for metadata to prevent DoS
 static const size_t MAX_METADATA_SIZE = 10 * 1024 * 1024; // 10 MB
 
+// Defaults for outstanding AuthnRequest tracking
+static const size_t DEFAULT_TRACKED_REQUESTS = 10000;
+static const int64_t DEFAULT_REQUEST_TTL_MS = 5 * 60 * 1000; // 5 minutes
+
+// Defaults for issued artifacts; SAML expects them to be short-lived
+static const size_t DEFAULT_STORED_ARTIFACTS = 10000;
+static const int64_t DEFAULT_ARTIFACT_TTL_MS = 2 * 60 * 1000; // 2 minutes
+
+// Upper bound on parser threads used by a single addProviders() batch
+static const unsigned MAX_PROVIDER_LOAD_THREADS = 8;
+
+// Provider discovery search
+static const size_t DEFAULT_SEARCH_RESULTS = 10;
+static const size_t MAX_SEARCH_RESULTS = 1000;
+static const size_t MAX_SEARCH_QUERY = 256;
+
 Napi::FunctionReference Server::constructor;
 
 Napi::Object Server::Init(Napi::Env env, Napi::Object exports) {
   Napi::Function func = DefineClass(env, "Server", {
     // Static methods
     StaticMethod("fromBuffers", &Server::FromBuffers),
+    StaticMethod("fromBuffersAsync", &Server::FromBuffersAsync),
     StaticMethod("fromDump", &Server::FromDump),
+    StaticMethod("signatureMethodsFromMetadata", &Server::SignatureMethodsFromMetadata),
 
     // Instance methods
     InstanceMethod("addProvider", &Server::AddProvider),
     InstanceMethod("addProviderFromBuffer", &Server::AddProviderFromBuffer),
+    InstanceMethod("addProviderFromBufferAsync", &Server::AddProviderFromBufferAsync),
+    InstanceMethod("addProviders", &Server::AddProviders),
     InstanceMethod("getProvider", &Server::GetProvider),
+    InstanceMethod("searchProviders", &Server::SearchProviders),
     InstanceMethod("dump", &Server::Dump),
+    InstanceMethod("enableRequestTracking", &Server::EnableRequestTracking),
+    InstanceMethod("disableRequestTracking", &Server::DisableRequestTracking),
+    InstanceMethod("configureArtifactStore", &Server::ConfigureArtifactStore),
+    InstanceMethod("setPrefilter", &Server::SetPrefilter),
+    InstanceMethod("setParserLimits", &Server::SetParserLimits),
+    InstanceMethod("enableAuthnRequestTemplates", &Server::EnableAuthnRequestTemplates),
+    InstanceMethod("disableAuthnRequestTemplates", &Server::DisableAuthnRequestTemplates),
+    InstanceMethod("setAttributePolicy", &Server::SetAttributePolicy),
+    InstanceMethod("setSignatureMethod", &Server::SetSignatureMethod),
+    InstanceMethod("setProviderSignatureMethod", &Server::SetProviderSignatureMethod),
 
     // Getters
     InstanceAccessor("entityId", &Server::GetEntityId, nullptr),
+    InstanceAccessor("pendingRequests", &Server::GetPendingRequests, nullptr),
+    InstanceAccessor("pendingArtifacts", &Server::GetPendingArtifacts, nullptr),
+    InstanceAccessor("authnRequestTemplates", &Server::GetAuthnRequestTemplateCount, nullptr),
+    InstanceAccessor("signatureMethod", &Server::GetSignatureMethod, nullptr),
+    InstanceAccessor("searchIndexStats", &Server::GetSearchIndexStats, nullptr),
   });
 
   constructor = Napi::Persistent(func);
@@ -37,15 +82,21 @@ Napi::Object Server::NewInstance(Napi::Env env, LassoServer* server) {
   Server* wrapper = Napi::ObjectWrap<Server>::Unwrap(obj);
   wrapper->server_ = server;
   wrapper->owns_server_ = true;
+  // Metadata and keys were just parsed
+  SyncExternalMemory(env);
   return obj;
 }
 
 Server::Server(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<Server>(info), server_(nullptr), owns_server_(false) {
+    : Napi::ObjectWrap<Server>(info), server_(nullptr), owns_server_(false),
+      allow_unsolicited_(false) {
   // Default constructor - server will be set by static factory methods
+  TrackObject(NativeObject::kServer, 1);
 }
 
 Server::~Server() {
+  TrackObject(NativeObject::kServer, -1);
+
   // Only cleanup if lasso is still initialized
   if (server_ && owns_server_ && IsLassoInitialized()) {
     g_object_unref(server_);
@@ -53,14 +104,15 @@ Server::~Server() {
   server_ = nullptr;
 }
 
-/**
- * Create a server from metadata, private key, and certificate buffers
- * @param metadata - IdP/SP metadata XML as string or Buffer
- * @param privateKey - Private key PEM as string or Buffer
- * @param certificate - Certificate PEM as string or Buffer
- * @param privateKeyPassword - Optional password for private key
- */
-Napi::Value Server::FromBuffers(const Napi::CallbackInfo& info) {
+// Arguments of fromBuffers(), read on the JS thread
+struct ServerBuffers {
+  std::string metadata;
+  SecureString privateKey;  // Security: Use SecureString for sensitive data
+  std::string certificate;
+  SecureString password;    // Security: Use SecureString for sensitive data
+};
+
+static void ReadServerBuffers(const Napi::CallbackInfo& info, ServerBuffers* out) {
   Napi::Env env = info.Env();
 
   if (info.Length() < 3) {
@@ -68,60 +120,71 @@ Napi::Value Server::FromBuffers(const Napi::CallbackInfo& info) {
       "Expected at least 3 arguments: metadata, privateKey, certificate");
   }
 
-  std::string metadata;
-  SecureString privateKey;  // Security: Use SecureString for sensitive data
-  std::string certificate;
-  SecureString password;    // Security: Use SecureString for sensitive data
-
   // Get metadata
   if (info[0].IsString()) {
-    metadata = info[0].As<Napi::String>().Utf8Value();
+    out->metadata = info[0].As<Napi::String>().Utf8Value();
   } else if (info[0].IsBuffer()) {
     Napi::Buffer<char> buf = info[0].As<Napi::Buffer<char>>();
-    metadata = std::string(buf.Data(), buf.Length());
+    out->metadata = std::string(buf.Data(), buf.Length());
   } else {
     throw Napi::TypeError::New(env, "metadata must be a string or Buffer");
   }
 
   // Security: Check metadata size to prevent DoS
-  if (metadata.size() > MAX_METADATA_SIZE) {
+  if (out->metadata.size() > MAX_METADATA_SIZE) {
     throw Napi::Error::New(env, "Metadata too large");
   }
 
   // Get private key (use SecureString)
   if (info[1].IsString()) {
-    privateKey = info[1].As<Napi::String>().Utf8Value();
+    out->privateKey = info[1].As<Napi::String>().Utf8Value();
   } else if (info[1].IsBuffer()) {
     Napi::Buffer<char> buf = info[1].As<Napi::Buffer<char>>();
-    privateKey = SecureString(buf.Data(), buf.Length());
+    out->privateKey = SecureString(buf.Data(), buf.Length());
   } else {
     throw Napi::TypeError::New(env, "privateKey must be a string or Buffer");
   }
 
   // Get certificate
   if (info[2].IsString()) {
-    certificate = info[2].As<Napi::String>().Utf8Value();
+    out->certificate = info[2].As<Napi::String>().Utf8Value();
   } else if (info[2].IsBuffer()) {
     Napi::Buffer<char> buf = info[2].As<Napi::Buffer<char>>();
-    certificate = std::string(buf.Data(), buf.Length());
+    out->certificate = std::string(buf.Data(), buf.Length());
   } else {
     throw Napi::TypeError::New(env, "certificate must be a string or Buffer");
   }
 
   // Get optional password (use SecureString)
   if (info.Length() > 3 && info[3].IsString()) {
-    password = info[3].As<Napi::String>().Utf8Value();
+    out->password = info[3].As<Napi::String>().Utf8Value();
   }
+}
 
-  // Create Lasso server
-  // Note: privateKey and password will be securely erased when they go out of scope
-  LassoServer* server = lasso_server_new_from_buffers(
-    metadata.c_str(),
-    privateKey.c_str(),
-    password.empty() ? nullptr : password.c_str(),
-    certificate.c_str()
+static LassoServer* NewServerFromBuffers(const ServerBuffers& buffers) {
+  return lasso_server_new_from_buffers(
+    buffers.metadata.c_str(),
+    buffers.privateKey.c_str(),
+    buffers.password.empty() ? nullptr : buffers.password.c_str(),
+    buffers.certificate.c_str()
   );
+}
+
+/**
+ * Create a server from metadata, private key, and certificate buffers
+ * @param metadata - IdP/SP metadata XML as string or Buffer
+ * @param privateKey - Private key PEM as string or Buffer
+ * @param certificate - Certificate PEM as string or Buffer
+ * @param privateKeyPassword - Optional password for private key
+ */
+Napi::Value Server::FromBuffers(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  // Note: privateKey and password will be securely erased when they go out of scope
+  ServerBuffers buffers;
+  ReadServerBuffers(info, &buffers);
 
+  LassoServer* server = NewServerFromBuffers(buffers);
   if (!server) {
     throw Napi::Error::New(env, "Failed to create Lasso server from buffers");
   }
@@ -129,6 +192,70 @@ Napi::Value Server::FromBuffers(const Napi::CallbackInfo& info) {
   return NewInstance(env, server);
 }
 
+/**
+ * Parses server metadata and loads its keys on a worker thread.
+ * The new LassoServer is not shared with anything until OnOK wraps it.
+ */
+class FromBuffersWorker : public Napi::AsyncWorker {
+ public:
+  FromBuffersWorker(Napi::Env env, ServerBuffers buffers)
+      : Napi::AsyncWorker(env, "LassoServerFromBuffers"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        buffers_(std::move(buffers)),
+        server_(nullptr) {}
+
+  ~FromBuffersWorker() {
+    // Server not handed over to JS (e.g. environment teardown)
+    if (server_ && IsLassoInitialized()) {
+      g_object_unref(server_);
+    }
+  }
+
+  Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    server_ = NewServerFromBuffers(buffers_);
+    if (!server_) {
+      SetError("Failed to create Lasso server from buffers");
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    LassoServer* server = server_;
+    server_ = nullptr;
+    deferred_.Resolve(Server::NewInstance(env, server));
+  }
+
+  void OnError(const Napi::Error& error) override {
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  ServerBuffers buffers_;
+  LassoServer* server_;
+};
+
+/**
+ * Create a server like fromBuffers(), parsing metadata and keys off the
+ * event loop
+ * @returns {Promise<Server>}
+ */
+Napi::Value Server::FromBuffersAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  ServerBuffers buffers;
+  ReadServerBuffers(info, &buffers);
+
+  FromBuffersWorker* worker = new FromBuffersWorker(env, std::move(buffers));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+
+  return promise;
+}
+
 /**
  * Restore a server from a dump string
  * @param dump - Server dump string
@@ -180,6 +307,7 @@ Napi::Value Server::AddProvider(const Napi::CallbackInfo& info) {
     caCert = info[3].As<Napi::String>().Utf8Value();
   }
 
+  std::unique_lock<std::shared_mutex> lock(lasso_lock_);
   int rc = lasso_server_add_provider(
     server_,
     LASSO_PROVIDER_ROLE_SP, // Default to SP, will be determined by metadata
@@ -189,16 +317,30 @@ Napi::Value Server::AddProvider(const Napi::CallbackInfo& info) {
   );
 
   ThrowIfError(env, rc, "lasso_server_add_provider");
+
+  MappedFile metadata;
+  std::string error;
+  if (metadata.Open(metadataPath, MAX_METADATA_SIZE, &error)) {
+    std::string entityId;
+    DiscoveryInfo discovery;
+    std::vector<ProviderKey> keys =
+      ParseSigningKeys(metadata.CStr(), metadata.Size(), &entityId, &discovery);
+    key_index_.Set(entityId, std::move(keys));
+    provider_search_.Set(entityId, std::move(discovery));
+  }
+
+  ProvidersChanged();
+  SyncExternalMemory(env);
   return env.Undefined();
 }
 
-/**
- * Add a provider from metadata buffer
- * @param providerId - Entity ID of the provider
- * @param metadata - Metadata XML as string or Buffer
- * @param publicKey - Optional public key PEM
- */
-Napi::Value Server::AddProviderFromBuffer(const Napi::CallbackInfo& info) {
+// Arguments of addProviderFromBuffer(), read on the JS thread
+struct ProviderBuffer {
+  std::string metadata;
+  std::string publicKey;
+};
+
+static void ReadProviderBuffer(const Napi::CallbackInfo& info, ProviderBuffer* out) {
   Napi::Env env = info.Env();
 
   if (info.Length() < 2) {
@@ -210,41 +352,389 @@ Napi::Value Server::AddProviderFromBuffer(const Napi::CallbackInfo& info) {
     throw Napi::TypeError::New(env, "providerId must be a string");
   }
 
-  std::string providerId = info[0].As<Napi::String>().Utf8Value();
-  std::string metadata;
-
   // Get metadata
   if (info[1].IsString()) {
-    metadata = info[1].As<Napi::String>().Utf8Value();
+    out->metadata = info[1].As<Napi::String>().Utf8Value();
   } else if (info[1].IsBuffer()) {
     Napi::Buffer<char> buf = info[1].As<Napi::Buffer<char>>();
-    metadata = std::string(buf.Data(), buf.Length());
+    out->metadata = std::string(buf.Data(), buf.Length());
   } else {
     throw Napi::TypeError::New(env, "metadata must be a string or Buffer");
   }
 
   // Security: Check metadata size to prevent DoS
-  if (metadata.size() > MAX_METADATA_SIZE) {
+  if (out->metadata.size() > MAX_METADATA_SIZE) {
     throw Napi::Error::New(env, "Metadata too large");
   }
 
-  std::string publicKey;
   if (info.Length() > 2 && info[2].IsString()) {
-    publicKey = info[2].As<Napi::String>().Utf8Value();
+    out->publicKey = info[2].As<Napi::String>().Utf8Value();
   }
+}
+
+/**
+ * Add a provider from metadata buffer
+ * @param providerId - Entity ID of the provider
+ * @param metadata - Metadata XML as string or Buffer
+ * @param publicKey - Optional public key PEM
+ */
+Napi::Value Server::AddProviderFromBuffer(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
+  ProviderBuffer buffer;
+  ReadProviderBuffer(info, &buffer);
+
+  std::unique_lock<std::shared_mutex> lock(lasso_lock_);
   int rc = lasso_server_add_provider_from_buffer(
     server_,
     LASSO_PROVIDER_ROLE_SP, // Default to SP
-    metadata.c_str(),
-    publicKey.empty() ? nullptr : publicKey.c_str(),
+    buffer.metadata.c_str(),
+    buffer.publicKey.empty() ? nullptr : buffer.publicKey.c_str(),
     nullptr // CA cert
   );
 
   ThrowIfError(env, rc, "lasso_server_add_provider_from_buffer");
+
+  std::string entityId;
+  DiscoveryInfo discovery;
+  std::vector<ProviderKey> keys =
+    ParseSigningKeys(buffer.metadata.data(), buffer.metadata.size(), &entityId, &discovery);
+  key_index_.Set(entityId, std::move(keys));
+  provider_search_.Set(entityId, std::move(discovery));
+
+  ProvidersChanged();
+  SyncExternalMemory(env);
   return env.Undefined();
 }
 
+/**
+ * Parses provider metadata on a worker thread. The provider is built on its
+ * own and only inserted into the server on the JS thread (OnOK), under the
+ * server's lock, so workers using the server never see its provider table
+ * change under them.
+ */
+class AddProviderWorker : public Napi::AsyncWorker {
+ public:
+  AddProviderWorker(Napi::Env env, Napi::Object serverObj, ProviderBuffer buffer)
+      : Napi::AsyncWorker(env, "LassoAddProvider"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        buffer_(std::move(buffer)),
+        provider_(nullptr) {
+    server_ref_ = Napi::Persistent(serverObj);
+  }
+
+  ~AddProviderWorker() {
+    if (provider_ && IsLassoInitialized()) {
+      g_object_unref(provider_);
+    }
+  }
+
+  Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    provider_ = lasso_provider_new_from_buffer(
+      LASSO_PROVIDER_ROLE_SP, // Default to SP
+      buffer_.metadata.c_str(),
+      buffer_.publicKey.empty() ? nullptr : buffer_.publicKey.c_str(),
+      nullptr // CA cert
+    );
+    if (!provider_) {
+      SetError("Failed to load provider metadata");
+      return;
+    }
+    keys_ = ParseSigningKeys(buffer_.metadata.data(), buffer_.metadata.size(), nullptr,
+                             &discovery_);
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Server* server = Napi::ObjectWrap<Server>::Unwrap(server_ref_.Value());
+    std::unique_lock<std::shared_mutex> lock(server->GetLassoLock());
+
+    int rc = lasso_server_add_provider2(server->GetServer(), provider_);
+    if (rc != 0) {
+      deferred_.Reject(LassoError(env, rc, "lasso_server_add_provider2").Value());
+      return;
+    }
+    server->GetKeyIndex()->Set(provider_->ProviderID, std::move(keys_));
+    server->GetProviderSearch()->Set(provider_->ProviderID, std::move(discovery_));
+
+    server->ProvidersChanged();
+    SyncExternalMemory(env);
+    deferred_.Resolve(env.Undefined());
+  }
+
+  void OnError(const Napi::Error& error) override {
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  Napi::ObjectReference server_ref_;
+  ProviderBuffer buffer_;
+  LassoProvider* provider_;  // The server takes its own reference
+  std::vector<ProviderKey> keys_;
+  DiscoveryInfo discovery_;
+};
+
+/**
+ * Add a provider like addProviderFromBuffer(), parsing the metadata off the
+ * event loop
+ * @returns {Promise<void>}
+ */
+Napi::Value Server::AddProviderFromBufferAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  ProviderBuffer buffer;
+  ReadProviderBuffer(info, &buffer);
+
+  AddProviderWorker* worker = new AddProviderWorker(env, Value(), std::move(buffer));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+
+  return promise;
+}
+
+// One entry of addProviders(), read on the JS thread
+struct ProviderFiles {
+  std::string metadataPath;
+  std::string publicKeyPath;
+  std::string caCertPath;
+};
+
+static std::string OptionalPath(Napi::Env env, Napi::Object entry, const char* key) {
+  Napi::Value value = entry.Get(key);
+  if (value.IsUndefined() || value.IsNull()) {
+    return std::string();
+  }
+  if (!value.IsString()) {
+    throw Napi::TypeError::New(env, std::string(key) + " must be a string");
+  }
+  return value.As<Napi::String>().Utf8Value();
+}
+
+/**
+ * Loads a batch of providers from files. Metadata files are memory mapped and
+ * parsed by a small pool of threads started from Execute(); key and CA paths
+ * are handed to Lasso, which reads them itself. Nothing touches the server
+ * until OnOK, where every provider is inserted in one pass on the JS thread,
+ * and only if all of them loaded with distinct entity IDs. If Lasso still
+ * refuses one, the providers inserted before it are taken out again.
+ */
+class AddProvidersWorker : public Napi::AsyncWorker {
+ public:
+  AddProvidersWorker(Napi::Env env, Napi::Object serverObj,
+                     std::vector<ProviderFiles> files)
+      : Napi::AsyncWorker(env, "LassoAddProviders"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        files_(std::move(files)),
+        providers_(files_.size(), nullptr),
+        keys_(files_.size()),
+        discovery_(files_.size()),
+        errors_(files_.size()) {
+    server_ref_ = Napi::Persistent(serverObj);
+  }
+
+  ~AddProvidersWorker() {
+    if (!IsLassoInitialized()) {
+      return;
+    }
+    for (LassoProvider* provider : providers_) {
+      if (provider) {
+        g_object_unref(provider);
+      }
+    }
+  }
+
+  Napi::Promise GetPromise() { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    std::atomic<size_t> next(0);
+    auto run = [this, &next]() {
+      size_t i;
+      while ((i = next.fetch_add(1)) < files_.size()) {
+        Load(i);
+      }
+    };
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, MAX_PROVIDER_LOAD_THREADS);
+    threads = std::min(threads, static_cast<unsigned>(files_.size()));
+
+    // This thread takes a share of the work as well
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+      pool.emplace_back(run);
+    }
+    run();
+    for (std::thread& thread : pool) {
+      thread.join();
+    }
+
+    for (size_t i = 0; i < files_.size(); i++) {
+      if (!errors_[i].empty()) {
+        SetError(errors_[i]);
+        return;
+      }
+    }
+
+    // Everything Lasso could refuse in OnOK is checked here, so the batch
+    // is inserted whole
+    std::unordered_map<std::string, size_t> seen;
+    for (size_t i = 0; i < providers_.size(); i++) {
+      const char* providerId = providers_[i]->ProviderID;
+      if (!providerId || !*providerId) {
+        SetError("No entityID in provider metadata: " + files_[i].metadataPath);
+        return;
+      }
+      if (!seen.emplace(providerId, i).second) {
+        SetError(std::string("Duplicate entityID ") + providerId + " in " +
+                 files_[seen[providerId]].metadataPath + " and " + files_[i].metadataPath);
+        return;
+      }
+    }
+  }
+
+  void OnOK() override {
+    Napi::Env env = Env();
+    Server* server = Napi::ObjectWrap<Server>::Unwrap(server_ref_.Value());
+    std::unique_lock<std::shared_mutex> lock(server->GetLassoLock());
+
+    LassoServer* lassoServer = server->GetServer();
+    // Providers replaced by the batch, to put back if an insert fails
+    std::vector<LassoProvider*> previous(providers_.size(), nullptr);
+    size_t added = 0;
+    int rc = 0;
+    for (; added < providers_.size(); added++) {
+      const char* providerId = providers_[added]->ProviderID;
+      previous[added] = lasso_server_get_provider(lassoServer, providerId);
+      if (previous[added]) {
+        g_object_ref(previous[added]);
+      }
+      rc = lasso_server_add_provider2(lassoServer, providers_[added]);
+      if (rc != 0) {
+        break;
+      }
+    }
+
+    if (rc != 0) {
+      for (size_t i = 0; i < added; i++) {
+        if (previous[i]) {
+          lasso_server_add_provider2(lassoServer, previous[i]);
+        } else {
+          g_hash_table_remove(lassoServer->providers, providers_[i]->ProviderID);
+        }
+      }
+    }
+    for (LassoProvider* provider : previous) {
+      if (provider) {
+        g_object_unref(provider);
+      }
+    }
+    if (rc != 0) {
+      deferred_.Reject(LassoError(env, rc, "lasso_server_add_provider2").Value());
+      return;
+    }
+
+    Napi::Array ids = Napi::Array::New(env, providers_.size());
+    for (size_t i = 0; i < providers_.size(); i++) {
+      const char* providerId = providers_[i]->ProviderID;
+      ids.Set(i, Napi::String::New(env, providerId));
+      server->GetKeyIndex()->Set(providerId, std::move(keys_[i]));
+      server->GetProviderSearch()->Set(providerId, std::move(discovery_[i]));
+    }
+
+    server->ProvidersChanged();
+    SyncExternalMemory(env);
+    deferred_.Resolve(ids);
+  }
+
+  void OnError(const Napi::Error& error) override {
+    deferred_.Reject(error.Value());
+  }
+
+ private:
+  // Runs on a pool thread; each index is owned by exactly one thread
+  void Load(size_t i) {
+    const ProviderFiles& files = files_[i];
+
+    MappedFile metadata;
+    std::string error;
+    if (!metadata.Open(files.metadataPath, MAX_METADATA_SIZE, &error)) {
+      errors_[i] = error;
+      return;
+    }
+
+    providers_[i] = lasso_provider_new_from_buffer(
+      LASSO_PROVIDER_ROLE_SP, // Default to SP, will be determined by metadata
+      metadata.CStr(),
+      files.publicKeyPath.empty() ? nullptr : files.publicKeyPath.c_str(),
+      files.caCertPath.empty() ? nullptr : files.caCertPath.c_str()
+    );
+    if (!providers_[i]) {
+      errors_[i] = "Failed to load provider metadata: " + files.metadataPath;
+      return;
+    }
+    keys_[i] = ParseSigningKeys(metadata.CStr(), metadata.Size(), nullptr, &discovery_[i]);
+  }
+
+  Napi::Promise::Deferred deferred_;
+  Napi::ObjectReference server_ref_;
+  std::vector<ProviderFiles> files_;
+  std::vector<LassoProvider*> providers_;  // The server takes its own reference
+  std::vector<std::vector<ProviderKey>> keys_;
+  std::vector<DiscoveryInfo> discovery_;
+  std::vector<std::string> errors_;
+};
+
+/**
+ * Add a batch of providers from files, loading them off the event loop
+ * @param entries - Array of {metadataPath, publicKeyPath?, caCertPath?}
+ * @returns {Promise<string[]>} Entity IDs of the added providers, in order
+ */
+Napi::Value Server::AddProviders(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    throw Napi::TypeError::New(env, "Expected an array of provider entries");
+  }
+
+  Napi::Array entries = info[0].As<Napi::Array>();
+  std::vector<ProviderFiles> files;
+  files.reserve(entries.Length());
+
+  for (uint32_t i = 0; i < entries.Length(); i++) {
+    Napi::Value value = entries.Get(i);
+    if (!value.IsObject()) {
+      throw Napi::TypeError::New(env, "Provider entries must be objects");
+    }
+    Napi::Object entry = value.As<Napi::Object>();
+
+    ProviderFiles item;
+    item.metadataPath = OptionalPath(env, entry, "metadataPath");
+    if (item.metadataPath.empty()) {
+      throw Napi::TypeError::New(env, "metadataPath is required");
+    }
+    item.publicKeyPath = OptionalPath(env, entry, "publicKeyPath");
+    item.caCertPath = OptionalPath(env, entry, "caCertPath");
+    files.push_back(std::move(item));
+  }
+
+  if (files.empty()) {
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    deferred.Resolve(Napi::Array::New(env));
+    return deferred.Promise();
+  }
+
+  AddProvidersWorker* worker = new AddProvidersWorker(env, Value(), std::move(files));
+  Napi::Promise promise = worker->GetPromise();
+  worker->Queue();
+
+  return promise;
+}
+
 /**
  * Get a provider by entity ID
  * @param providerId - Entity ID of the provider
@@ -273,6 +763,113 @@ Napi::Value Server::GetProvider(const Napi::CallbackInfo& info) {
     result.Set("metadata", Napi::String::New(env, metadata));
   }
 
+  // Signing keys indexed from the metadata (see setPrefilter({ knownKey }))
+  const std::vector<ProviderKey>* keys = key_index_.Find(providerId);
+  if (keys) {
+    Napi::Array list = Napi::Array::New(env, keys->size());
+    for (size_t i = 0; i < keys->size(); i++) {
+      const ProviderKey& key = (*keys)[i];
+      Napi::Object entry = Napi::Object::New(env);
+      if (!key.fingerprint.empty()) {
+        static const char HEX[] = "0123456789abcdef";
+        std::string hex;
+        for (unsigned char c : key.fingerprint) {
+          hex += HEX[c >> 4];
+          hex += HEX[c & 0x0f];
+        }
+        entry.Set("sha256", Napi::String::New(env, hex));
+      }
+      if (!key.keyName.empty()) {
+        entry.Set("keyName", Napi::String::New(env, key.keyName));
+      }
+      list.Set(static_cast<uint32_t>(i), entry);
+    }
+    result.Set("signingKeys", list);
+  }
+
+  return result;
+}
+
+/**
+ * Search the loaded providers for a discovery service
+ * Matches MDUI DisplayName, Keywords, scopes / DomainHint and entity ID by
+ * prefix and trigram; an email address or domain matches by scope.
+ * @param query - Search text
+ * @param options - { limit?: number (default 10), role?: "idp" | "sp" }
+ * @returns Array of [entityId, displayName | null, score], best first
+ */
+Napi::Value Server::SearchProviders(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected query string as first argument");
+  }
+
+  std::string query = info[0].As<Napi::String>().Utf8Value();
+  if (query.size() > MAX_SEARCH_QUERY) {
+    query.resize(MAX_SEARCH_QUERY);
+  }
+
+  size_t limit = DEFAULT_SEARCH_RESULTS;
+  ProviderSearchIndex::Role role = ProviderSearchIndex::kAnyRole;
+
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    Napi::Value value = options.Get("limit");
+    if (value.IsNumber()) {
+      int64_t n = value.As<Napi::Number>().Int64Value();
+      if (n <= 0 || n > static_cast<int64_t>(MAX_SEARCH_RESULTS)) {
+        throw Napi::RangeError::New(env, "limit must be between 1 and 1000");
+      }
+      limit = static_cast<size_t>(n);
+    }
+
+    value = options.Get("role");
+    if (value.IsString()) {
+      std::string name = value.As<Napi::String>().Utf8Value();
+      if (name == "idp") {
+        role = ProviderSearchIndex::kIdp;
+      } else if (name == "sp") {
+        role = ProviderSearchIndex::kSp;
+      } else {
+        throw Napi::TypeError::New(env, "role must be \"idp\" or \"sp\"");
+      }
+    }
+  }
+
+  std::vector<ProviderSearchIndex::Match> matches = provider_search_.Search(query, limit, role);
+
+  Napi::Array result = Napi::Array::New(env, matches.size());
+  for (size_t i = 0; i < matches.size(); i++) {
+    const ProviderSearchIndex::Match& match = matches[i];
+    Napi::Array row = Napi::Array::New(env, 3);
+    row.Set(0u, Napi::String::New(env, *match.entityId));
+    row.Set(1u, match.displayName->empty()
+                  ? env.Null()
+                  : Napi::Value(Napi::String::New(env, *match.displayName)));
+    row.Set(2u, Napi::Number::New(env, match.score));
+    result.Set(static_cast<uint32_t>(i), row);
+  }
+
+  return result;
+}
+
+/**
+ * Size of the provider search index
+ * @returns {{ providers, documents, postings, trigrams, domains }}
+ */
+Napi::Value Server::GetSearchIndexStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  ProviderSearchIndex::Stats stats = provider_search_.GetStats();
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("providers", Napi::Number::New(env, static_cast<double>(stats.providers)));
+  result.Set("documents", Napi::Number::New(env, static_cast<double>(stats.documents)));
+  result.Set("postings", Napi::Number::New(env, static_cast<double>(stats.postings)));
+  result.Set("trigrams", Napi::Number::New(env, static_cast<double>(stats.trigrams)));
+  result.Set("domains", Napi::Number::New(env, static_cast<double>(stats.domains)));
   return result;
 }
 
@@ -294,6 +891,599 @@ Napi::Value Server::Dump(const Napi::CallbackInfo& info) {
   return result;
 }
 
+// Read { maxEntries, ttl } options shared by the native TTL stores
+static void ParseStoreOptions(Napi::Env env, Napi::Object options,
+                              size_t* maxEntries, int64_t* ttl) {
+  Napi::Value value = options.Get("maxEntries");
+  if (value.IsNumber()) {
+    int64_t n = value.As<Napi::Number>().Int64Value();
+    if (n <= 0) {
+      throw Napi::RangeError::New(env, "maxEntries must be a positive number");
+    }
+    *maxEntries = static_cast<size_t>(n);
+  }
+
+  value = options.Get("ttl");
+  if (value.IsNumber()) {
+    *ttl = value.As<Napi::Number>().Int64Value();
+    if (*ttl <= 0) {
+      throw Napi::RangeError::New(env, "ttl must be a positive number");
+    }
+  }
+}
+
+/**
+ * Track outstanding AuthnRequest IDs (SP)
+ * IDs are recorded by Login.buildAuthnRequestMsg() and consumed by
+ * Login.processResponseMsg(), which rejects responses whose InResponseTo
+ * is unknown, expired or already used. Past maxEntries outstanding
+ * requests, the oldest is forgotten.
+ * @param options - { maxEntries?: number, ttl?: number (ms), allowUnsolicited?: boolean }
+ */
+Napi::Value Server::EnableRequestTracking(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  size_t maxEntries = DEFAULT_TRACKED_REQUESTS;
+  int64_t ttl = DEFAULT_REQUEST_TTL_MS;
+  bool allowUnsolicited = false;
+
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+    ParseStoreOptions(env, options, &maxEntries, &ttl);
+
+    Napi::Value value = options.Get("allowUnsolicited");
+    if (value.IsBoolean()) {
+      allowUnsolicited = value.As<Napi::Boolean>().Value();
+    }
+  }
+
+  request_store_ = std::make_unique<TtlMap<std::string>>(
+    maxEntries, std::chrono::milliseconds(ttl));
+  allow_unsolicited_ = allowUnsolicited;
+
+  return env.Undefined();
+}
+
+/**
+ * Stop tracking AuthnRequest IDs and forget the outstanding ones
+ */
+Napi::Value Server::DisableRequestTracking(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  request_store_.reset();
+  allow_unsolicited_ = false;
+
+  return env.Undefined();
+}
+
+/**
+ * Number of outstanding (unanswered, unexpired) AuthnRequests
+ */
+Napi::Value Server::GetPendingRequests(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!request_store_) {
+    return Napi::Number::New(env, 0);
+  }
+
+  return Napi::Number::New(env, static_cast<double>(request_store_->Size()));
+}
+
+/**
+ * Cache compiled HTTP-Redirect AuthnRequests per IdP
+ * The first Login.buildAuthnRequestMsg() for an IdP goes through Lasso and
+ * its output becomes the template; later requests to that IdP only fill in
+ * a new ID and IssueInstant, then deflate, encode and sign the query. The
+ * cache is dropped whenever providers are added.
+ */
+Napi::Value Server::EnableAuthnRequestTemplates(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!authn_templates_) {
+    authn_templates_ = std::make_unique<AuthnRequestTemplates>(server_);
+  }
+
+  return env.Undefined();
+}
+
+/**
+ * Build every AuthnRequest through Lasso again and drop the templates
+ */
+Napi::Value Server::DisableAuthnRequestTemplates(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  authn_templates_.reset();
+
+  return env.Undefined();
+}
+
+void Server::ProvidersChanged() {
+  if (authn_templates_) {
+    authn_templates_->Clear();
+  }
+  // Keys load from the server's own key, validated when the method was set
+  ApplyProviderSignatureMethods();
+}
+
+/**
+ * Number of IdPs with a compiled AuthnRequest
+ */
+Napi::Value Server::GetAuthnRequestTemplateCount(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!authn_templates_) {
+    return Napi::Number::New(env, 0);
+  }
+
+  return Napi::Number::New(env, static_cast<double>(authn_templates_->Size()));
+}
+
+// Read an optional string property of an attribute definition
+static std::string DefinitionString(Napi::Env env, Napi::Object object, const char* key) {
+  Napi::Value value = object.Get(key);
+  if (value.IsUndefined() || value.IsNull()) {
+    return std::string();
+  }
+  if (!value.IsString()) {
+    throw Napi::TypeError::New(env, std::string(key) + " must be a string");
+  }
+  return value.As<Napi::String>().Utf8Value();
+}
+
+/**
+ * Set the attributes released to an SP (IdP)
+ * Login.setAttributes() then only releases these attributes, in this order,
+ * with these NameFormat and FriendlyName values.
+ * @param providerId - SP entity ID
+ * @param attributes - Array of { name, nameFormat?, friendlyName? }, or
+ *   null to release every attribute as given
+ */
+Napi::Value Server::SetAttributePolicy(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected providerId and attribute list");
+  }
+  std::string providerId = info[0].As<Napi::String>().Utf8Value();
+
+  if (info[1].IsNull()) {
+    attribute_policies_.erase(providerId);
+    return env.Undefined();
+  }
+  if (!info[1].IsArray()) {
+    throw Napi::TypeError::New(env, "attributes must be an array or null");
+  }
+
+  Napi::Array list = info[1].As<Napi::Array>();
+  std::vector<AttributeDefinition> definitions;
+  definitions.reserve(list.Length());
+
+  for (uint32_t i = 0; i < list.Length(); i++) {
+    Napi::Value value = list.Get(i);
+    if (!value.IsObject()) {
+      throw Napi::TypeError::New(env, "Attribute definitions must be objects");
+    }
+    Napi::Object object = value.As<Napi::Object>();
+
+    AttributeDefinition definition;
+    definition.name = DefinitionString(env, object, "name");
+    if (definition.name.empty()) {
+      throw Napi::TypeError::New(env, "Attribute name is required");
+    }
+    definition.nameFormat = DefinitionString(env, object, "nameFormat");
+    definition.friendlyName = DefinitionString(env, object, "friendlyName");
+    definitions.push_back(std::move(definition));
+  }
+
+  attribute_policies_[providerId] = std::make_shared<AttributeRelease>(std::move(definitions));
+  return env.Undefined();
+}
+
+std::shared_ptr<const AttributeRelease> Server::GetAttributeRelease(const char* providerId) const {
+  if (!providerId) {
+    return nullptr;
+  }
+  auto it = attribute_policies_.find(providerId);
+  return it == attribute_policies_.end() ? nullptr : it->second;
+}
+
+// ===== Signature Methods =====
+
+// Read a SignatureMethod argument; only the RSA methods are selectable
+static LassoSignatureMethod SignatureMethodArg(Napi::Env env, const Napi::Value& value) {
+  if (value.IsNumber()) {
+    LassoSignatureMethod method =
+      static_cast<LassoSignatureMethod>(value.As<Napi::Number>().Int32Value());
+    if (SignatureDigestUri(method)) {
+      return method;
+    }
+  }
+  throw Napi::TypeError::New(env,
+    "Expected SignatureMethod.RSA_SHA1, RSA_SHA256, RSA_SHA384 or RSA_SHA512");
+}
+
+/**
+ * Set the method of signatures made with the server's key
+ * Applies to every provider without its own method. Lasso keys only come in
+ * RSA (and DSA) flavours, so ECDSA is not available.
+ * @param method - SignatureMethod value
+ */
+Napi::Value Server::SetSignatureMethod(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1) {
+    throw Napi::TypeError::New(env, "Expected signature method");
+  }
+  LassoSignatureMethod method = SignatureMethodArg(env, info[0]);
+
+  std::unique_lock<std::shared_mutex> lock(lasso_lock_);
+  LassoSignatureMethod previous = server_->signature_method;
+  server_->signature_method = method;
+
+  // Templates and providers following the default were signed the old way
+  if (authn_templates_) {
+    authn_templates_->Clear();
+  }
+  int rc = ApplyProviderSignatureMethods();
+  if (rc != 0) {
+    server_->signature_method = previous;
+    ApplyProviderSignatureMethods();
+    ThrowIfError(env, rc, "setSignatureMethod");
+  }
+
+  return env.Undefined();
+}
+
+/**
+ * Sign messages to one provider with its own signature method
+ * The method is kept across provider reloads and applied once the provider
+ * is added. Not part of dump().
+ * @param providerId - Provider entity ID
+ * @param method - SignatureMethod value, or null to follow the server's
+ */
+Napi::Value Server::SetProviderSignatureMethod(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected providerId and signature method");
+  }
+  if (!server_->private_key) {
+    throw Napi::Error::New(env, "Server has no private key");
+  }
+  std::string providerId = info[0].As<Napi::String>().Utf8Value();
+  LassoSignatureMethod method = info[1].IsNull() ? LASSO_SIGNATURE_METHOD_NONE
+                                                 : SignatureMethodArg(env, info[1]);
+
+  std::unique_lock<std::shared_mutex> lock(lasso_lock_);
+  auto it = provider_signature_methods_.find(providerId);
+  bool existed = it != provider_signature_methods_.end();
+  LassoSignatureMethod previous = existed ? it->second : LASSO_SIGNATURE_METHOD_NONE;
+
+  if (info[1].IsNull()) {
+    if (!existed) {
+      return env.Undefined();
+    }
+    // The provider already holds a key: swap it for one of the default method
+    it->second = LASSO_SIGNATURE_METHOD_NONE;
+  } else {
+    provider_signature_methods_[providerId] = method;
+  }
+
+  int rc = ApplyProviderSignatureMethods();
+  if (rc != 0) {
+    if (existed) {
+      provider_signature_methods_[providerId] = previous;
+    } else {
+      provider_signature_methods_.erase(providerId);
+    }
+    ApplyProviderSignatureMethods();
+    ThrowIfError(env, rc, "setProviderSignatureMethod");
+  }
+
+  if (authn_templates_) {
+    authn_templates_->Clear();
+  }
+
+  return env.Undefined();
+}
+
+// Give each provider with a method of its own a signing key of that method.
+// Providers sharing a method share the key. Returns 0 or an error code.
+int Server::ApplyProviderSignatureMethods() {
+  if (provider_signature_methods_.empty() || !server_->private_key) {
+    return 0;
+  }
+
+  std::map<LassoSignatureMethod, LassoKey*> keys;
+  int rc = 0;
+
+  for (const auto& entry : provider_signature_methods_) {
+    LassoProvider* provider = lasso_server_get_provider(server_, entry.first.c_str());
+    if (!provider) {
+      continue;  // Applied once the provider is added
+    }
+
+    LassoSignatureMethod method = entry.second != LASSO_SIGNATURE_METHOD_NONE
+                                    ? entry.second
+                                    : server_->signature_method;
+    LassoKey*& key = keys[method];
+    if (!key) {
+      key = lasso_key_new_for_signature_from_file(
+        server_->private_key,
+        server_->private_key_password,
+        method,
+        server_->certificate
+      );
+    }
+    rc = key ? lasso_provider_set_server_signing_key(provider, key)
+             : LASSO_DS_ERROR_PRIVATE_KEY_LOAD_FAILED;
+    if (rc != 0) {
+      break;
+    }
+  }
+
+  for (auto& entry : keys) {
+    if (entry.second) {
+      g_object_unref(entry.second);
+    }
+  }
+  return rc;
+}
+
+/**
+ * Current method of signatures made with the server's key
+ */
+Napi::Value Server::GetSignatureMethod(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), server_->signature_method);
+}
+
+static const char* ALGSUPPORT_NS = "urn:oasis:names:tc:SAML:metadata:algsupport";
+
+// Collect alg:SigningMethod and alg:DigestMethod Algorithm URIs in document order
+static void CollectAlgorithms(xmlNode* node, std::vector<std::string>* signing,
+                              std::vector<std::string>* digests) {
+  for (; node; node = node->next) {
+    if (node->type != XML_ELEMENT_NODE) {
+      continue;
+    }
+    if (node->ns && strcmp(reinterpret_cast<const char*>(node->ns->href), ALGSUPPORT_NS) == 0) {
+      bool isSigning = strcmp(reinterpret_cast<const char*>(node->name), "SigningMethod") == 0;
+      bool isDigest = strcmp(reinterpret_cast<const char*>(node->name), "DigestMethod") == 0;
+      xmlChar* algorithm = (isSigning || isDigest)
+                             ? xmlGetNoNsProp(node, BAD_CAST "Algorithm")
+                             : nullptr;
+      if (algorithm) {
+        (isSigning ? signing : digests)->push_back(reinterpret_cast<const char*>(algorithm));
+        xmlFree(algorithm);
+      }
+    }
+    CollectAlgorithms(node->children, signing, digests);
+  }
+}
+
+/**
+ * Signature methods a provider's metadata asks for, most preferred first
+ * Reads the SAML algorithm support extension (alg:SigningMethod and
+ * alg:DigestMethod); methods Lasso cannot produce are skipped, and so are
+ * those whose digest is not listed when DigestMethod hints are present.
+ * Pass the first one to setProviderSignatureMethod().
+ * @param metadata - Provider metadata as string or Buffer
+ * @returns {number[]} SignatureMethod values
+ */
+Napi::Value Server::SignatureMethodsFromMetadata(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  std::string metadata;
+  if (info.Length() > 0 && info[0].IsString()) {
+    metadata = info[0].As<Napi::String>().Utf8Value();
+  } else if (info.Length() > 0 && info[0].IsBuffer()) {
+    Napi::Buffer<char> buf = info[0].As<Napi::Buffer<char>>();
+    metadata = std::string(buf.Data(), buf.Length());
+  } else {
+    throw Napi::TypeError::New(env, "metadata must be a string or Buffer");
+  }
+
+  // Security: Check metadata size to prevent DoS
+  if (metadata.size() > MAX_METADATA_SIZE) {
+    throw Napi::Error::New(env, "Metadata too large");
+  }
+
+  xmlDoc* doc = xmlReadMemory(metadata.data(), static_cast<int>(metadata.size()),
+                              nullptr, nullptr,
+                              XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+  if (!doc) {
+    throw Napi::Error::New(env, "Invalid metadata");
+  }
+
+  std::vector<std::string> signing;
+  std::vector<std::string> digests;
+  CollectAlgorithms(xmlDocGetRootElement(doc), &signing, &digests);
+  xmlFreeDoc(doc);
+
+  Napi::Array result = Napi::Array::New(env);
+  uint32_t n = 0;
+  for (const std::string& uri : signing) {
+    LassoSignatureMethod method = SignatureMethodFromUri(uri.c_str());
+    if (method == LASSO_SIGNATURE_METHOD_NONE) {
+      continue;
+    }
+    if (!digests.empty() &&
+        std::find(digests.begin(), digests.end(), SignatureDigestUri(method)) == digests.end()) {
+      continue;
+    }
+    result.Set(n++, Napi::Number::New(env, method));
+  }
+
+  return result;
+}
+
+TtlMap<ArtifactEntry>* Server::GetArtifactStore() {
+  if (!artifact_store_) {
+    artifact_store_ = std::make_unique<TtlMap<ArtifactEntry>>(
+      DEFAULT_STORED_ARTIFACTS, std::chrono::milliseconds(DEFAULT_ARTIFACT_TTL_MS));
+  }
+  return artifact_store_.get();
+}
+
+/**
+ * Configure the store holding responses issued through HTTP-Artifact (IdP)
+ * Replaces the current store, dropping any unresolved artifacts.
+ * @param options - { maxEntries?: number, ttl?: number (ms) }
+ */
+Napi::Value Server::ConfigureArtifactStore(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  size_t maxEntries = DEFAULT_STORED_ARTIFACTS;
+  int64_t ttl = DEFAULT_ARTIFACT_TTL_MS;
+
+  if (info.Length() > 0 && info[0].IsObject()) {
+    ParseStoreOptions(env, info[0].As<Napi::Object>(), &maxEntries, &ttl);
+  }
+
+  artifact_store_ = std::make_unique<TtlMap<ArtifactEntry>>(
+    maxEntries, std::chrono::milliseconds(ttl));
+
+  return env.Undefined();
+}
+
+/**
+ * Number of issued artifacts not yet resolved or expired
+ */
+Napi::Value Server::GetPendingArtifacts(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!artifact_store_) {
+    return Napi::Number::New(env, 0);
+  }
+
+  return Napi::Number::New(env, static_cast<double>(artifact_store_->Size()));
+}
+
+int Server::ScreenMessage(const std::string& message) {
+  if (prefilter_ || parser_limits_) {
+    return PrefilterMessage(server_, prefilter_.get(), parser_limits_.get(), &key_index_,
+                            message);
+  }
+  return MessageSizeError(message);
+}
+
+// Read a non-negative millisecond/count option, keeping the default if absent
+static int64_t NonNegativeOption(Napi::Env env, Napi::Object options,
+                                 const char* name, int64_t fallback) {
+  Napi::Value value = options.Get(name);
+  if (!value.IsNumber()) {
+    return fallback;
+  }
+  int64_t n = value.As<Napi::Number>().Int64Value();
+  if (n < 0) {
+    throw Napi::RangeError::New(env, std::string(name) + " must not be negative");
+  }
+  return n;
+}
+
+/**
+ * Screen inbound messages before the full parse and signature check
+ * A streaming scan of the message element rejects unknown issuers, unexpected
+ * destinations, stale or future IssueInstants and deeply nested documents, so
+ * junk traffic never reaches the DOM and XML-DSig path. Pass null to disable.
+ * With knownKey, a KeyInfo certificate or KeyName on the message's own
+ * signature must match one of the signing keys in the issuer's metadata.
+ * @param options - { knownIssuer?: boolean, destinations?: string[],
+ *                    maxAge?: number (ms, 0 = unchecked), clockSkew?: number (ms),
+ *                    maxDepth?: number (0 = unchecked), knownKey?: boolean } or null
+ */
+Napi::Value Server::SetPrefilter(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() > 0 && info[0].IsNull()) {
+    prefilter_.reset();
+    return env.Undefined();
+  }
+
+  auto options = std::make_unique<PrefilterOptions>(DefaultPrefilterOptions());
+
+  if (info.Length() > 0 && !info[0].IsUndefined()) {
+    if (!info[0].IsObject()) {
+      throw Napi::TypeError::New(env, "options must be an object or null");
+    }
+    Napi::Object opts = info[0].As<Napi::Object>();
+
+    Napi::Value value = opts.Get("knownIssuer");
+    if (value.IsBoolean()) {
+      options->knownIssuer = value.As<Napi::Boolean>().Value();
+    }
+
+    value = opts.Get("destinations");
+    if (value.IsArray()) {
+      Napi::Array destinations = value.As<Napi::Array>();
+      for (uint32_t i = 0; i < destinations.Length(); i++) {
+        Napi::Value destination = destinations.Get(i);
+        if (!destination.IsString()) {
+          throw Napi::TypeError::New(env, "destinations must be an array of strings");
+        }
+        options->destinations.push_back(destination.As<Napi::String>().Utf8Value());
+      }
+    } else if (!value.IsUndefined()) {
+      throw Napi::TypeError::New(env, "destinations must be an array of strings");
+    }
+
+    options->maxAgeMs = NonNegativeOption(env, opts, "maxAge", options->maxAgeMs);
+    options->clockSkewMs = NonNegativeOption(env, opts, "clockSkew", options->clockSkewMs);
+    options->maxDepth = static_cast<size_t>(
+      NonNegativeOption(env, opts, "maxDepth", static_cast<int64_t>(options->maxDepth)));
+
+    value = opts.Get("knownKey");
+    if (value.IsBoolean()) {
+      options->knownKey = value.As<Napi::Boolean>().Value();
+    }
+  }
+
+  prefilter_ = std::move(options);
+  return env.Undefined();
+}
+
+/**
+ * Bound the resources an inbound document may use while it is parsed
+ * Nodes, attributes, namespace declarations and text are counted as the
+ * streaming parser produces them, and the parse stops at the first limit
+ * exceeded, before Lasso builds a tree or canonicalizes anything.
+ * Pass null to disable.
+ * @param limits - { maxDepth?, maxNodes?, maxAttributes?, maxTextSize?,
+ *                   maxNamespaces? } (0 = unchecked) or null
+ */
+Napi::Value Server::SetParserLimits(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() > 0 && info[0].IsNull()) {
+    parser_limits_.reset();
+    return env.Undefined();
+  }
+
+  auto limits = std::make_unique<ParserLimits>(DefaultParserLimits());
+
+  if (info.Length() > 0 && !info[0].IsUndefined()) {
+    if (!info[0].IsObject()) {
+      throw Napi::TypeError::New(env, "limits must be an object or null");
+    }
+    Napi::Object opts = info[0].As<Napi::Object>();
+
+    struct { const char* name; size_t* field; } fields[] = {
+      { "maxDepth", &limits->maxDepth },
+      { "maxNodes", &limits->maxNodes },
+      { "maxAttributes", &limits->maxAttributes },
+      { "maxTextSize", &limits->maxTextSize },
+      { "maxNamespaces", &limits->maxNamespaces },
+    };
+    for (const auto& field : fields) {
+      *field.field = static_cast<size_t>(
+        NonNegativeOption(env, opts, field.name, static_cast<int64_t>(*field.field)));
+    }
+  }
+
+  parser_limits_ = std::move(limits);
+  return env.Undefined();
+}
+
 /**
  * Get the entity ID of this server (IdP or SP)
  */
@@ -8,9 +8,25 @@
 #include <libxml/parser.h>
 
 #include <lasso/lasso.h>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include "attributes.h"
+#include "authn_template.h"
+#include "key_index.h"
+#include "prefilter.h"
+#include "provider_search.h"
+#include "ttl_map.h"
 
 namespace lasso_js {
 
+// Response held by the IdP until the SP resolves its artifact
+struct ArtifactEntry {
+  std::string providerId;  // SP the artifact was issued to
+  std::string message;     // Response dump
+};
+
 class Server : public Napi::ObjectWrap<Server> {
  public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports);
@@ -21,24 +37,91 @@ class Server : public Napi::ObjectWrap<Server> {
 
   LassoServer* GetServer() const { return server_; }
 
+  // Workers reading the LassoServer off the JS thread hold this shared for
+  // the duration of Execute(). Writes to the provider table, keys or
+  // signature method take it exclusively, so they wait for those workers.
+  std::shared_mutex& GetLassoLock() { return lasso_lock_; }
+
+  // Outstanding AuthnRequest IDs (null when request tracking is disabled)
+  TtlMap<std::string>* GetRequestStore() const { return request_store_.get(); }
+  bool AllowsUnsolicited() const { return allow_unsolicited_; }
+
+  // Issued HTTP-Artifact responses (created with defaults on first use)
+  TtlMap<ArtifactEntry>* GetArtifactStore();
+
+  // Screen an inbound message before Lasso parses it: the pre-filter and
+  // parser limits when enabled, otherwise the size cap alone.
+  // Returns 0 or an error code.
+  int ScreenMessage(const std::string& message);
+
+  // Compiled Redirect AuthnRequests (null when templates are disabled)
+  AuthnRequestTemplates* GetAuthnRequestTemplates() const { return authn_templates_.get(); }
+
+  // Providers were added or the signature method changed: forget compiled
+  // AuthnRequests and re-apply the per-provider signature methods
+  void ProvidersChanged();
+
+  // Signing keys of the loaded providers, checked by the pre-filter
+  KeyIndex* GetKeyIndex() { return &key_index_; }
+
+  // Discovery search over the loaded providers
+  ProviderSearchIndex* GetProviderSearch() { return &provider_search_; }
+
+  // Attribute release policy of an SP (null when it has none)
+  std::shared_ptr<const AttributeRelease> GetAttributeRelease(const char* providerId) const;
+
  private:
   static Napi::FunctionReference constructor;
 
   // Static methods
   static Napi::Value FromBuffers(const Napi::CallbackInfo& info);
+  static Napi::Value FromBuffersAsync(const Napi::CallbackInfo& info);
   static Napi::Value FromDump(const Napi::CallbackInfo& info);
+  static Napi::Value SignatureMethodsFromMetadata(const Napi::CallbackInfo& info);
 
   // Instance methods
   Napi::Value AddProvider(const Napi::CallbackInfo& info);
   Napi::Value AddProviderFromBuffer(const Napi::CallbackInfo& info);
+  Napi::Value AddProviderFromBufferAsync(const Napi::CallbackInfo& info);
+  Napi::Value AddProviders(const Napi::CallbackInfo& info);
   Napi::Value GetProvider(const Napi::CallbackInfo& info);
+  Napi::Value SearchProviders(const Napi::CallbackInfo& info);
   Napi::Value Dump(const Napi::CallbackInfo& info);
+  Napi::Value EnableRequestTracking(const Napi::CallbackInfo& info);
+  Napi::Value DisableRequestTracking(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureArtifactStore(const Napi::CallbackInfo& info);
+  Napi::Value SetPrefilter(const Napi::CallbackInfo& info);
+  Napi::Value SetParserLimits(const Napi::CallbackInfo& info);
+  Napi::Value EnableAuthnRequestTemplates(const Napi::CallbackInfo& info);
+  Napi::Value DisableAuthnRequestTemplates(const Napi::CallbackInfo& info);
+  Napi::Value SetAttributePolicy(const Napi::CallbackInfo& info);
+  Napi::Value SetSignatureMethod(const Napi::CallbackInfo& info);
+  Napi::Value SetProviderSignatureMethod(const Napi::CallbackInfo& info);
 
   // Getters
   Napi::Value GetEntityId(const Napi::CallbackInfo& info);
+  Napi::Value GetPendingRequests(const Napi::CallbackInfo& info);
+  Napi::Value GetPendingArtifacts(const Napi::CallbackInfo& info);
+  Napi::Value GetAuthnRequestTemplateCount(const Napi::CallbackInfo& info);
+  Napi::Value GetSignatureMethod(const Napi::CallbackInfo& info);
+  Napi::Value GetSearchIndexStats(const Napi::CallbackInfo& info);
+
+  int ApplyProviderSignatureMethods();
 
   LassoServer* server_;
   bool owns_server_;
+  std::shared_mutex lasso_lock_;
+  std::unique_ptr<TtlMap<std::string>> request_store_;
+  bool allow_unsolicited_;
+  std::unique_ptr<TtlMap<ArtifactEntry>> artifact_store_;
+  std::unique_ptr<PrefilterOptions> prefilter_;
+  std::unique_ptr<ParserLimits> parser_limits_;
+  std::unique_ptr<AuthnRequestTemplates> authn_templates_;
+  std::unordered_map<std::string, std::shared_ptr<const AttributeRelease>> attribute_policies_;
+  // Signature method per provider, NONE for providers following the server's
+  std::unordered_map<std::string, LassoSignatureMethod> provider_signature_methods_;
+  KeyIndex key_index_;
+  ProviderSearchIndex provider_search_;
 };
 
 } // namespace lasso_js
@@ -1,5 +1,6 @@
 #include "session.h"
 #include "utils.h"
+#include "xml_memory.h"
 
 namespace lasso_js {
 
@@ -14,6 +15,9 @@ Napi::Object Session::Init(Napi::Env env, Napi::Object exports) {
     InstanceMethod("dump", &Session::Dump),
     InstanceMethod("getAssertions", &Session::GetAssertions),
     InstanceMethod("getProviderIndex", &Session::GetProviderIndex),
+    InstanceMethod("getProviderIds", &Session::GetProviderIds),
+    InstanceMethod("getSessionIndexes", &Session::GetSessionIndexes),
+    InstanceMethod("describe", &Session::Describe),
 
     // Getters
     InstanceAccessor("isEmpty", &Session::IsEmpty, nullptr),
@@ -55,13 +59,31 @@ Napi::Object Session::NewInstance(Napi::Env env, LassoSession* session) {
   return obj;
 }
 
+Napi::Object Session::NewShared(Napi::Env env, LassoSession* session) {
+  Napi::Object obj = constructor.New({});
+  Session* wrapper = Napi::ObjectWrap<Session>::Unwrap(obj);
+
+  if (wrapper->session_) {
+    lasso_session_destroy(wrapper->session_);
+  }
+  // lasso_session_destroy() drops this reference when the wrapper goes away
+  wrapper->session_ = LASSO_SESSION(g_object_ref(session));
+  wrapper->owns_session_ = true;
+
+  return obj;
+}
+
 Session::Session(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<Session>(info), session_(nullptr), owns_session_(true) {
   // Create a new empty session
   session_ = lasso_session_new();
+  TrackObject(NativeObject::kSession, 1);
+  SyncExternalMemory(info.Env());
 }
 
 Session::~Session() {
+  TrackObject(NativeObject::kSession, -1);
+
   // Only cleanup if lasso is still initialized
   if (session_ && owns_session_ && IsLassoInitialized()) {
     lasso_session_destroy(session_);
@@ -156,6 +178,8 @@ Napi::Value Session::GetAssertions(const Napi::CallbackInfo& info) {
     }
   }
 
+  // The list holds its own references to the assertions
+  g_list_free_full(assertions, g_object_unref);
   return result;
 }
 
@@ -174,17 +198,134 @@ Napi::Value Session::GetProviderIndex(const Napi::CallbackInfo& info) {
   std::string providerId = info[0].As<Napi::String>().Utf8Value();
 
   GList* indexes = lasso_session_get_session_indexes(session_, providerId.c_str(), NULL);
-  if (!indexes || !indexes->data) {
-    return env.Null();
-  }
+  Napi::Value result = indexes && indexes->data
+                         ? Napi::Value(Napi::String::New(env, static_cast<const char*>(indexes->data)))
+                         : env.Null();
 
-  const char* index = static_cast<const char*>(indexes->data);
-  Napi::String result = Napi::String::New(env, index);
+  g_list_free_full(indexes, g_free);
+  return result;
+}
+
+// Session indexes of a provider as a JS array
+static Napi::Array SessionIndexes(Napi::Env env, LassoSession* session, const char* providerId) {
+  GList* indexes = lasso_session_get_session_indexes(session, providerId, NULL);
+  Napi::Array result = Napi::Array::New(env, g_list_length(indexes));
+
+  uint32_t i = 0;
+  for (GList* l = indexes; l != nullptr; l = l->next) {
+    if (l->data) {
+      result.Set(i++, Napi::String::New(env, static_cast<const char*>(l->data)));
+    }
+  }
 
   g_list_free_full(indexes, g_free);
   return result;
 }
 
+/**
+ * Get the providers the session holds assertions from
+ * @returns Array of provider entity IDs
+ */
+Napi::Value Session::GetProviderIds(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  Napi::Array result = Napi::Array::New(env);
+  if (!session_ || !session_->assertions) {
+    return result;
+  }
+
+  uint32_t i = 0;
+  GHashTableIter iter;
+  gpointer key;
+  g_hash_table_iter_init(&iter, session_->assertions);
+  while (g_hash_table_iter_next(&iter, &key, nullptr)) {
+    result.Set(i++, Napi::String::New(env, static_cast<const char*>(key)));
+  }
+
+  return result;
+}
+
+/**
+ * Get every session index for a provider
+ * @param providerId - Provider entity ID
+ * @returns Array of session indexes
+ */
+Napi::Value Session::GetSessionIndexes(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected providerId string as first argument");
+  }
+
+  std::string providerId = info[0].As<Napi::String>().Utf8Value();
+  return SessionIndexes(env, session_, providerId.c_str());
+}
+
+static void SetIfPresent(Napi::Object object, const char* key, const gchar* value) {
+  if (value) {
+    object.Set(key, Napi::String::New(object.Env(), value));
+  }
+}
+
+/**
+ * Describe the session from its in-memory assertions, without dumping XML
+ * @returns {Array<{ providerId, nameId, nameIdFormat?, nameQualifier?,
+ *   spNameQualifier?, sessionIndexes, authnInstant?, notOnOrAfter?,
+ *   sessionNotOnOrAfter? }>} one entry per provider
+ */
+Napi::Value Session::Describe(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  Napi::Array result = Napi::Array::New(env);
+  if (!session_ || !session_->assertions) {
+    return result;
+  }
+
+  uint32_t n = 0;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+  g_hash_table_iter_init(&iter, session_->assertions);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    const char* providerId = static_cast<const char*>(key);
+
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("providerId", Napi::String::New(env, providerId));
+    entry.Set("nameId", env.Null());
+
+    if (LASSO_IS_SAML2_ASSERTION(value)) {
+      LassoSaml2Assertion* assertion = LASSO_SAML2_ASSERTION(value);
+
+      LassoSaml2NameID* nameId = assertion->Subject ? assertion->Subject->NameID : nullptr;
+      if (LASSO_IS_SAML2_NAME_ID(nameId)) {
+        SetIfPresent(entry, "nameId", nameId->content);
+        SetIfPresent(entry, "nameIdFormat", nameId->Format);
+        SetIfPresent(entry, "nameQualifier", nameId->NameQualifier);
+        SetIfPresent(entry, "spNameQualifier", nameId->SPNameQualifier);
+      }
+
+      if (assertion->Conditions) {
+        SetIfPresent(entry, "notOnOrAfter", assertion->Conditions->NotOnOrAfter);
+      }
+
+      // Single sign-on assertions carry one AuthnStatement
+      for (GList* l = assertion->AuthnStatement; l != nullptr; l = l->next) {
+        if (LASSO_IS_SAML2_AUTHN_STATEMENT(l->data)) {
+          LassoSaml2AuthnStatement* statement = LASSO_SAML2_AUTHN_STATEMENT(l->data);
+          SetIfPresent(entry, "authnInstant", statement->AuthnInstant);
+          SetIfPresent(entry, "sessionNotOnOrAfter", statement->SessionNotOnOrAfter);
+          break;
+        }
+      }
+    }
+
+    entry.Set("sessionIndexes", SessionIndexes(env, session_, providerId));
+    result.Set(n++, entry);
+  }
+
+  return result;
+}
+
 /**
  * Check if session is empty
  */
@@ -15,11 +15,14 @@ class Session : public Napi::ObjectWrap<Session> {
  public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports);
   static Napi::Object NewInstance(Napi::Env env, LassoSession* session);
+  // Wrap a reference to session instead of a copy (the object is shared)
+  static Napi::Object NewShared(Napi::Env env, LassoSession* session);
 
   Session(const Napi::CallbackInfo& info);
   ~Session();
 
   LassoSession* GetSession() const { return session_; }
+  static bool IsInstance(const Napi::Object& obj) { return obj.InstanceOf(constructor.Value()); }
 
  private:
   static Napi::FunctionReference constructor;
@@ -31,6 +34,9 @@ class Session : public Napi::ObjectWrap<Session> {
   Napi::Value Dump(const Napi::CallbackInfo& info);
   Napi::Value GetAssertions(const Napi::CallbackInfo& info);
   Napi::Value GetProviderIndex(const Napi::CallbackInfo& info);
+  Napi::Value GetProviderIds(const Napi::CallbackInfo& info);
+  Napi::Value GetSessionIndexes(const Napi::CallbackInfo& info);
+  Napi::Value Describe(const Napi::CallbackInfo& info);
 
   // Getters
   Napi::Value IsEmpty(const Napi::CallbackInfo& info);
@@ -0,0 +1,631 @@
+#include "session_store.h"
+#include "identity.h"
+#include "login.h"
+#include "logout.h"
+#include "mapped_file.h"
+#include "session.h"
+#include "utils.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+namespace lasso_js {
+
+static const size_t DEFAULT_SHARDS = 16;
+static const size_t MAX_SHARDS = 1024;
+static const size_t DEFAULT_STORED_SESSIONS = 100000;
+static const int64_t DEFAULT_SESSION_TTL_MS = 8 * 60 * 60 * 1000; // 8 hours
+
+// Snapshot file: magic, then one record per entry. Integers are written in
+// host byte order; a snapshot is meant to be restored by the same host.
+static const char SNAPSHOT_MAGIC[8] = {'L', 'J', 'S', 'S', 'T', 'O', 'R', '1'};
+static const size_t MAX_SNAPSHOT_SIZE = static_cast<size_t>(1) << 32; // 4 GB
+
+struct SnapshotRecord {
+  uint32_t keyLength;
+  uint32_t sessionLength;
+  uint32_t identityLength;
+  uint32_t reserved;  // Explicit padding, written as zero
+  int64_t expiresMs;
+};
+
+Napi::FunctionReference SessionStore::constructor;
+
+Napi::Object SessionStore::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "SessionStore", {
+    // Instance methods
+    InstanceMethod("save", &SessionStore::Save),
+    InstanceMethod("load", &SessionStore::Load),
+    InstanceMethod("put", &SessionStore::Put),
+    InstanceMethod("get", &SessionStore::Get),
+    InstanceMethod("delete", &SessionStore::Delete),
+    InstanceMethod("sweep", &SessionStore::Sweep),
+    InstanceMethod("clear", &SessionStore::Clear),
+    InstanceMethod("snapshot", &SessionStore::Snapshot),
+    InstanceMethod("restore", &SessionStore::Restore),
+
+    // Getters
+    InstanceAccessor("size", &SessionStore::GetSize, nullptr),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("SessionStore", func);
+  return exports;
+}
+
+/**
+ * Create a session store
+ * @param options - { shards?: number, maxEntries?: number, ttl?: number (ms) }
+ */
+SessionStore::SessionStore(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<SessionStore>(info), shard_capacity_(0), ttl_ms_(DEFAULT_SESSION_TTL_MS) {
+  Napi::Env env = info.Env();
+
+  size_t shards = DEFAULT_SHARDS;
+  size_t maxEntries = DEFAULT_STORED_SESSIONS;
+
+  if (info.Length() > 0 && info[0].IsObject()) {
+    Napi::Object options = info[0].As<Napi::Object>();
+
+    Napi::Value value = options.Get("shards");
+    if (value.IsNumber()) {
+      int64_t n = value.As<Napi::Number>().Int64Value();
+      if (n <= 0 || n > static_cast<int64_t>(MAX_SHARDS)) {
+        throw Napi::RangeError::New(env, "shards must be between 1 and 1024");
+      }
+      shards = static_cast<size_t>(n);
+    }
+
+    value = options.Get("maxEntries");
+    if (value.IsNumber()) {
+      int64_t n = value.As<Napi::Number>().Int64Value();
+      if (n <= 0) {
+        throw Napi::RangeError::New(env, "maxEntries must be a positive number");
+      }
+      maxEntries = static_cast<size_t>(n);
+    }
+
+    value = options.Get("ttl");
+    if (value.IsNumber()) {
+      ttl_ms_ = value.As<Napi::Number>().Int64Value();
+      if (ttl_ms_ <= 0) {
+        throw Napi::RangeError::New(env, "ttl must be a positive number");
+      }
+    }
+  }
+
+  // Each shard holds its share of maxEntries, rounded up
+  shard_capacity_ = (maxEntries + shards - 1) / shards;
+  shards_.reserve(shards);
+  for (size_t i = 0; i < shards; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+SessionStore::~SessionStore() {
+  // Only release the objects if lasso is still initialized
+  if (!IsLassoInitialized()) {
+    return;
+  }
+
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    while (!shard->entries.empty()) {
+      EraseLocked(*shard, shard->entries.begin());
+    }
+  }
+}
+
+static int64_t NowMs() {
+  return g_get_real_time() / 1000;
+}
+
+// The LassoProfile of a Login or Logout object, null for anything else
+static LassoProfile* UnwrapProfile(const Napi::Value& value) {
+  if (!value.IsObject()) {
+    return nullptr;
+  }
+
+  Napi::Object obj = value.As<Napi::Object>();
+  if (Login::IsInstance(obj)) {
+    Login* login = Napi::ObjectWrap<Login>::Unwrap(obj);
+    login->CheckIdle(value.Env());
+    return LASSO_PROFILE(login->GetLogin());
+  }
+  if (Logout::IsInstance(obj)) {
+    return LASSO_PROFILE(Napi::ObjectWrap<Logout>::Unwrap(obj)->GetLogout());
+  }
+  return nullptr;
+}
+
+SessionStore::Shard& SessionStore::ShardFor(const std::string& key) {
+  return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+void SessionStore::EraseLocked(Shard& shard, std::unordered_map<std::string, Entry>::iterator it) {
+  lasso_session_destroy(it->second.session);
+  if (it->second.identity) {
+    lasso_identity_destroy(it->second.identity);
+  }
+  shard.lru.erase(it->second.lru);
+  shard.entries.erase(it);
+}
+
+SessionStore::Entry* SessionStore::FindLocked(Shard& shard, const std::string& key, int64_t now) {
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    return nullptr;
+  }
+
+  if (it->second.expiresMs <= now) {
+    EraseLocked(shard, it);
+    return nullptr;
+  }
+
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+  return &it->second;
+}
+
+void SessionStore::Insert(const std::string& key, LassoSession* session, LassoIdentity* identity,
+                          int64_t expiresMs) {
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  // Take the new references first: session may be the stored object itself
+  session = LASSO_SESSION(g_object_ref(session));
+  identity = identity ? LASSO_IDENTITY(g_object_ref(identity)) : nullptr;
+
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end()) {
+    EraseLocked(shard, it);
+  }
+
+  // Evict the least recently used entries of a full shard
+  while (shard.entries.size() >= shard_capacity_ && !shard.lru.empty()) {
+    EraseLocked(shard, shard.entries.find(shard.lru.back()));
+  }
+
+  shard.lru.push_front(key);
+  shard.entries.emplace(key, Entry{session, identity, expiresMs, shard.lru.begin()});
+}
+
+int64_t SessionStore::SessionExpiry(LassoSession* session, int64_t fallback) {
+  if (!session->assertions) {
+    return fallback;
+  }
+
+  int64_t latest = -1;
+  GHashTableIter iter;
+  gpointer value;
+  g_hash_table_iter_init(&iter, session->assertions);
+  while (g_hash_table_iter_next(&iter, nullptr, &value)) {
+    if (!LASSO_IS_SAML2_ASSERTION(value)) {
+      continue;
+    }
+    LassoSaml2Assertion* assertion = LASSO_SAML2_ASSERTION(value);
+
+    // Only SessionNotOnOrAfter bounds the session. Conditions/NotOnOrAfter
+    // bounds the delivery of the assertion (a few minutes), not the login
+    // it establishes, so without a session lifetime the store's ttl applies.
+    int64_t expires = -1;
+    for (GList* l = assertion->AuthnStatement; l != nullptr && expires < 0; l = l->next) {
+      if (LASSO_IS_SAML2_AUTHN_STATEMENT(l->data)) {
+        expires = ParseInstant(LASSO_SAML2_AUTHN_STATEMENT(l->data)->SessionNotOnOrAfter);
+      }
+    }
+    if (expires < 0) {
+      expires = fallback;
+    }
+    if (expires > latest) {
+      latest = expires;
+    }
+  }
+
+  return latest >= 0 ? latest : fallback;
+}
+
+/**
+ * Keep the session (and identity) of a profile after SSO or SLO
+ * The profile's objects are stored by reference. A profile left with an
+ * empty session, such as after a completed logout, removes the entry.
+ * @param key - User key
+ * @param profile - Login or Logout
+ * @returns true if the session was stored
+ */
+Napi::Value SessionStore::Save(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected key string and profile");
+  }
+
+  LassoProfile* profile = UnwrapProfile(info[1]);
+  if (!profile) {
+    throw Napi::TypeError::New(env, "Expected a Login or Logout as second argument");
+  }
+
+  std::string key = info[0].As<Napi::String>().Utf8Value();
+
+  if (!profile->session || lasso_session_is_empty(profile->session)) {
+    Shard& shard = ShardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end()) {
+      EraseLocked(shard, it);
+    }
+    return Napi::Boolean::New(env, false);
+  }
+
+  int64_t expires = SessionExpiry(profile->session, NowMs() + ttl_ms_);
+  Insert(key, profile->session, profile->identity, expires);
+  return Napi::Boolean::New(env, true);
+}
+
+/**
+ * Attach a stored session (and identity, if one was saved) to a profile
+ * The profile shares the stored objects: changes it makes to the session are
+ * seen by the store without saving again, though save() also refreshes the
+ * expiry. A stored session should not be attached to two profiles that are
+ * processed at the same time.
+ * @param key - User key
+ * @param profile - Login or Logout
+ * @returns false if no live session is stored under key
+ */
+Napi::Value SessionStore::Load(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected key string and profile");
+  }
+
+  LassoProfile* profile = UnwrapProfile(info[1]);
+  if (!profile) {
+    throw Napi::TypeError::New(env, "Expected a Login or Logout as second argument");
+  }
+
+  std::string key = info[0].As<Napi::String>().Utf8Value();
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  Entry* entry = FindLocked(shard, key, NowMs());
+  if (!entry) {
+    return Napi::Boolean::New(env, false);
+  }
+
+  if (profile->session != entry->session) {
+    if (profile->session) {
+      lasso_session_destroy(profile->session);
+    }
+    profile->session = LASSO_SESSION(g_object_ref(entry->session));
+  }
+  if (entry->identity && profile->identity != entry->identity) {
+    if (profile->identity) {
+      lasso_identity_destroy(profile->identity);
+    }
+    profile->identity = LASSO_IDENTITY(g_object_ref(entry->identity));
+  }
+
+  return Napi::Boolean::New(env, true);
+}
+
+/**
+ * Store a Session (and Identity) by reference
+ * @param key - User key
+ * @param session - Session
+ * @param identity - Identity (optional)
+ */
+Napi::Value SessionStore::Put(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()) {
+    throw Napi::TypeError::New(env, "Expected key string and Session");
+  }
+
+  std::string key = info[0].As<Napi::String>().Utf8Value();
+
+  Napi::Object sessionObj = info[1].As<Napi::Object>();
+  if (!Session::IsInstance(sessionObj)) {
+    throw Napi::TypeError::New(env, "Expected a Session as second argument");
+  }
+  Session* session = Napi::ObjectWrap<Session>::Unwrap(sessionObj);
+  if (!session || !session->GetSession()) {
+    throw Napi::TypeError::New(env, "Expected a Session as second argument");
+  }
+
+  LassoIdentity* identity = nullptr;
+  if (info.Length() > 2 && !info[2].IsUndefined() && !info[2].IsNull()) {
+    if (!info[2].IsObject() || !Identity::IsInstance(info[2].As<Napi::Object>())) {
+      throw Napi::TypeError::New(env, "Expected an Identity as third argument");
+    }
+    Identity* wrapper = Napi::ObjectWrap<Identity>::Unwrap(info[2].As<Napi::Object>());
+    identity = wrapper ? wrapper->GetIdentity() : nullptr;
+  }
+
+  int64_t expires = SessionExpiry(session->GetSession(), NowMs() + ttl_ms_);
+  Insert(key, session->GetSession(), identity, expires);
+  return env.Undefined();
+}
+
+/**
+ * Get the stored Session and Identity, sharing the stored objects
+ * @param key - User key
+ * @returns { session, identity } or null
+ */
+Napi::Value SessionStore::Get(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected key string as first argument");
+  }
+
+  std::string key = info[0].As<Napi::String>().Utf8Value();
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  Entry* entry = FindLocked(shard, key, NowMs());
+  if (!entry) {
+    return env.Null();
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("session", Session::NewShared(env, entry->session));
+  result.Set("identity", entry->identity
+                           ? Napi::Value(Identity::NewShared(env, entry->identity))
+                           : env.Null());
+  return result;
+}
+
+/**
+ * Remove a stored session
+ * @param key - User key
+ * @returns true if an entry was removed
+ */
+Napi::Value SessionStore::Delete(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected key string as first argument");
+  }
+
+  std::string key = info[0].As<Napi::String>().Utf8Value();
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    return Napi::Boolean::New(env, false);
+  }
+
+  EraseLocked(shard, it);
+  return Napi::Boolean::New(env, true);
+}
+
+/**
+ * Drop expired sessions, one shard at a time
+ * @returns Number of sessions removed
+ */
+Napi::Value SessionStore::Sweep(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  int64_t now = NowMs();
+  size_t removed = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (auto it = shard->entries.begin(); it != shard->entries.end();) {
+      auto next = std::next(it);
+      if (it->second.expiresMs <= now) {
+        EraseLocked(*shard, it);
+        removed++;
+      }
+      it = next;
+    }
+  }
+
+  return Napi::Number::New(env, static_cast<double>(removed));
+}
+
+/**
+ * Remove every stored session
+ */
+Napi::Value SessionStore::Clear(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    while (!shard->entries.empty()) {
+      EraseLocked(*shard, shard->entries.begin());
+    }
+  }
+
+  return env.Undefined();
+}
+
+Napi::Value SessionStore::GetSize(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  size_t size = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    size += shard->entries.size();
+  }
+
+  return Napi::Number::New(env, static_cast<double>(size));
+}
+
+static void AppendRecord(std::string* out, const std::string& key, const gchar* session,
+                         const gchar* identity, int64_t expiresMs) {
+  SnapshotRecord record{};
+  record.keyLength = static_cast<uint32_t>(key.size());
+  record.sessionLength = static_cast<uint32_t>(strlen(session));
+  record.identityLength = identity ? static_cast<uint32_t>(strlen(identity)) : 0;
+  record.expiresMs = expiresMs;
+
+  out->append(reinterpret_cast<const char*>(&record), sizeof(record));
+  out->append(key);
+  out->append(session, record.sessionLength);
+  if (identity) {
+    out->append(identity, record.identityLength);
+  }
+}
+
+static bool WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+/**
+ * Write the live sessions to a file, e.g. before a graceful restart
+ * The file is written next to path and renamed over it, so a crash never
+ * leaves a truncated snapshot. It holds session data and is created 0600.
+ * @param path - Snapshot file
+ * @returns Number of sessions written
+ */
+Napi::Value SessionStore::Snapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected path string as first argument");
+  }
+
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+  std::string tmpPath = path + ".tmp";
+
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    throw Napi::Error::New(env, "Cannot create " + tmpPath);
+  }
+
+  std::string buffer(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  bool ok = true;
+  size_t count = 0;
+  int64_t now = NowMs();
+
+  // Shards are dumped and written one at a time to bound the buffer
+  for (auto& shard : shards_) {
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      for (auto& item : shard->entries) {
+        const Entry& entry = item.second;
+        if (entry.expiresMs <= now) {
+          continue;
+        }
+
+        gchar* session = lasso_session_dump(entry.session);
+        gchar* identity = entry.identity ? lasso_identity_dump(entry.identity) : nullptr;
+        if (session) {
+          AppendRecord(&buffer, item.first, session, identity, entry.expiresMs);
+          count++;
+        }
+        g_free(session);
+        g_free(identity);
+      }
+    }
+
+    if (!WriteAll(fd, buffer)) {
+      ok = false;
+      break;
+    }
+    buffer.clear();
+  }
+
+  ok = ok && fsync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    throw Napi::Error::New(env, "Failed to write session snapshot " + path);
+  }
+
+  return Napi::Number::New(env, static_cast<double>(count));
+}
+
+/**
+ * Load the sessions of a snapshot file, skipping those that expired since
+ * Entries already in the store under the same key are replaced.
+ * @param path - Snapshot file
+ * @returns Number of sessions restored
+ */
+Napi::Value SessionStore::Restore(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() < 1 || !info[0].IsString()) {
+    throw Napi::TypeError::New(env, "Expected path string as first argument");
+  }
+
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+
+  MappedFile file;
+  std::string error;
+  if (!file.Open(path, MAX_SNAPSHOT_SIZE, &error)) {
+    throw Napi::Error::New(env, error);
+  }
+
+  const char* data = file.CStr();
+  size_t size = file.Size();
+  if (size < sizeof(SNAPSHOT_MAGIC) || memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+    throw Napi::Error::New(env, "Not a session snapshot: " + path);
+  }
+
+  size_t count = 0;
+  int64_t now = NowMs();
+  size_t pos = sizeof(SNAPSHOT_MAGIC);
+
+  while (pos < size) {
+    SnapshotRecord record;
+    if (size - pos < sizeof(record)) {
+      throw Napi::Error::New(env, "Truncated session snapshot: " + path);
+    }
+    memcpy(&record, data + pos, sizeof(record));
+    pos += sizeof(record);
+
+    size_t length = static_cast<size_t>(record.keyLength) + record.sessionLength +
+                    record.identityLength;
+    if (size - pos < length) {
+      throw Napi::Error::New(env, "Truncated session snapshot: " + path);
+    }
+
+    std::string key(data + pos, record.keyLength);
+    pos += record.keyLength;
+    // Lasso wants NUL-terminated dumps
+    std::string sessionDump(data + pos, record.sessionLength);
+    pos += record.sessionLength;
+    std::string identityDump(data + pos, record.identityLength);
+    pos += record.identityLength;
+
+    if (record.expiresMs <= now) {
+      continue;
+    }
+
+    LassoSession* session = lasso_session_new_from_dump(sessionDump.c_str());
+    if (!session) {
+      continue;
+    }
+    LassoIdentity* identity = identityDump.empty()
+                                ? nullptr
+                                : lasso_identity_new_from_dump(identityDump.c_str());
+
+    Insert(key, session, identity, record.expiresMs);
+    // Insert() took its own references
+    lasso_session_destroy(session);
+    if (identity) {
+      lasso_identity_destroy(identity);
+    }
+    count++;
+  }
+
+  return Napi::Number::New(env, static_cast<double>(count));
+}
+
+} // namespace lasso_js
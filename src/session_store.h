@@ -0,0 +1,97 @@
+#ifndef LASSO_SESSION_STORE_H
+#define LASSO_SESSION_STORE_H
+
+#include <napi.h>
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lasso_js {
+
+/**
+ * SessionStore - In-process store of live LassoSession / LassoIdentity objects
+ *
+ * An IdP normally keeps Session.dump() / Identity.dump() XML per user and
+ * parses it back on every SSO and SLO hop. The store keeps the parsed objects
+ * instead, keyed by a caller-chosen user key, and hands references (not
+ * copies) to Login and Logout profiles.
+ *
+ * Keys are spread over lock-striped shards, each an LRU list bounded to its
+ * share of maxEntries. An entry expires at the latest SessionNotOnOrAfter
+ * of its session's assertions; an assertion without one counts as ttl after
+ * the save. The assertions' own NotOnOrAfter only bounds their delivery and
+ * is not used. Expired entries are dropped lazily on lookup
+ * and by sweep(). The store can be snapshotted to a file and restored from it
+ * across a restart; that is the only time sessions are dumped and parsed.
+ */
+class SessionStore : public Napi::ObjectWrap<SessionStore> {
+ public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  SessionStore(const Napi::CallbackInfo& info);
+  ~SessionStore();
+
+ private:
+  static Napi::FunctionReference constructor;
+
+  struct Entry {
+    LassoSession* session;    // Owned reference
+    LassoIdentity* identity;  // Owned reference, may be null
+    int64_t expiresMs;        // Wall clock, ms since the epoch
+    std::list<std::string>::iterator lru;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  // Most recently used first
+  };
+
+  // Methods
+  Napi::Value Save(const Napi::CallbackInfo& info);
+  Napi::Value Load(const Napi::CallbackInfo& info);
+  Napi::Value Put(const Napi::CallbackInfo& info);
+  Napi::Value Get(const Napi::CallbackInfo& info);
+  Napi::Value Delete(const Napi::CallbackInfo& info);
+  Napi::Value Sweep(const Napi::CallbackInfo& info);
+  Napi::Value Clear(const Napi::CallbackInfo& info);
+  Napi::Value Snapshot(const Napi::CallbackInfo& info);
+  Napi::Value Restore(const Napi::CallbackInfo& info);
+
+  // Getters
+  Napi::Value GetSize(const Napi::CallbackInfo& info);
+
+  Shard& ShardFor(const std::string& key);
+
+  // Store new references to session and identity under key
+  void Insert(const std::string& key, LassoSession* session, LassoIdentity* identity,
+              int64_t expiresMs);
+
+  // Find a live entry and mark it most recently used, null if absent or
+  // expired. The shard must be locked.
+  Entry* FindLocked(Shard& shard, const std::string& key, int64_t now);
+
+  static void EraseLocked(Shard& shard, std::unordered_map<std::string, Entry>::iterator it);
+
+  // Expiry of a session from its assertions, fallback if it has none
+  static int64_t SessionExpiry(LassoSession* session, int64_t fallback);
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t shard_capacity_;
+  int64_t ttl_ms_;
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_SESSION_STORE_H
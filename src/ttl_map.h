@@ -0,0 +1,160 @@
+#ifndef LASSO_JS_TTL_MAP_H
+#define LASSO_JS_TTL_MAP_H
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace lasso_js {
+
+/**
+ * TtlMap - A bounded, thread-safe string-keyed map with per-entry expiry
+ *
+ * Entries are kept in insertion order. Since every entry gets the same TTL,
+ * insertion order is also expiry order, so expired entries are swept from
+ * the front in O(1) each. Lookups are O(1) on average.
+ *
+ * Put() refuses new keys while the map is full of live entries, so a flood
+ * of inserts can't push out entries still waiting to be used. Caches, where
+ * losing an entry only costs a miss, use PutEvicting() instead.
+ */
+template <typename V>
+class TtlMap {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  TtlMap(size_t capacity, std::chrono::milliseconds ttl)
+      : capacity_(capacity > 0 ? capacity : 1), ttl_(ttl) {}
+
+  // Insert or replace an entry. Returns false, leaving the map unchanged,
+  // if the key is new and the map is full of live entries.
+  bool Put(const std::string& key, V value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::time_point now = Clock::now();
+    SweepLocked(now);
+
+    if (entries_.size() >= capacity_ && entries_.find(key) == entries_.end()) {
+      return false;
+    }
+    InsertLocked(key, std::move(value), now);
+    return true;
+  }
+
+  // Insert or replace an entry, evicting the oldest one if the map is full
+  void PutEvicting(const std::string& key, V value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Clock::time_point now = Clock::now();
+    SweepLocked(now);
+
+    if (entries_.find(key) == entries_.end()) {
+      while (entries_.size() >= capacity_ && !order_.empty()) {
+        entries_.erase(order_.front());
+        order_.pop_front();
+      }
+    }
+    InsertLocked(key, std::move(value), now);
+  }
+
+  // Remove an entry and hand its value back. Returns false if the key is
+  // unknown or has expired, so each entry can be consumed at most once.
+  bool Take(const std::string& key, V* out = nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return false;
+    }
+
+    bool live = it->second.expires > Clock::now();
+    if (live && out) {
+      *out = std::move(it->second.value);
+    }
+    order_.erase(it->second.order);
+    entries_.erase(it);
+    return live;
+  }
+
+  // Copy a live entry's value out without consuming it
+  bool Get(const std::string& key, V* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.expires <= Clock::now()) {
+      return false;
+    }
+    *out = it->second.value;
+    return true;
+  }
+
+  // Check for a live entry without consuming it
+  bool Contains(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    return it != entries_.end() && it->second.expires > Clock::now();
+  }
+
+  // Drop expired entries, returns the number of entries removed
+  size_t Sweep() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return SweepLocked(Clock::now());
+  }
+
+  size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SweepLocked(Clock::now());
+    return entries_.size();
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    order_.clear();
+  }
+
+ private:
+  struct Entry {
+    V value;
+    Clock::time_point expires;
+    std::list<std::string>::iterator order;
+  };
+
+  void InsertLocked(const std::string& key, V value, Clock::time_point now) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      order_.erase(it->second.order);
+      entries_.erase(it);
+    }
+
+    order_.push_back(key);
+    Entry entry{std::move(value), now + ttl_, std::prev(order_.end())};
+    entries_.emplace(key, std::move(entry));
+  }
+
+  size_t SweepLocked(Clock::time_point now) {
+    size_t removed = 0;
+    while (!order_.empty()) {
+      auto it = entries_.find(order_.front());
+      if (it != entries_.end() && it->second.expires > now) {
+        break;
+      }
+      if (it != entries_.end()) {
+        entries_.erase(it);
+      }
+      order_.pop_front();
+      removed++;
+    }
+    return removed;
+  }
+
+  size_t capacity_;
+  std::chrono::milliseconds ttl_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<std::string> order_;
+};
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_TTL_MAP_H
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include <cstring>
 #include <sstream>
 
 namespace lasso_js {
@@ -13,7 +14,41 @@ void SetLassoInitialized(bool initialized) {
   g_lasso_initialized = initialized;
 }
 
+static const char* BindingErrorMessage(int rc) {
+  switch (rc) {
+    case LASSO_JS_ERROR_MESSAGE_TOO_LARGE:
+      return "Message too large";
+    case LASSO_JS_ERROR_UNSOLICITED_RESPONSE:
+      return "Unsolicited response rejected: missing InResponseTo";
+    case LASSO_JS_ERROR_UNKNOWN_IN_RESPONSE_TO:
+      return "InResponseTo does not match an outstanding AuthnRequest";
+    case LASSO_JS_ERROR_UNKNOWN_ISSUER:
+      return "Message rejected: unknown or missing Issuer";
+    case LASSO_JS_ERROR_WRONG_DESTINATION:
+      return "Message rejected: unexpected Destination";
+    case LASSO_JS_ERROR_STALE_ISSUE_INSTANT:
+      return "Message rejected: IssueInstant outside the accepted window";
+    case LASSO_JS_ERROR_MALFORMED_MESSAGE:
+      return "Message rejected: not a well-formed SAML message";
+    case LASSO_JS_ERROR_MESSAGE_TOO_DEEP:
+      return "Message rejected: element nesting too deep";
+    case LASSO_JS_ERROR_PARSER_LIMIT:
+      return "Message rejected: parser resource limit exceeded";
+    case LASSO_JS_ERROR_UNKNOWN_SIGNING_KEY:
+      return "Message rejected: signature KeyInfo names no key of the issuer";
+    case LASSO_JS_ERROR_STORE_FULL:
+      return "Too many unresolved artifacts";
+    default:
+      return nullptr;
+  }
+}
+
 Napi::Error LassoError(Napi::Env env, int rc, const char* context) {
+  const char* binding_msg = BindingErrorMessage(rc);
+  if (binding_msg) {
+    return Napi::Error::New(env, binding_msg);
+  }
+
   std::ostringstream msg;
   if (context) {
     msg << context << ": ";
@@ -35,6 +70,106 @@ void ThrowIfError(Napi::Env env, int rc, const char* context) {
   }
 }
 
+const char* ErrorCategory(int rc) {
+  if (rc == 0) {
+    return "ok";
+  }
+  if ((rc <= LASSO_JS_ERROR_UNKNOWN_ISSUER && rc >= LASSO_JS_ERROR_PARSER_LIMIT) ||
+      rc == LASSO_JS_ERROR_UNKNOWN_SIGNING_KEY) {
+    return "prefilter";
+  }
+  if (BindingErrorMessage(rc)) {
+    return "binding";
+  }
+
+  // Lasso groups its error codes by hundreds (see lasso/errors.h)
+  int group = -rc / 100;
+  switch (group) {
+    case 0:
+      return -rc >= 10 ? "xml" : "lasso";
+    case 1:
+      return "signature";
+    case 2:
+      return "server";
+    case 3:
+      return "logout";
+    case 4:
+      return "profile";
+    case 5:
+      return "param";
+    case 6:
+      return "login";
+    default:
+      return "lasso";
+  }
+}
+
+Napi::Object ResultObject(Napi::Env env, Napi::ObjectReference* cache, int rc) {
+  if (cache->IsEmpty()) {
+    *cache = Napi::Persistent(Napi::Object::New(env));
+    // Prevent the reference destructor from throwing during V8 shutdown
+    cache->SuppressDestruct();
+  }
+
+  Napi::Object result = cache->Value();
+  result.Set("ok", Napi::Boolean::New(env, rc == 0));
+  result.Set("code", Napi::Number::New(env, rc));
+  result.Set("category", Napi::String::New(env, ErrorCategory(rc)));
+  return result;
+}
+
+struct SignatureMethodUris {
+  LassoSignatureMethod method;
+  const char* uri;
+  const char* digestUri;
+};
+
+static const SignatureMethodUris SIGNATURE_METHODS[] = {
+  { LASSO_SIGNATURE_METHOD_RSA_SHA1, "http://www.w3.org/2000/09/xmldsig#rsa-sha1",
+    "http://www.w3.org/2000/09/xmldsig#sha1" },
+  { LASSO_SIGNATURE_METHOD_RSA_SHA256, "http://www.w3.org/2001/04/xmldsig-more#rsa-sha256",
+    "http://www.w3.org/2001/04/xmlenc#sha256" },
+  { LASSO_SIGNATURE_METHOD_RSA_SHA384, "http://www.w3.org/2001/04/xmldsig-more#rsa-sha384",
+    "http://www.w3.org/2001/04/xmldsig-more#sha384" },
+  { LASSO_SIGNATURE_METHOD_RSA_SHA512, "http://www.w3.org/2001/04/xmldsig-more#rsa-sha512",
+    "http://www.w3.org/2001/04/xmlenc#sha512" },
+};
+
+LassoSignatureMethod SignatureMethodFromUri(const char* uri) {
+  for (const SignatureMethodUris& entry : SIGNATURE_METHODS) {
+    if (uri && strcmp(uri, entry.uri) == 0) {
+      return entry.method;
+    }
+  }
+  return LASSO_SIGNATURE_METHOD_NONE;
+}
+
+const char* SignatureDigestUri(LassoSignatureMethod method) {
+  for (const SignatureMethodUris& entry : SIGNATURE_METHODS) {
+    if (entry.method == method) {
+      return entry.digestUri;
+    }
+  }
+  return nullptr;
+}
+
+int64_t ParseInstant(const char* instant) {
+  if (!instant) {
+    return -1;
+  }
+
+  GTimeZone* utc = g_time_zone_new_utc();
+  GDateTime* dt = g_date_time_new_from_iso8601(instant, utc);
+  g_time_zone_unref(utc);
+  if (!dt) {
+    return -1;
+  }
+
+  int64_t ms = g_date_time_to_unix(dt) * 1000 + g_date_time_get_microsecond(dt) / 1000;
+  g_date_time_unref(dt);
+  return ms;
+}
+
 std::string GCharToString(const gchar* str) {
   if (str == nullptr) {
     return "";
@@ -8,14 +8,47 @@
 #include <libxml/parser.h>
 
 #include <lasso/lasso.h>
+#include <cstdint>
 #include <string>
 
 namespace lasso_js {
 
+// Binding-side error codes, outside the range used by Lasso
+enum BindingError {
+  LASSO_JS_ERROR_MESSAGE_TOO_LARGE = -10001,
+  LASSO_JS_ERROR_UNSOLICITED_RESPONSE = -10002,
+  LASSO_JS_ERROR_UNKNOWN_IN_RESPONSE_TO = -10003,
+  // Pre-filter rejections (see prefilter.h)
+  LASSO_JS_ERROR_UNKNOWN_ISSUER = -10004,
+  LASSO_JS_ERROR_WRONG_DESTINATION = -10005,
+  LASSO_JS_ERROR_STALE_ISSUE_INSTANT = -10006,
+  LASSO_JS_ERROR_MALFORMED_MESSAGE = -10007,
+  LASSO_JS_ERROR_MESSAGE_TOO_DEEP = -10008,
+  LASSO_JS_ERROR_PARSER_LIMIT = -10009,
+  LASSO_JS_ERROR_UNKNOWN_SIGNING_KEY = -10010,
+  LASSO_JS_ERROR_STORE_FULL = -10011,
+};
+
 // Error handling
 Napi::Error LassoError(Napi::Env env, int rc, const char* context = nullptr);
 void ThrowIfError(Napi::Env env, int rc, const char* context = nullptr);
 
+// Coarse error category for a Lasso or binding error code ("ok" for 0)
+const char* ErrorCategory(int rc);
+
+// Fill the cached { ok, code, category } result object of a try* method.
+// The same object is returned on every call to avoid allocating per message.
+Napi::Object ResultObject(Napi::Env env, Napi::ObjectReference* cache, int rc);
+
+// Signature methods callers may select (the RSA ones). For an XML-DSig
+// SignatureMethod / SigAlg URI, NONE if it is not one of them.
+LassoSignatureMethod SignatureMethodFromUri(const char* uri);
+// DigestMethod URI Lasso pairs with a selectable method, null for others
+const char* SignatureDigestUri(LassoSignatureMethod method);
+
+// xs:dateTime as milliseconds since the epoch, or -1 if it can't be parsed
+int64_t ParseInstant(const char* instant);
+
 // String conversion helpers
 std::string GCharToString(const gchar* str);
 gchar* StringToGChar(const std::string& str);
@@ -0,0 +1,208 @@
+#include "warmup.h"
+#include "server.h"
+#include "utils.h"
+#include "codec.h"
+#include <chrono>
+#include <cstring>
+#include <string>
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/tree.h>
+#include <libxml/parser.h>
+
+#include <lasso/lasso.h>
+
+namespace lasso_js {
+
+typedef std::chrono::steady_clock Clock;
+typedef LassoNode* (*NodeConstructor)(void);
+
+static const char* WARMUP_MESSAGE_ID = "_lasso_js_warmup";
+
+// Node types used by SSO and SLO messages. Creating one instance of each
+// registers the GType and runs class_init, which builds Lasso's per-class
+// serialization tables.
+static const NodeConstructor NODE_TYPES[] = {
+  lasso_samlp2_authn_request_new,
+  lasso_samlp2_response_new,
+  lasso_samlp2_logout_request_new,
+  lasso_samlp2_logout_response_new,
+  lasso_samlp2_artifact_resolve_new,
+  lasso_samlp2_artifact_response_new,
+  lasso_samlp2_status_new,
+  lasso_samlp2_status_code_new,
+  lasso_saml2_assertion_new,
+  lasso_saml2_name_id_new,
+  lasso_saml2_subject_new,
+  lasso_saml2_subject_confirmation_new,
+  lasso_saml2_subject_confirmation_data_new,
+  lasso_saml2_conditions_new,
+  lasso_saml2_authn_statement_new,
+  lasso_saml2_attribute_statement_new,
+  lasso_saml2_attribute_new,
+  lasso_saml2_attribute_value_new,
+  lasso_saml2_encrypted_element_new,
+};
+
+// Protocol messages round-tripped through the XML parser
+static const NodeConstructor MESSAGE_TYPES[] = {
+  lasso_samlp2_authn_request_new,
+  lasso_samlp2_response_new,
+  lasso_samlp2_logout_request_new,
+  lasso_samlp2_logout_response_new,
+  lasso_samlp2_artifact_resolve_new,
+  lasso_samlp2_artifact_response_new,
+};
+
+static double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void WarmTypes(LassoServer* server) {
+  for (NodeConstructor create : NODE_TYPES) {
+    LassoNode* node = create();
+    if (node) {
+      g_object_unref(node);
+    }
+  }
+
+  // Profile objects pull in the remaining classes (and the server's)
+  g_object_unref(lasso_identity_new());
+  g_object_unref(lasso_session_new());
+  g_object_unref(lasso_login_new(server));
+  g_object_unref(lasso_logout_new(server));
+}
+
+// Serialize an empty message of each type and parse it back
+static void WarmParse() {
+  for (NodeConstructor create : MESSAGE_TYPES) {
+    LassoNode* node = create();
+    if (!node) {
+      continue;
+    }
+
+    gchar* xml = lasso_node_export_to_xml(node);
+    if (xml) {
+      xmlDoc* doc = xmlReadMemory(xml, static_cast<int>(strlen(xml)), nullptr, nullptr,
+                                  XML_PARSE_NONET);
+      if (doc) {
+        LassoNode* parsed = lasso_node_new_from_xmlNode(xmlDocGetRootElement(doc));
+        if (parsed) {
+          g_object_unref(parsed);
+        }
+        xmlFreeDoc(doc);
+      }
+      g_free(xml);
+    }
+    g_object_unref(node);
+  }
+}
+
+// A minimal AuthnRequest issued by the server itself, used as signing input
+static std::string BuildWarmupRequest(LassoServer* server) {
+  LassoNode* node = lasso_samlp2_authn_request_new();
+  LassoSamlp2RequestAbstract* request = LASSO_SAMLP2_REQUEST_ABSTRACT(node);
+  request->ID = g_strdup(WARMUP_MESSAGE_ID);
+  request->Version = g_strdup("2.0");
+  request->IssueInstant = g_strdup("2000-01-01T00:00:00Z");
+  request->Issuer = LASSO_SAML2_NAME_ID(
+    lasso_saml2_name_id_new_with_string(LASSO_PROVIDER(server)->ProviderID));
+
+  gchar* xml = lasso_node_export_to_xml(node);
+  std::string result = xml ? xml : "";
+  g_free(xml);
+  g_object_unref(node);
+  return result;
+}
+
+/**
+ * Warm up Lasso, libxml2 and xmlsec before serving traffic
+ * @param server - Server whose keys are used for the signature stages
+ * @returns {{types: number, keys: number, sign: number|null,
+ *            verify: number|null, parse: number, total: number}}
+ *   Duration of each stage in milliseconds; sign and verify are null when
+ *   the server has no private key
+ */
+Napi::Value Warmup(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!IsLassoInitialized()) {
+    throw Napi::Error::New(env, "Lasso is not initialized");
+  }
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    throw Napi::TypeError::New(env, "Expected Server as first argument");
+  }
+  Server* wrapper = Napi::ObjectWrap<Server>::Unwrap(info[0].As<Napi::Object>());
+  if (!wrapper || !wrapper->GetServer()) {
+    throw Napi::TypeError::New(env, "Invalid Server object");
+  }
+  LassoServer* server = wrapper->GetServer();
+
+  Napi::Object result = Napi::Object::New(env);
+  Clock::time_point begin = Clock::now();
+
+  Clock::time_point start = Clock::now();
+  WarmTypes(server);
+  result.Set("types", ElapsedMs(start));
+
+  // Load the key material the first signature would otherwise load
+  start = Clock::now();
+  LassoKey* key = nullptr;
+  if (server->private_key) {
+    lasso_server_get_private_key(server);
+    key = lasso_key_new_for_signature_from_file(
+      server->private_key,
+      server->private_key_password,
+      server->signature_method,
+      server->certificate
+    );
+  }
+  result.Set("keys", ElapsedMs(start));
+
+  if (key) {
+    std::string message = BuildWarmupRequest(server);
+    xmlDoc* doc = xmlReadMemory(message.data(), static_cast<int>(message.size()),
+                                nullptr, nullptr, XML_PARSE_NONET);
+    xmlNode* root = doc ? xmlDocGetRootElement(doc) : nullptr;
+
+    std::string encoded;
+    EncodeSamlMessage(message, MessageEncoding::kRedirect, &encoded);
+    std::string query = "SAMLRequest=" + encoded;
+
+    // Enveloped XML signature (POST, SOAP) and query signature (Redirect)
+    start = Clock::now();
+    bool signedXml = root && lasso_key_saml2_xml_sign(key, WARMUP_MESSAGE_ID, root);
+    char* signedQuery = lasso_key_query_sign(key, query.c_str());
+    result.Set("sign", ElapsedMs(start));
+
+    start = Clock::now();
+    int rc = signedXml && signedQuery ? 0 : LASSO_DS_ERROR_SIGNATURE_FAILED;
+    if (rc == 0) {
+      rc = lasso_key_saml2_xml_verify(key, const_cast<char*>(WARMUP_MESSAGE_ID), root);
+    }
+    if (rc == 0) {
+      rc = lasso_key_query_verify(key, signedQuery);
+    }
+    result.Set("verify", ElapsedMs(start));
+
+    g_free(signedQuery);
+    if (doc) {
+      xmlFreeDoc(doc);
+    }
+    g_object_unref(key);
+
+    ThrowIfError(env, rc, "warmup");
+  } else {
+    result.Set("sign", env.Null());
+    result.Set("verify", env.Null());
+  }
+
+  start = Clock::now();
+  WarmParse();
+  result.Set("parse", ElapsedMs(start));
+
+  result.Set("total", ElapsedMs(begin));
+  return result;
+}
+
+} // namespace lasso_js
@@ -0,0 +1,23 @@
+#ifndef LASSO_JS_WARMUP_H
+#define LASSO_JS_WARMUP_H
+
+#include <napi.h>
+
+namespace lasso_js {
+
+/**
+ * Start-up warm-up
+ *
+ * The first SSO after init() pays one-time costs: GType registration and
+ * class initialization of every Lasso node type, xmlsec/OpenSSL transform
+ * setup and first touch of the key material. warmup(server) takes those hits
+ * up front by exercising each path once against the server's own keys and
+ * reports how long every stage took.
+ */
+
+// JS bindings
+Napi::Value Warmup(const Napi::CallbackInfo& info);
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_WARMUP_H
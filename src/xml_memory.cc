@@ -0,0 +1,269 @@
+#include "xml_memory.h"
+#include "utils.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__linux__)
+#include <malloc.h>
+#endif
+
+// Include libxml2 headers before lasso.h to avoid extern "C" template conflict
+#include <libxml/xmlmemory.h>
+
+namespace lasso_js {
+
+// Bytes last reported to V8 through AdjustExternalMemory
+static std::atomic<int64_t> g_reported_bytes(0);
+
+// Only report to V8 once the drift is worth a GC heuristic update
+static const int64_t EXTERNAL_MEMORY_THRESHOLD = 256 * 1024;
+
+static std::atomic<int64_t> g_live_objects[static_cast<int>(NativeObject::kCount)];
+
+// Usable size of a malloc block (0 where the platform can't tell)
+static size_t UsableSize(void* ptr) {
+#if defined(__APPLE__)
+  return malloc_size(ptr);
+#elif defined(__linux__)
+  return malloc_usable_size(ptr);
+#else
+  (void)ptr;
+  return 0;
+#endif
+}
+
+static std::atomic<bool> g_allocator_installed(false);
+
+// ===== Per-thread libxml2 counters =====
+
+/**
+ * Each thread counts its own allocations with plain loads and stores (no
+ * locked read-modify-write on a shared cache line); readers sum the live
+ * threads plus what exited threads left behind. A block freed on another
+ * thread than the one that allocated it makes one counter go negative and
+ * the other positive, so only the sum is meaningful.
+ */
+struct ThreadCounters;
+
+struct CounterRegistry {
+  std::mutex mutex;
+  std::vector<ThreadCounters*> threads;
+  int64_t retired_bytes = 0;
+  int64_t retired_allocations = 0;
+};
+
+// Leaked on purpose: thread exit may run after static destructors
+static CounterRegistry& Registry() {
+  static CounterRegistry* registry = new CounterRegistry();
+  return *registry;
+}
+
+// Trivially destructible, so the hooks can still touch it while libxml2
+// frees its per-thread state after the C++ thread_local destructors ran
+struct ThreadCounters {
+  std::atomic<int64_t> bytes{0};
+  std::atomic<int64_t> allocations{0};
+  bool registered = false;
+  bool retired = false;
+};
+
+static thread_local ThreadCounters t_counters;
+
+// Folds the thread's counts into the registry when the thread exits
+struct CounterRetirer {
+  ~CounterRetirer() {
+    CounterRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired_bytes += t_counters.bytes.load(std::memory_order_relaxed);
+    registry.retired_allocations += t_counters.allocations.load(std::memory_order_relaxed);
+    registry.threads.erase(
+      std::find(registry.threads.begin(), registry.threads.end(), &t_counters));
+    t_counters.retired = true;
+  }
+};
+
+static thread_local CounterRetirer t_retirer;
+
+static void CountOnThread(int64_t deltaBytes, int64_t deltaAllocations) {
+  ThreadCounters& counters = t_counters;
+  if (!counters.registered) {
+    // Allocations after the thread retired its counters are not counted
+    if (counters.retired) {
+      return;
+    }
+    CounterRegistry& registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(&counters);
+    counters.registered = true;
+    (void)&t_retirer;  // Constructs it, scheduling the fold at thread exit
+  }
+
+  // Only the owning thread writes, so no atomic read-modify-write is needed
+  counters.bytes.store(counters.bytes.load(std::memory_order_relaxed) + deltaBytes,
+                       std::memory_order_relaxed);
+  counters.allocations.store(
+    counters.allocations.load(std::memory_order_relaxed) + deltaAllocations,
+    std::memory_order_relaxed);
+}
+
+static void SumCounters(int64_t* bytes, int64_t* allocations) {
+  CounterRegistry& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  *bytes = registry.retired_bytes;
+  *allocations = registry.retired_allocations;
+  for (const ThreadCounters* counters : registry.threads) {
+    *bytes += counters->bytes.load(std::memory_order_relaxed);
+    *allocations += counters->allocations.load(std::memory_order_relaxed);
+  }
+}
+
+// ===== libxml2 allocator hooks =====
+
+static void CountAlloc(void* ptr) {
+  if (ptr) {
+    CountOnThread(static_cast<int64_t>(UsableSize(ptr)), 1);
+  }
+}
+
+static void CountFree(void* ptr) {
+  CountOnThread(-static_cast<int64_t>(UsableSize(ptr)), -1);
+}
+
+static void* XmlMallocHook(size_t size) {
+  void* ptr = malloc(size);
+  CountAlloc(ptr);
+  return ptr;
+}
+
+static void XmlFreeHook(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+  CountFree(ptr);
+  free(ptr);
+}
+
+static void* XmlReallocHook(void* ptr, size_t size) {
+  if (ptr) {
+    CountFree(ptr);
+  }
+  void* resized = realloc(ptr, size);
+  // A failed realloc leaves the original block in place
+  CountAlloc(resized ? resized : (size > 0 ? ptr : nullptr));
+  return resized;
+}
+
+static char* XmlStrdupHook(const char* str) {
+  size_t len = strlen(str) + 1;
+  char* copy = static_cast<char*>(XmlMallocHook(len));
+  if (copy) {
+    memcpy(copy, str, len);
+  }
+  return copy;
+}
+
+void InstallXmlAllocator() {
+  if (g_allocator_installed.load(std::memory_order_relaxed)) {
+    return;
+  }
+  // Memory libxml2 allocated before this point came from malloc, which the
+  // hooks still hand back to free, so a late install is harmless (it only
+  // skews the byte count, which is clamped when reported)
+  xmlMemSetup(XmlFreeHook, XmlMallocHook, XmlReallocHook, XmlStrdupHook);
+  g_allocator_installed.store(true, std::memory_order_relaxed);
+}
+
+bool IsXmlAllocatorInstalled() {
+  return g_allocator_installed.load(std::memory_order_relaxed);
+}
+
+void TrackObject(NativeObject type, int delta) {
+  g_live_objects[static_cast<int>(type)].fetch_add(delta, std::memory_order_relaxed);
+}
+
+static int64_t NativeBytes() {
+  int64_t bytes = 0;
+  int64_t allocations = 0;
+  SumCounters(&bytes, &allocations);
+  return bytes > 0 ? bytes : 0;
+}
+
+void SyncExternalMemory(Napi::Env env) {
+  // Without the hooks there is nothing to report
+  if (!IsXmlAllocatorInstalled()) {
+    return;
+  }
+
+  int64_t current = NativeBytes();
+  int64_t reported = g_reported_bytes.load(std::memory_order_relaxed);
+  int64_t delta = current - reported;
+  if (delta > -EXTERNAL_MEMORY_THRESHOLD && delta < EXTERNAL_MEMORY_THRESHOLD) {
+    return;
+  }
+  // Another thread may have reported in the meantime; the next call settles it
+  if (g_reported_bytes.compare_exchange_strong(reported, current, std::memory_order_relaxed)) {
+    Napi::MemoryManagement::AdjustExternalMemory(env, delta);
+  }
+}
+
+/**
+ * Install the libxml2 allocator hooks that memoryStats() counts with and
+ * that report libxml2 memory to V8. Off by default, since every libxml2
+ * allocation then pays for a malloc_usable_size() call. libxml2 must get its
+ * allocator before its first allocation, so this has to run before init().
+ */
+Napi::Value EnableMemoryStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (IsLassoInitialized() && !IsXmlAllocatorInstalled()) {
+    throw Napi::Error::New(env, "enableMemoryStats() must be called before init()");
+  }
+
+  InstallXmlAllocator();
+  return env.Undefined();
+}
+
+/**
+ * Native memory held through libxml2 and live wrapper counts
+ * libxml2 bytes are counted by the allocator hooks, so they stay 0 unless
+ * enableMemoryStats() was called; glib allocations made by Lasso itself are
+ * not visible to them.
+ * @returns {{ enabled: boolean, xmlBytes: number, xmlAllocations: number,
+ *             externalBytes: number, objects: Record<string, number> }}
+ */
+Napi::Value MemoryStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  SyncExternalMemory(env);
+
+  int64_t bytes = 0;
+  int64_t allocations = 0;
+  SumCounters(&bytes, &allocations);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("enabled", Napi::Boolean::New(env, IsXmlAllocatorInstalled()));
+  result.Set("xmlBytes", Napi::Number::New(env, static_cast<double>(std::max<int64_t>(bytes, 0))));
+  result.Set("xmlAllocations", Napi::Number::New(env,
+    static_cast<double>(std::max<int64_t>(allocations, 0))));
+  result.Set("externalBytes", Napi::Number::New(env,
+    static_cast<double>(g_reported_bytes.load(std::memory_order_relaxed))));
+
+  static const char* names[] = { "server", "login", "logout", "identity", "session" };
+  Napi::Object objects = Napi::Object::New(env);
+  for (int i = 0; i < static_cast<int>(NativeObject::kCount); i++) {
+    objects.Set(names[i], Napi::Number::New(env,
+      static_cast<double>(g_live_objects[i].load(std::memory_order_relaxed))));
+  }
+  result.Set("objects", objects);
+
+  return result;
+}
+
+} // namespace lasso_js
@@ -0,0 +1,38 @@
+#ifndef LASSO_JS_XML_MEMORY_H
+#define LASSO_JS_XML_MEMORY_H
+
+#include <napi.h>
+#include <cstddef>
+
+namespace lasso_js {
+
+// Route libxml2 allocations through the binding's counting hooks. Only done
+// when memory stats are enabled, and before lasso_init() (libxml2 requires its
+// allocator to be set before the first allocation).
+void InstallXmlAllocator();
+bool IsXmlAllocatorInstalled();
+
+// Wrapper types whose live instances are counted in memoryStats()
+enum class NativeObject {
+  kServer,
+  kLogin,
+  kLogout,
+  kIdentity,
+  kSession,
+  kCount,
+};
+
+void TrackObject(NativeObject type, int delta);
+
+// Report native heap growth or shrinkage since the last call to V8, so GC
+// pressure reflects the memory held by wrappers. Call on the JS thread; a
+// no-op unless memory stats are enabled.
+void SyncExternalMemory(Napi::Env env);
+
+// JS bindings
+Napi::Value EnableMemoryStats(const Napi::CallbackInfo& info);
+Napi::Value MemoryStats(const Napi::CallbackInfo& info);
+
+} // namespace lasso_js
+
+#endif // LASSO_JS_XML_MEMORY_H
@@ -1,23 +1,78 @@
+import * as crypto from "crypto";
 import * as fs from "fs";
+import * as http from "http";
+import * as os from "os";
 import * as path from "path";
+import * as zlib from "zlib";
 import {
   init,
   shutdown,
   checkVersion,
   isInitialized,
+  decodeMessage,
+  encodeMessage,
+  enableMemoryStats,
+  memoryStats,
+  setLogCapture,
+  drainLogs,
+  logStats,
+  warmup,
   Server,
   Login,
   Logout,
   Identity,
   Session,
+  SessionStore,
+  NameIdGenerator,
   HttpMethod,
   NameIdFormat,
+  SignatureMethod,
+  ErrorCode,
+  SoapClient,
+  resolveArtifact,
+  soapSingleLogout,
 } from "../dist";
 
 const fixturesDir = path.join(__dirname, "fixtures");
+const readFixture = (name: string) => fs.readFileSync(path.join(fixturesDir, name), "utf-8");
+
+type ServerInstance = ReturnType<typeof Server.fromBuffers>;
+
+// Metadata of an SP like the fixture one, under another entity ID and with a
+// SOAP SingleLogoutService
+function spMetadataFor(entityId: string): string {
+  return readFixture("sp-metadata.xml")
+    .replace(/https:\/\/sp\.example\.com/g, entityId)
+    .replace(
+      "<SingleLogoutService ",
+      `<SingleLogoutService Binding="urn:oasis:names:tc:SAML:2.0:bindings:SOAP"
+                         Location="${entityId}/saml/soap"/>
+    <SingleLogoutService `,
+    );
+}
+
+// IdP half of an SSO: the SP sends a Redirect AuthnRequest and the IdP
+// answers with a POST Response, which the SP still has to process
+function idpSso(idp: ServerInstance, sp: ServerInstance, idpSession?: Session | null) {
+  const spLogin = new Login(sp);
+  spLogin.initAuthnRequest("https://idp.example.com", HttpMethod.REDIRECT);
+  const request = spLogin.buildAuthnRequestMsg();
+
+  const idpLogin = new Login(idp);
+  if (idpSession) {
+    idpLogin.session = idpSession;
+  }
+  idpLogin.processAuthnRequestMsg(request.responseUrl!.split("?")[1]);
+  idpLogin.validateRequestMsg();
+  idpLogin.setNameId("user@example.com", NameIdFormat.EMAIL);
+  idpLogin.buildAssertion();
+
+  return { spLogin, idpLogin, request, response: idpLogin.buildResponseMsg() };
+}
 
 describe("lasso.js", () => {
   beforeAll(() => {
+    enableMemoryStats();
     init();
   });
 
@@ -34,6 +89,86 @@ describe("lasso.js", () => {
     test("isInitialized returns true after init", () => {
       expect(isInitialized()).toBe(true);
     });
+
+    test("memoryStats counts libxml2 memory and live wrappers", () => {
+      const before = memoryStats();
+      const identity = new Identity();
+      const session = new Session();
+      const after = memoryStats();
+
+      expect(after.enabled).toBe(true);
+      expect(after.objects.identity).toBe(before.objects.identity + 1);
+      expect(after.objects.session).toBe(before.objects.session + 1);
+      expect(after.xmlBytes).toBeGreaterThanOrEqual(0);
+      expect(after.xmlAllocations).toBeGreaterThanOrEqual(0);
+      expect(after.externalBytes).toBeGreaterThanOrEqual(0);
+      expect(identity.isEmpty && session.isEmpty).toBe(true);
+    });
+
+    test("memoryStats counts libxml2 allocations made on worker threads", async () => {
+      const server = Server.fromBuffers(readFixture("sp-metadata.xml"));
+      const before = memoryStats();
+
+      // Metadata parsed on the thread pool, kept alive by the server
+      await server.addProviderFromBufferAsync("https://idp.example.com", readFixture("idp-metadata.xml"));
+      const after = memoryStats();
+      expect(after.xmlAllocations).toBeGreaterThan(before.xmlAllocations);
+      expect(after.xmlBytes).toBeGreaterThan(before.xmlBytes);
+    });
+
+    test("enableMemoryStats is idempotent once installed", () => {
+      expect(() => enableMemoryStats()).not.toThrow();
+      expect(memoryStats().enabled).toBe(true);
+    });
+
+    test("log capture can be enabled, drained and disabled", () => {
+      setLogCapture({ rateLimit: 10 });
+      try {
+        expect(logStats().capturing).toBe(true);
+
+        // Lasso warns about messages it cannot parse
+        const server = Server.fromBuffers(
+          fs.readFileSync(path.join(fixturesDir, "sp-metadata.xml"), "utf-8"),
+          fs.readFileSync(path.join(fixturesDir, "sp-key.pem"), "utf-8"),
+          fs.readFileSync(path.join(fixturesDir, "sp-cert.pem"), "utf-8")
+        );
+        for (let i = 0; i < 50; i++) {
+          new Login(server).tryProcessResponseMsg(Buffer.from("<x/>").toString("base64"));
+        }
+
+        const stats = logStats();
+        const records = drainLogs();
+        expect(records.length).toBeLessThanOrEqual(stats.pending);
+        for (const record of records) {
+          expect(typeof record.message).toBe("string");
+          expect(typeof record.domain).toBe("string");
+          expect(record.time).toBeGreaterThan(0);
+        }
+        expect(logStats().pending).toBe(0);
+      } finally {
+        setLogCapture(null);
+      }
+      expect(logStats().capturing).toBe(false);
+    });
+
+    test("warmup reports stage timings", () => {
+      const server = Server.fromBuffers(
+        fs.readFileSync(path.join(fixturesDir, "idp-metadata.xml"), "utf-8"),
+        fs.readFileSync(path.join(fixturesDir, "idp-key.pem"), "utf-8"),
+        fs.readFileSync(path.join(fixturesDir, "idp-cert.pem"), "utf-8")
+      );
+      const timings = warmup(server);
+
+      for (const stage of ["types", "keys", "sign", "verify", "parse", "total"] as const) {
+        expect(timings[stage]).toBeGreaterThanOrEqual(0);
+      }
+      expect(() => warmup({} as never)).toThrow();
+    });
+
+    test("drainLogs rejects invalid limits", () => {
+      expect(() => drainLogs(0)).toThrow();
+      expect(() => setLogCapture({ rateLimit: -1 })).toThrow();
+    });
   });
 
   describe("Constants", () => {
@@ -56,6 +191,34 @@ describe("lasso.js", () => {
     });
   });
 
+  describe("Message codec", () => {
+    const xml =
+      '<samlp:AuthnRequest xmlns:samlp="urn:oasis:names:tc:SAML:2.0:protocol" ID="_abc"/>';
+
+    test("round-trips the POST binding", () => {
+      const encoded = encodeMessage(xml, HttpMethod.POST);
+      expect(encoded).toBe(Buffer.from(xml).toString("base64"));
+      expect(decodeMessage(encoded)).toBe(xml);
+    });
+
+    test("round-trips the Redirect binding", () => {
+      const encoded = encodeMessage(xml, HttpMethod.REDIRECT);
+      expect(decodeMessage(`SAMLRequest=${encoded}&RelayState=x`)).toBe(xml);
+      expect(decodeMessage(`https://idp.example.com/sso?SAMLRequest=${encoded}`)).toBe(xml);
+      // A '?' inside a value does not start the query
+      expect(decodeMessage(`SAMLRequest=${encoded}&RelayState=/a?b=c`)).toBe(xml);
+    });
+
+    test("rejects messages inflating past maxSize", () => {
+      const encoded = encodeMessage("<a>" + "x".repeat(1024 * 1024) + "</a>", HttpMethod.REDIRECT);
+      expect(() => decodeMessage(`SAMLRequest=${encoded}`, 64 * 1024)).toThrow(/too large/);
+    });
+
+    test("rejects invalid base64", () => {
+      expect(() => decodeMessage("not*base64")).toThrow();
+    });
+  });
+
   describe("Identity", () => {
     test("can create new Identity", () => {
       const identity = new Identity();
@@ -92,6 +255,150 @@ describe("lasso.js", () => {
         expect(restored.isEmpty).toBe(true);
       }
     });
+
+    test("empty Session describes no providers", () => {
+      const session = new Session();
+      expect(session.describe()).toEqual([]);
+      expect(session.getProviderIds()).toEqual([]);
+      expect(session.getSessionIndexes("https://sp.example.com")).toEqual([]);
+      expect(session.getProviderIndex("https://sp.example.com")).toBeNull();
+    });
+
+    test("getSessionIndexes requires a provider ID", () => {
+      const session = new Session();
+      expect(() => session.getSessionIndexes(undefined as never)).toThrow(TypeError);
+    });
+  });
+
+  describe("NameIdGenerator", () => {
+    const secret = "0123456789abcdef0123456789abcdef";
+    const sp = "https://sp.example.com/metadata";
+
+    test("generates stable opaque NameIDs per user and SP", () => {
+      const generator = new NameIdGenerator(secret);
+      const nameId = generator.generate("alice", sp);
+
+      expect(nameId).toMatch(/^[A-Za-z0-9_-]{43}$/);
+      expect(generator.generate("alice", sp)).toBe(nameId);
+      expect(new NameIdGenerator(Buffer.from(secret)).generate("alice", sp)).toBe(nameId);
+      expect(generator.generate("bob", sp)).not.toBe(nameId);
+      expect(generator.generate("alice", "https://other.example.com")).not.toBe(nameId);
+      expect(new NameIdGenerator(secret + "x").generate("alice", sp)).not.toBe(nameId);
+    });
+
+    test("resolves and forgets generated NameIDs", () => {
+      const generator = new NameIdGenerator(secret);
+      const nameId = generator.generate("alice", sp);
+
+      expect(generator.resolve(nameId, sp)).toBe("alice");
+      expect(generator.resolve(nameId, "https://other.example.com")).toBeNull();
+      expect(generator.forget(nameId, sp)).toBe(true);
+      expect(generator.resolve(nameId, sp)).toBeNull();
+    });
+
+    test("generates batches matching generate()", () => {
+      const generator = new NameIdGenerator(secret);
+      const batch = generator.generateBatch([["alice", sp], ["bob", sp]]);
+
+      expect(batch).toEqual([generator.generate("alice", sp), generator.generate("bob", sp)]);
+      expect(() => generator.generateBatch([["alice"]] as never)).toThrow(TypeError);
+    });
+
+    test("rejects short secrets", () => {
+      expect(() => new NameIdGenerator("short")).toThrow(RangeError);
+    });
+  });
+
+  describe("SessionStore", () => {
+    test("stores sessions by reference", () => {
+      const store = new SessionStore({ shards: 4 });
+      const session = new Session();
+      const identity = new Identity();
+
+      store.put("alice", session, identity);
+      expect(store.size).toBe(1);
+
+      const entry = store.get("alice");
+      expect(entry).not.toBeNull();
+      expect(entry!.session.dump()).toBe(session.dump());
+      expect(entry!.identity).not.toBeNull();
+
+      expect(store.get("bob")).toBeNull();
+      expect(store.delete("alice")).toBe(true);
+      expect(store.delete("alice")).toBe(false);
+      expect(store.size).toBe(0);
+    });
+
+    test("evicts the least recently used session of a full store", () => {
+      const store = new SessionStore({ shards: 1, maxEntries: 2 });
+      store.put("a", new Session());
+      store.put("b", new Session());
+      store.get("a");
+      store.put("c", new Session());
+
+      expect(store.size).toBe(2);
+      expect(store.get("a")).not.toBeNull();
+      expect(store.get("b")).toBeNull();
+    });
+
+    test("snapshots and restores sessions", () => {
+      const file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "lasso-")), "sessions.bin");
+      const store = new SessionStore();
+      store.put("alice", new Session());
+      store.put("bob", new Session(), new Identity());
+
+      expect(store.snapshot(file)).toBe(2);
+      expect(fs.statSync(file).mode & 0o777).toBe(0o600);
+
+      const restored = new SessionStore();
+      expect(restored.restore(file)).toBe(2);
+      expect(restored.get("bob")!.identity).not.toBeNull();
+      expect(restored.sweep()).toBe(0);
+
+      fs.writeFileSync(file, "not a snapshot");
+      expect(() => restored.restore(file)).toThrow();
+      fs.rmSync(path.dirname(file), { recursive: true });
+    });
+
+    test("validates arguments", () => {
+      expect(() => new SessionStore({ shards: 0 })).toThrow(RangeError);
+      expect(() => new SessionStore({ maxEntries: -1 })).toThrow(RangeError);
+      const store = new SessionStore();
+      expect(() => store.save("alice", {} as never)).toThrow(TypeError);
+      expect(() => store.load("alice", new Session() as never)).toThrow(TypeError);
+      expect(() => store.put("alice", new Identity() as never)).toThrow(TypeError);
+      expect(() => store.put("alice", new Session(), new Session() as never)).toThrow(TypeError);
+      expect(store.size).toBe(0);
+    });
+
+    test("keeps an SSO session for ttl when the IdP gives no SessionNotOnOrAfter", async () => {
+      const idp = Server.fromBuffers(
+        readFixture("idp-metadata.xml"),
+        readFixture("idp-key.pem"),
+        readFixture("idp-cert.pem"),
+      );
+      idp.addProviderFromBuffer("https://sp.example.com", readFixture("sp-metadata.xml"));
+      const sp = Server.fromBuffers(
+        readFixture("sp-metadata.xml"),
+        readFixture("sp-key.pem"),
+        readFixture("sp-cert.pem"),
+      );
+      sp.addProviderFromBuffer("https://idp.example.com", readFixture("idp-metadata.xml"));
+
+      // The assertion's Conditions/NotOnOrAfter is minutes away, the ttl is not
+      const store = new SessionStore({ ttl: 50 });
+      const { idpLogin } = idpSso(idp, sp);
+      expect(store.save("alice", idpLogin)).toBe(true);
+
+      const logout = new Logout(idp);
+      expect(store.load("alice", logout)).toBe(true);
+      expect(logout.session!.getProviderIds()).toEqual(["https://sp.example.com"]);
+      expect(store.sweep()).toBe(0);
+
+      await new Promise((resolve) => setTimeout(resolve, 100));
+      expect(store.sweep()).toBe(1);
+      expect(store.load("alice", new Logout(idp))).toBe(false);
+    });
   });
 
   describe("Server", () => {
@@ -125,6 +432,174 @@ describe("lasso.js", () => {
       expect(server.entityId).toBe("https://idp.example.com");
     });
 
+    test("signature method can be set server-wide and per provider", () => {
+      const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      server.addProviderFromBuffer("https://sp.example.com", spMetadata);
+
+      server.setSignatureMethod(SignatureMethod.RSA_SHA512);
+      expect(server.signatureMethod).toBe(SignatureMethod.RSA_SHA512);
+
+      server.setProviderSignatureMethod("https://sp.example.com", SignatureMethod.RSA_SHA384);
+      server.setProviderSignatureMethod("https://sp.example.com", null);
+      // Applied once a provider with this ID is added
+      server.setProviderSignatureMethod("https://other.example.com", SignatureMethod.RSA_SHA1);
+
+      // HMAC and DSA (and unknown values) are not selectable
+      expect(() => server.setSignatureMethod(3 as SignatureMethod)).toThrow(TypeError);
+      expect(() => server.setSignatureMethod(42 as SignatureMethod)).toThrow(TypeError);
+      expect(server.signatureMethod).toBe(SignatureMethod.RSA_SHA512);
+    });
+
+    test("chosen signature methods are used on the wire and verify at the other end", () => {
+      const idp = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      idp.addProviderFromBuffer("https://sp.example.com", readFixture("sp-metadata.xml"));
+      const sp = Server.fromBuffers(
+        readFixture("sp-metadata.xml"),
+        readFixture("sp-key.pem"),
+        readFixture("sp-cert.pem"),
+      );
+      sp.addProviderFromBuffer("https://idp.example.com", idpMetadata);
+
+      const xmldsigMore = "http://www.w3.org/2001/04/xmldsig-more#";
+      sp.setSignatureMethod(SignatureMethod.RSA_SHA512);
+      idp.setSignatureMethod(SignatureMethod.RSA_SHA256);
+      idp.setProviderSignatureMethod("https://sp.example.com", SignatureMethod.RSA_SHA384);
+
+      // The IdP verifies the signed AuthnRequest query while processing it
+      const { spLogin, request, response } = idpSso(idp, sp);
+
+      const query = request.responseUrl.split("?")[1];
+      const params = new URLSearchParams(query);
+      expect(params.get("SigAlg")).toBe(`${xmldsigMore}rsa-sha512`);
+      expect(params.get("Signature")).toBeTruthy();
+
+      // Swapping SigAlg breaks the query signature
+      const tampered = query.replace(encodeURIComponent(`${xmldsigMore}rsa-sha512`),
+        encodeURIComponent(`${xmldsigMore}rsa-sha256`));
+      expect(tampered).not.toBe(query);
+      expect(() => new Login(idp).processAuthnRequestMsg(tampered)).toThrow();
+
+      // Every XML signature of the Response uses the SP's own method, not the server's
+      const xml = Buffer.from(response.responseBody!, "base64").toString("utf-8");
+      const methods = [...xml.matchAll(/SignatureMethod Algorithm="([^"]+)"/g)].map((m) => m[1]);
+      expect(methods.length).toBeGreaterThan(0);
+      expect(new Set(methods)).toEqual(new Set([`${xmldsigMore}rsa-sha384`]));
+
+      spLogin.processResponseMsg(response.responseBody!);
+      spLogin.acceptSso();
+      expect(spLogin.nameId).toBe("user@example.com");
+    });
+
+    test("searchProviders finds providers by display name, scope and entity ID", () => {
+      const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      const withDiscovery = (entityId: string, uiInfo: string, scope: string) =>
+        idpMetadata
+          .replace('entityID="https://idp.example.com"', `entityID="${entityId}"`)
+          .replace(
+            /(<IDPSSODescriptor[^>]*>)/,
+            '$1<Extensions xmlns:mdui="urn:oasis:names:tc:SAML:metadata:ui" ' +
+              `xmlns:shibmd="urn:mace:shibboleth:metadata:1.0"><shibmd:Scope regexp="false">${scope}</shibmd:Scope>` +
+              `<mdui:UIInfo>${uiInfo}</mdui:UIInfo></Extensions>`
+          );
+
+      server.addProviderFromBuffer(
+        "https://idp.uni-muenchen.de",
+        withDiscovery(
+          "https://idp.uni-muenchen.de",
+          '<mdui:DisplayName xml:lang="de">Universität München</mdui:DisplayName>' +
+            '<mdui:DisplayName xml:lang="en">LMU Munich</mdui:DisplayName>' +
+            '<mdui:Keywords xml:lang="en">bavaria research+university</mdui:Keywords>',
+          "lmu.de"
+        )
+      );
+      server.addProviderFromBuffer(
+        "https://login.example.edu",
+        withDiscovery(
+          "https://login.example.edu",
+          '<mdui:DisplayName xml:lang="en">Example College</mdui:DisplayName>',
+          "example.edu"
+        )
+      );
+      server.addProviderFromBuffer("https://sp.example.com", spMetadata);
+
+      expect(server.searchProviders("univers")[0]).toEqual([
+        "https://idp.uni-muenchen.de",
+        "LMU Munich",
+        expect.any(Number),
+      ]);
+      expect(server.searchProviders("munchen")[0][0]).toBe("https://idp.uni-muenchen.de");
+      expect(server.searchProviders("colege")[0][0]).toBe("https://login.example.edu");
+      expect(server.searchProviders("alice@cs.example.edu")[0][0]).toBe("https://login.example.edu");
+      expect(server.searchProviders("https://login.example.edu")[0][0]).toBe("https://login.example.edu");
+      expect(server.searchProviders("lmu college")).toEqual([]);
+      expect(server.searchProviders("example", { role: "idp" }).map(([id]) => id)).not.toContain(
+        "https://sp.example.com"
+      );
+      expect(server.searchProviders("example", { limit: 1 })).toHaveLength(1);
+      expect(() => server.searchProviders("x", { limit: 0 })).toThrow(RangeError);
+    });
+
+    test("searchProviders forgets the old metadata of a provider added again", () => {
+      const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      const named = (name: string) =>
+        idpMetadata
+          .replace('entityID="https://idp.example.com"', 'entityID="https://idp.uni.example"')
+          .replace(
+            /(<IDPSSODescriptor[^>]*>)/,
+            '$1<Extensions xmlns:mdui="urn:oasis:names:tc:SAML:metadata:ui" ' +
+              'xmlns:shibmd="urn:mace:shibboleth:metadata:1.0">' +
+              `<shibmd:Scope regexp="false">${name.toLowerCase()}.example</shibmd:Scope>` +
+              `<mdui:UIInfo><mdui:DisplayName xml:lang="en">${name}</mdui:DisplayName></mdui:UIInfo>` +
+              "</Extensions>"
+          );
+
+      server.addProviderFromBuffer("https://idp.uni.example", named("Alpha"));
+      const initial = server.searchIndexStats;
+      expect(initial.providers).toBe(1);
+
+      // Metadata refreshes: the index stays the size of one provider
+      const names = ["Bravo", "Charlie", "Delta", "Echo", "Foxtrot", "Golf", "Hotel", "India"];
+      for (const name of names) {
+        server.addProviderFromBuffer("https://idp.uni.example", named(name));
+      }
+      const stats = server.searchIndexStats;
+      expect(stats.providers).toBe(1);
+      expect(stats.documents).toBeLessThanOrEqual(2);
+      expect(stats.postings).toBeLessThanOrEqual(initial.postings * 2);
+      expect(stats.domains).toBeLessThanOrEqual(2);
+
+      expect(server.searchProviders("india")).toEqual([
+        ["https://idp.uni.example", "India", expect.any(Number)],
+      ]);
+      expect(server.searchProviders("user@india.example")).toHaveLength(1);
+      expect(server.searchProviders("alpha")).toEqual([]);
+      expect(server.searchProviders("user@hotel.example")).toEqual([]);
+    });
+
+    test("signatureMethodsFromMetadata reads algorithm support hints", () => {
+      const metadata = (extensions: string) =>
+        `<md:EntityDescriptor xmlns:md="urn:oasis:names:tc:SAML:2.0:metadata" ` +
+        `xmlns:alg="urn:oasis:names:tc:SAML:metadata:algsupport" entityID="https://sp.example.com">` +
+        `<md:Extensions>${extensions}</md:Extensions></md:EntityDescriptor>`;
+      const signing = (uri: string) => `<alg:SigningMethod Algorithm="${uri}"/>`;
+      const digest = (uri: string) => `<alg:DigestMethod Algorithm="${uri}"/>`;
+
+      const ecdsa = signing("http://www.w3.org/2001/04/xmldsig-more#ecdsa-sha256");
+      const rsa512 = signing("http://www.w3.org/2001/04/xmldsig-more#rsa-sha512");
+      const rsa256 = signing("http://www.w3.org/2001/04/xmldsig-more#rsa-sha256");
+
+      expect(Server.signatureMethodsFromMetadata(metadata(ecdsa + rsa512 + rsa256))).toEqual([
+        SignatureMethod.RSA_SHA512,
+        SignatureMethod.RSA_SHA256,
+      ]);
+      expect(
+        Server.signatureMethodsFromMetadata(
+          metadata(rsa512 + rsa256 + digest("http://www.w3.org/2001/04/xmlenc#sha256")),
+        ),
+      ).toEqual([SignatureMethod.RSA_SHA256]);
+      expect(Server.signatureMethodsFromMetadata(spMetadata)).toEqual([]);
+    });
+
     test("can add provider to Server", () => {
       const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
       server.addProviderFromBuffer("https://sp.example.com", spMetadata);
@@ -134,6 +609,70 @@ describe("lasso.js", () => {
       expect(provider?.entityId).toBe("https://sp.example.com");
     });
 
+    test("can create Server and add providers asynchronously", async () => {
+      const server = await Server.fromBuffersAsync(idpMetadata, idpKey, idpCert);
+      expect(server.entityId).toBe("https://idp.example.com");
+
+      const pending = server.addProviderFromBufferAsync("https://sp.example.com", spMetadata);
+      expect(server.getProvider("https://sp.example.com")).toBeNull();
+      await pending;
+      expect(server.getProvider("https://sp.example.com")?.entityId).toBe("https://sp.example.com");
+    });
+
+    test("async factories reject invalid input", async () => {
+      await expect(Server.fromBuffersAsync("<bad/>", idpKey, idpCert)).rejects.toThrow();
+      expect(() => Server.fromBuffersAsync(idpMetadata, idpKey)).toThrow();
+
+      const server = await Server.fromBuffersAsync(idpMetadata, idpKey, idpCert);
+      await expect(server.addProviderFromBufferAsync("x", "<bad/>")).rejects.toThrow();
+    });
+
+    test("can add a batch of providers from files", async () => {
+      const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      const ids = await server.addProviders([
+        {
+          metadataPath: path.join(fixturesDir, "sp-metadata.xml"),
+          publicKeyPath: path.join(fixturesDir, "sp-cert.pem"),
+        },
+      ]);
+
+      expect(ids).toEqual(["https://sp.example.com"]);
+      expect(server.getProvider("https://sp.example.com")?.entityId).toBe("https://sp.example.com");
+      await expect(server.addProviders([])).resolves.toEqual([]);
+    });
+
+    test("addProviders adds nothing when one entry fails", async () => {
+      const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      await expect(
+        server.addProviders([
+          { metadataPath: path.join(fixturesDir, "sp-metadata.xml") },
+          { metadataPath: path.join(fixturesDir, "missing.xml") },
+        ]),
+      ).rejects.toThrow(/missing\.xml/);
+      expect(server.getProvider("https://sp.example.com")).toBeNull();
+
+      expect(() => server.addProviders([{} as never])).toThrow(TypeError);
+    });
+
+    test("addProviders checks the whole batch before adding any", async () => {
+      const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
+      const dir = fs.mkdtempSync(path.join(os.tmpdir(), "lasso-providers-"));
+      const sp2Path = path.join(dir, "sp2-metadata.xml");
+      fs.writeFileSync(sp2Path, spMetadataFor("https://sp2.example.com"));
+      const spPath = path.join(fixturesDir, "sp-metadata.xml");
+
+      try {
+        await expect(
+          server.addProviders([{ metadataPath: sp2Path }, { metadataPath: spPath }, { metadataPath: spPath }]),
+        ).rejects.toThrow(/Duplicate entityID https:\/\/sp\.example\.com/);
+        expect(server.getProvider("https://sp2.example.com")).toBeNull();
+        expect(server.getProvider("https://sp.example.com")).toBeNull();
+        expect(server.searchProviders("sp2")).toEqual([]);
+      } finally {
+        fs.rmSync(dir, { recursive: true, force: true });
+      }
+    });
+
     test("can dump and restore Server", () => {
       const server = Server.fromBuffers(idpMetadata, idpKey, idpCert);
       const dump = server.dump();
@@ -188,6 +727,621 @@ describe("lasso.js", () => {
       login.relayState = "https://app.example.com/dashboard";
       expect(login.relayState).toBe("https://app.example.com/dashboard");
     });
+
+    test("can dump a login and resume it after the login page", () => {
+      const read = (name: string) => fs.readFileSync(path.join(fixturesDir, name), "utf-8");
+      const spServer = Server.fromBuffers(read("sp-metadata.xml"), read("sp-key.pem"), read("sp-cert.pem"));
+      spServer.addProviderFromBuffer("https://idp.example.com", read("idp-metadata.xml"));
+
+      const sp = new Login(spServer);
+      sp.initAuthnRequest("https://idp.example.com", HttpMethod.REDIRECT);
+      const request = sp.buildAuthnRequestMsg();
+
+      const login = new Login(server);
+      login.processAuthnRequestMsg(request.responseUrl!.split("?")[1]);
+      login.relayState = "https://app.example.com/dashboard";
+
+      const resumed = Login.fromDump(server, login.dump());
+      expect(resumed.remoteProviderId).toBe("https://sp.example.com");
+      expect(resumed.requestId).toBe(request.requestId);
+      expect(resumed.relayState).toBe("https://app.example.com/dashboard");
+
+      resumed.validateRequestMsg();
+      resumed.setNameId("user@example.com", NameIdFormat.EMAIL);
+      resumed.buildAssertion();
+      expect(resumed.buildResponseMsg().responseBody).toBeTruthy();
+    });
+
+    test("can dump a login for an unsigned AuthnRequest", () => {
+      const read = (name: string) => fs.readFileSync(path.join(fixturesDir, name), "utf-8");
+      const spServer = Server.fromBuffers(read("sp-metadata.xml"), read("sp-key.pem"), read("sp-cert.pem"));
+      spServer.addProviderFromBuffer("https://idp.example.com", read("idp-metadata.xml"));
+
+      const sp = new Login(spServer);
+      sp.initAuthnRequest("https://idp.example.com", HttpMethod.REDIRECT);
+      const request = sp.buildAuthnRequestMsg();
+      // The IdP does not want signed requests (WantAuthnRequestsSigned="false")
+      const unsigned = request
+        .responseUrl!.split("?")[1]
+        .split("&")
+        .filter((param) => !param.startsWith("SigAlg=") && !param.startsWith("Signature="))
+        .join("&");
+
+      const login = new Login(server);
+      login.processAuthnRequestMsg(unsigned);
+
+      const resumed = Login.fromDump(server, login.dump());
+      expect(resumed.requestId).toBe(request.requestId);
+      resumed.validateRequestMsg();
+      resumed.setNameId("user@example.com", NameIdFormat.EMAIL);
+      resumed.buildAssertion();
+      expect(resumed.buildResponseMsg().responseBody).toBeTruthy();
+    });
+
+    test("setAttributes follows the SP's attribute release policy", () => {
+      const read = (name: string) => fs.readFileSync(path.join(fixturesDir, name), "utf-8");
+      const spServer = Server.fromBuffers(read("sp-metadata.xml"), read("sp-key.pem"), read("sp-cert.pem"));
+      spServer.addProviderFromBuffer("https://idp.example.com", read("idp-metadata.xml"));
+      const sp = new Login(spServer);
+      sp.initAuthnRequest("https://idp.example.com", HttpMethod.REDIRECT);
+      const query = sp.buildAuthnRequestMsg().responseUrl!.split("?")[1];
+
+      server.setAttributePolicy("https://sp.example.com", [
+        { name: "mail", friendlyName: "Email" },
+        { name: "uid", nameFormat: "urn:oasis:names:tc:SAML:2.0:attrname-format:uri" },
+      ]);
+      try {
+        const login = new Login(server);
+        login.processAuthnRequestMsg(query);
+        login.validateRequestMsg();
+        login.setNameId("user@example.com", NameIdFormat.EMAIL);
+        login.setAttributes([
+          { name: "uid", values: ["jdoe"] },
+          { name: "secret", values: ["not released"] },
+          { name: "mail", values: ["user@example.com"] },
+        ]);
+        login.buildAssertion();
+        const xml = Buffer.from(login.buildResponseMsg().responseBody!, "base64").toString();
+
+        expect(xml).toContain("jdoe");
+        expect(xml).toContain('FriendlyName="Email"');
+        expect(xml).not.toContain("not released");
+        expect(xml.indexOf('Name="mail"')).toBeLessThan(xml.indexOf('Name="uid"'));
+      } finally {
+        server.setAttributePolicy("https://sp.example.com", null);
+      }
+
+      expect(() => new Login(server).setAttributes([{ name: "x", values: [1] } as never])).toThrow(TypeError);
+    });
+
+    test("fromDump rejects invalid dumps", () => {
+      expect(() => Login.fromDump(server, "<not-a-login/>")).toThrow();
+      expect(() => Login.fromDump(server, 42 as never)).toThrow(TypeError);
+    });
+  });
+
+  describe("Request tracking (SP)", () => {
+    let server: ReturnType<typeof Server.fromBuffers>;
+
+    beforeAll(() => {
+      const spMetadata = fs.readFileSync(
+        path.join(fixturesDir, "sp-metadata.xml"),
+        "utf-8"
+      );
+      const spKey = fs.readFileSync(
+        path.join(fixturesDir, "sp-key.pem"),
+        "utf-8"
+      );
+      const spCert = fs.readFileSync(
+        path.join(fixturesDir, "sp-cert.pem"),
+        "utf-8"
+      );
+      const idpMetadata = fs.readFileSync(
+        path.join(fixturesDir, "idp-metadata.xml"),
+        "utf-8"
+      );
+
+      server = Server.fromBuffers(spMetadata, spKey, spCert);
+      server.addProviderFromBuffer("https://idp.example.com", idpMetadata);
+    });
+
+    afterEach(() => {
+      server.disableRequestTracking();
+    });
+
+    test("pendingRequests is 0 when tracking is disabled", () => {
+      const login = new Login(server);
+      login.initAuthnRequest("https://idp.example.com");
+      const result = login.buildAuthnRequestMsg();
+      expect(result.requestId).toBeDefined();
+      expect(server.pendingRequests).toBe(0);
+    });
+
+    test("buildAuthnRequestMsg records the request ID", () => {
+      server.enableRequestTracking({ maxEntries: 10, ttl: 60000 });
+
+      const login = new Login(server);
+      login.initAuthnRequest("https://idp.example.com");
+      const result = login.buildAuthnRequestMsg();
+
+      expect(result.requestId).toBe(login.requestId);
+      expect(server.pendingRequests).toBe(1);
+    });
+
+    test("AuthnRequest templates build valid, distinct requests", () => {
+      const read = (name: string) => fs.readFileSync(path.join(fixturesDir, name), "utf-8");
+      const build = () => {
+        const login = new Login(server);
+        login.initAuthnRequest("https://idp.example.com", HttpMethod.REDIRECT);
+        login.relayState = "/dashboard";
+        return { login, result: login.buildAuthnRequestMsg() };
+      };
+
+      server.enableAuthnRequestTemplates();
+      try {
+        const first = build();
+        expect(server.authnRequestTemplates).toBe(1);
+        const second = build();
+
+        const [endpoint, query] = second.result.responseUrl!.split("?");
+        expect(endpoint).toBe(first.result.responseUrl!.split("?")[0]);
+        expect(second.result.requestId).not.toBe(first.result.requestId);
+        expect(second.login.requestId).toBe(second.result.requestId);
+        expect(second.login.remoteProviderId).toBe("https://idp.example.com");
+        expect(decodeMessage(query)).toContain(`ID="${second.result.requestId}"`);
+        expect(query.includes("&Signature=")).toBe(first.result.responseUrl!.includes("&Signature="));
+
+        // The IdP accepts it, signature included
+        const idpServer = Server.fromBuffers(read("idp-metadata.xml"), read("idp-key.pem"), read("idp-cert.pem"));
+        idpServer.addProviderFromBuffer("https://sp.example.com", read("sp-metadata.xml"));
+        const idp = new Login(idpServer);
+        idp.processAuthnRequestMsg(query);
+        expect(idp.requestId).toBe(second.result.requestId);
+        expect(idp.relayState).toBe("/dashboard");
+
+        // Provider changes drop the templates
+        server.addProviderFromBuffer("https://idp.example.com", read("idp-metadata.xml"));
+        expect(server.authnRequestTemplates).toBe(0);
+      } finally {
+        server.disableAuthnRequestTemplates();
+      }
+    });
+
+    test("a full store evicts its oldest request instead of refusing logins", () => {
+      const idp = Server.fromBuffers(
+        readFixture("idp-metadata.xml"),
+        readFixture("idp-key.pem"),
+        readFixture("idp-cert.pem"),
+      );
+      idp.addProviderFromBuffer("https://sp.example.com", readFixture("sp-metadata.xml"));
+      server.enableRequestTracking({ maxEntries: 2 });
+
+      // A flood of login page hits never makes buildAuthnRequestMsg() throw
+      const logins = Array.from({ length: 3 }, () => idpSso(idp, server));
+      expect(server.pendingRequests).toBe(2);
+
+      expect(new Login(server).tryProcessResponseMsg(logins[0].response.responseBody!).code).toBe(
+        ErrorCode.UNKNOWN_IN_RESPONSE_TO,
+      );
+      logins[2].spLogin.processResponseMsg(logins[2].response.responseBody!);
+      logins[2].spLogin.acceptSso();
+      expect(server.pendingRequests).toBe(1);
+    });
+
+    test("a tracked response is accepted once, then rejected", () => {
+      const idp = Server.fromBuffers(
+        readFixture("idp-metadata.xml"),
+        readFixture("idp-key.pem"),
+        readFixture("idp-cert.pem"),
+      );
+      idp.addProviderFromBuffer("https://sp.example.com", readFixture("sp-metadata.xml"));
+
+      // Answers a request sent while tracking was off
+      const untracked = idpSso(idp, server);
+
+      server.enableRequestTracking();
+      const tracked = idpSso(idp, server);
+      expect(server.pendingRequests).toBe(1);
+
+      tracked.spLogin.processResponseMsg(tracked.response.responseBody!);
+      expect(tracked.spLogin.inResponseTo).toBe(tracked.request.requestId);
+      tracked.spLogin.acceptSso();
+      expect(tracked.spLogin.nameId).toBe("user@example.com");
+      expect(server.pendingRequests).toBe(0);
+
+      // Replayed
+      expect(new Login(server).tryProcessResponseMsg(tracked.response.responseBody!)).toEqual({
+        ok: false,
+        code: ErrorCode.UNKNOWN_IN_RESPONSE_TO,
+        category: "binding",
+      });
+
+      // InResponseTo unknown to the store
+      expect(new Login(server).tryProcessResponseMsg(untracked.response.responseBody!)).toEqual({
+        ok: false,
+        code: ErrorCode.UNKNOWN_IN_RESPONSE_TO,
+        category: "binding",
+      });
+    });
+
+    test("rejects invalid options", () => {
+      expect(() => server.enableRequestTracking({ ttl: 0 })).toThrow();
+    });
+
+    test("tryProcessResponseMsg reports rejections without throwing", () => {
+      const login = new Login(server);
+      const forged = Buffer.from("<samlp:Response/>").toString("base64");
+
+      const result = login.tryProcessResponseMsg(forged);
+      expect(result.ok).toBe(false);
+      expect(result.code).toBeLessThan(0);
+      expect(result.category).not.toBe("ok");
+
+      // The result object is reused across calls
+      expect(login.tryProcessResponseMsg(forged)).toBe(result);
+    });
+
+    test("tryProcessResponseMsg flags oversized messages as binding errors", () => {
+      const login = new Login(server);
+      const huge = Buffer.from("<a>" + "x".repeat(5 * 1024 * 1024) + "</a>").toString("base64");
+
+      const result = login.tryProcessResponseMsg(huge);
+      expect(result).toEqual({
+        ok: false,
+        code: ErrorCode.MESSAGE_TOO_LARGE,
+        category: "binding",
+      });
+      expect(() => login.processResponseMsg(huge)).toThrow("Message too large");
+    });
+
+    test("size check is not bypassed by query-like text or bare DEFLATE", () => {
+      const login = new Login(server);
+      const body = "<a>" + "x".repeat(5 * 1024 * 1024) + "</a>";
+
+      // Only a parameter the query parser can read back makes a Redirect query
+      const disguised = Buffer.from(body).toString("base64") + "SAMLResponse=x";
+      expect(login.tryProcessResponseMsg(disguised).code).toBe(ErrorCode.MESSAGE_TOO_LARGE);
+
+      // A compressed POST body is inflated up to the cap, not materialized
+      const bomb = zlib.deflateRawSync(Buffer.from(body)).toString("base64");
+      expect(login.tryProcessResponseMsg(bomb).code).toBe(ErrorCode.MESSAGE_TOO_LARGE);
+
+      // A '?' in RelayState must not hide the SAMLResponse parameter
+      const query = `SAMLResponse=${encodeURIComponent(bomb)}&RelayState=a?b`;
+      expect(login.tryProcessResponseMsg(query).code).toBe(ErrorCode.MESSAGE_TOO_LARGE);
+
+      // A Redirect payload that does not inflate never reaches Lasso
+      expect(login.tryProcessResponseMsg("SAMLResponse=bm90IGRlZmxhdGU%3D").code).toBe(
+        ErrorCode.MALFORMED_MESSAGE,
+      );
+    });
+
+    test("processResponseMsgAsync rejects forged responses inline and on a worker", async () => {
+      const forged = Buffer.from("<samlp:Response/>").toString("base64");
+
+      await expect(new Login(server).processResponseMsgAsync(forged)).rejects.toThrow();
+      await expect(
+        new Login(server).processResponseMsgAsync(forged, { threshold: 0 }),
+      ).rejects.toThrow();
+      expect(() => new Login(server).processResponseMsgAsync(forged, { threshold: -1 })).toThrow(
+        RangeError,
+      );
+    });
+
+    test("processResponseMsgAsync refuses overlapping calls", async () => {
+      const login = new Login(server);
+      const forged = Buffer.from("<samlp:Response/>").toString("base64");
+
+      const pending = login.processResponseMsgAsync(forged, { threshold: 0 });
+      expect(() => login.processResponseMsgAsync(forged)).toThrow("already being processed");
+      await expect(pending).rejects.toThrow();
+    });
+
+    test("processResponseMsgAsync locks the login until it settles", async () => {
+      const login = new Login(server);
+      const forged = Buffer.from("<samlp:Response/>").toString("base64");
+      const idpMetadata = fs.readFileSync(path.join(fixturesDir, "idp-metadata.xml"), "utf-8");
+
+      const pending = login.processResponseMsgAsync(forged, { threshold: 0 });
+      expect(() => login.nameId).toThrow("already being processed");
+      expect(() => login.dump()).toThrow("already being processed");
+      expect(() => login.acceptSso()).toThrow("already being processed");
+      expect(() => login.processResponseMsg(forged)).toThrow("already being processed");
+
+      // Waits for the worker instead of changing the provider table under it
+      server.addProviderFromBuffer("https://idp.example.com", idpMetadata);
+
+      await expect(pending).rejects.toThrow();
+      expect(login.nameId).toBeNull();
+    });
+  });
+
+  describe("Pre-filter (SP)", () => {
+    let server: ReturnType<typeof Server.fromBuffers>;
+
+    const response = (issuer: string, issueInstant: Date, extra = "") =>
+      Buffer.from(
+        '<samlp:Response xmlns:samlp="urn:oasis:names:tc:SAML:2.0:protocol" ' +
+          'xmlns:saml="urn:oasis:names:tc:SAML:2.0:assertion" ID="_r1" Version="2.0" ' +
+          `IssueInstant="${issueInstant.toISOString()}" ` +
+          'Destination="https://sp.example.com/saml/acs">' +
+          `<saml:Issuer>${issuer}</saml:Issuer>${extra}</samlp:Response>`
+      ).toString("base64");
+
+    beforeAll(() => {
+      const spMetadata = fs.readFileSync(path.join(fixturesDir, "sp-metadata.xml"), "utf-8");
+      const spKey = fs.readFileSync(path.join(fixturesDir, "sp-key.pem"), "utf-8");
+      const spCert = fs.readFileSync(path.join(fixturesDir, "sp-cert.pem"), "utf-8");
+      const idpMetadata = fs.readFileSync(path.join(fixturesDir, "idp-metadata.xml"), "utf-8");
+
+      server = Server.fromBuffers(spMetadata, spKey, spCert);
+      server.addProviderFromBuffer("https://idp.example.com", idpMetadata);
+    });
+
+    afterEach(() => {
+      server.setPrefilter(null);
+      server.setParserLimits(null);
+    });
+
+    test("rejects unknown issuers", () => {
+      server.setPrefilter({});
+      const login = new Login(server);
+
+      const result = login.tryProcessResponseMsg(response("https://evil.example.com", new Date()));
+      expect(result).toEqual({
+        ok: false,
+        code: ErrorCode.UNKNOWN_ISSUER,
+        category: "prefilter",
+      });
+    });
+
+    test("rejects unexpected destinations", () => {
+      server.setPrefilter({ destinations: ["https://sp.example.com/other"] });
+      const login = new Login(server);
+
+      const result = login.tryProcessResponseMsg(response("https://idp.example.com", new Date()));
+      expect(result.code).toBe(ErrorCode.WRONG_DESTINATION);
+    });
+
+    test("rejects stale and future IssueInstants", () => {
+      server.setPrefilter({ maxAge: 60000, clockSkew: 1000 });
+      const login = new Login(server);
+
+      const stale = response("https://idp.example.com", new Date(Date.now() - 3600000));
+      expect(login.tryProcessResponseMsg(stale).code).toBe(ErrorCode.STALE_ISSUE_INSTANT);
+
+      const future = response("https://idp.example.com", new Date(Date.now() + 3600000));
+      expect(login.tryProcessResponseMsg(future).code).toBe(ErrorCode.STALE_ISSUE_INSTANT);
+    });
+
+    test("rejects signatures whose KeyInfo names no key of the issuer", () => {
+      const idpMetadata = fs.readFileSync(path.join(fixturesDir, "idp-metadata.xml"), "utf-8");
+      const certificate = /<(?:ds:)?X509Certificate>([^<]+)</.exec(idpMetadata)![1];
+      const signature = (keyInfo: string) =>
+        '<ds:Signature xmlns:ds="http://www.w3.org/2000/09/xmldsig#">' +
+        `<ds:KeyInfo>${keyInfo}</ds:KeyInfo></ds:Signature>`;
+      const x509 = (value: string) => `<ds:X509Data><ds:X509Certificate>${value}</ds:X509Certificate></ds:X509Data>`;
+
+      const keys = server.getProvider("https://idp.example.com")!.signingKeys!;
+      expect(keys.length).toBeGreaterThan(0);
+      expect(keys[0].sha256).toMatch(/^[0-9a-f]{64}$/);
+
+      server.setPrefilter({ knownKey: true });
+      const login = new Login(server);
+      const now = new Date();
+
+      const foreign = Buffer.from("not the IdP certificate").toString("base64");
+      expect(
+        login.tryProcessResponseMsg(response("https://idp.example.com", now, signature(x509(foreign))))
+      ).toEqual({ ok: false, code: ErrorCode.UNKNOWN_SIGNING_KEY, category: "prefilter" });
+
+      // The IdP's own certificate, or no hint at all, is left to Lasso
+      expect(
+        login.tryProcessResponseMsg(response("https://idp.example.com", now, signature(x509(certificate)))).code
+      ).not.toBe(ErrorCode.UNKNOWN_SIGNING_KEY);
+      expect(
+        login.tryProcessResponseMsg(response("https://idp.example.com", now, signature(""))).code
+      ).not.toBe(ErrorCode.UNKNOWN_SIGNING_KEY);
+    });
+
+    test("rejects deeply nested documents", () => {
+      server.setPrefilter({ maxDepth: 16 });
+      const login = new Login(server);
+
+      const nested = "<a>".repeat(100) + "</a>".repeat(100);
+      const result = login.tryProcessResponseMsg(response("https://idp.example.com", new Date(), nested));
+      expect(result.code).toBe(ErrorCode.MESSAGE_TOO_DEEP);
+      expect(() => login.processResponseMsg(response("https://idp.example.com", new Date(), nested)))
+        .toThrow("element nesting too deep");
+    });
+
+    test("passes plausible messages on to Lasso", () => {
+      server.setPrefilter({ destinations: ["https://sp.example.com/saml/acs"] });
+      const login = new Login(server);
+
+      // Unsigned, so Lasso itself still rejects it
+      const result = login.tryProcessResponseMsg(response("https://idp.example.com", new Date()));
+      expect(result.ok).toBe(false);
+      expect(result.category).not.toBe("prefilter");
+    });
+
+    test("rejects invalid options", () => {
+      expect(() => server.setPrefilter({ maxAge: -1 })).toThrow();
+      expect(() => server.setPrefilter({ destinations: "x" as unknown as string[] })).toThrow();
+    });
+
+    test("parser limits bound node and attribute counts", () => {
+      server.setParserLimits({ maxNodes: 100, maxAttributes: 8 });
+      const login = new Login(server);
+
+      const wide = "<a/>".repeat(500);
+      const result = login.tryProcessResponseMsg(response("https://idp.example.com", new Date(), wide));
+      expect(result).toEqual({
+        ok: false,
+        code: ErrorCode.PARSER_LIMIT,
+        category: "prefilter",
+      });
+
+      const attributes = Array.from({ length: 20 }, (_, i) => `a${i}="1"`).join(" ");
+      const crowded = response("https://idp.example.com", new Date(), `<x ${attributes}/>`);
+      expect(login.tryProcessResponseMsg(crowded).code).toBe(ErrorCode.PARSER_LIMIT);
+    });
+
+    test("parser limits bound text size and namespace declarations", () => {
+      server.setParserLimits({ maxTextSize: 1024, maxNamespaces: 10 });
+      const login = new Login(server);
+
+      const text = `<x>${"y".repeat(4096)}</x>`;
+      expect(login.tryProcessResponseMsg(response("https://idp.example.com", new Date(), text)).code)
+        .toBe(ErrorCode.PARSER_LIMIT);
+
+      const namespaces = Array.from({ length: 20 }, (_, i) => `<x xmlns:n${i}="urn:n${i}"/>`).join("");
+      expect(login.tryProcessResponseMsg(response("https://idp.example.com", new Date(), namespaces)).code)
+        .toBe(ErrorCode.PARSER_LIMIT);
+    });
+
+    test("parser limits alone leave the message checks to Lasso", () => {
+      server.setParserLimits({});
+      const login = new Login(server);
+
+      const result = login.tryProcessResponseMsg(response("https://evil.example.com", new Date()));
+      expect(result.ok).toBe(false);
+      expect(result.category).not.toBe("prefilter");
+    });
+  });
+
+  describe("HTTP-Artifact", () => {
+    let idpServer: ReturnType<typeof Server.fromBuffers>;
+    let spServer: ReturnType<typeof Server.fromBuffers>;
+
+    // SAML 2.0 artifact: type 0x0004, endpoint index, SHA-1(IdP entityID), handle
+    function makeArtifact(): string {
+      const sourceId = crypto.createHash("sha1").update("https://idp.example.com").digest();
+      return Buffer.concat([
+        Buffer.from([0x00, 0x04, 0x00, 0x00]),
+        sourceId,
+        crypto.randomBytes(20),
+      ]).toString("base64");
+    }
+
+    beforeAll(() => {
+      const read = (name: string) => fs.readFileSync(path.join(fixturesDir, name), "utf-8");
+
+      idpServer = Server.fromBuffers(read("idp-metadata.xml"), read("idp-key.pem"), read("idp-cert.pem"));
+      idpServer.addProviderFromBuffer("https://sp.example.com", read("sp-metadata.xml"));
+
+      spServer = Server.fromBuffers(read("sp-metadata.xml"), read("sp-key.pem"), read("sp-cert.pem"));
+      spServer.addProviderFromBuffer("https://idp.example.com", read("idp-metadata.xml"));
+    });
+
+    test("SP builds an ArtifactResolve for the IdP resolution service", () => {
+      const login = new Login(spServer);
+      login.initRequest(makeArtifact(), HttpMethod.ARTIFACT_POST);
+      const request = login.buildRequestMsg();
+
+      expect(request.responseUrl).toBe("https://idp.example.com/saml/artifact");
+      expect(request.responseBody).toContain("ArtifactResolve");
+    });
+
+    test("IdP does not resolve unknown artifacts", () => {
+      const sp = new Login(spServer);
+      sp.initRequest(`SAMLart=${encodeURIComponent(makeArtifact())}`, HttpMethod.ARTIFACT_GET);
+      const request = sp.buildRequestMsg();
+
+      const idp = new Login(idpServer);
+      const result = idp.processArtifactResolve(request.responseBody as string);
+
+      expect(result.resolved).toBe(false);
+      expect(result.responseBody).toContain("ArtifactResponse");
+      expect(idpServer.pendingArtifacts).toBe(0);
+    });
+
+    test("rejects non-artifact methods", () => {
+      const login = new Login(spServer);
+      expect(() => login.initRequest(makeArtifact(), HttpMethod.POST)).toThrow(TypeError);
+    });
+
+    test("resolveArtifact goes through the SOAP transport", async () => {
+      const calls: string[] = [];
+      const client = new SoapClient({
+        transport: async (url, body) => {
+          calls.push(url);
+          return new Login(idpServer).processArtifactResolve(body).responseBody;
+        },
+      });
+
+      const login = new Login(spServer);
+      await expect(
+        resolveArtifact(login, makeArtifact(), HttpMethod.ARTIFACT_POST, client),
+      ).rejects.toThrow();
+      expect(calls).toEqual(["https://idp.example.com/saml/artifact"]);
+    });
+
+    test("an artifact from buildArtifactMsg resolves to a Response the SP accepts", async () => {
+      const sp = new Login(spServer);
+      sp.initAuthnRequest("https://idp.example.com", HttpMethod.REDIRECT);
+      const request = sp.buildAuthnRequestMsg();
+
+      const idp = new Login(idpServer);
+      idp.processAuthnRequestMsg(request.responseUrl!.split("?")[1]);
+      idp.validateRequestMsg();
+      idp.setNameId("user@example.com", NameIdFormat.EMAIL);
+      idp.buildAssertion();
+      const redirect = idp.buildArtifactMsg(HttpMethod.ARTIFACT_GET);
+      expect(idpServer.pendingArtifacts).toBe(1);
+
+      // The browser only carries the artifact to the ACS
+      const query = redirect.responseUrl!.split("?")[1];
+      expect(query).toMatch(/(^|&)SAMLart=/);
+      expect(query).not.toMatch(/SAMLResponse=/);
+
+      const resolved: boolean[] = [];
+      const client = new SoapClient({
+        transport: async (url, body) => {
+          expect(url).toBe("https://idp.example.com/saml/artifact");
+          const result = new Login(idpServer).processArtifactResolve(body);
+          resolved.push(result.resolved);
+          return result.responseBody;
+        },
+      });
+
+      const acs = new Login(spServer);
+      await resolveArtifact(acs, query, HttpMethod.ARTIFACT_GET, client);
+      acs.acceptSso();
+
+      expect(resolved).toEqual([true]);
+      expect(acs.nameId).toBe("user@example.com");
+      expect(idpServer.pendingArtifacts).toBe(0);
+
+      // An artifact resolves once
+      await expect(
+        resolveArtifact(new Login(spServer), query, HttpMethod.ARTIFACT_GET, client),
+      ).rejects.toThrow();
+      expect(resolved).toEqual([true, false]);
+    });
+
+    test("SoapClient posts over pooled HTTP", async () => {
+      const server = http.createServer((req, res) => {
+        let body = "";
+        req.on("data", (chunk) => (body += chunk));
+        req.on("end", () => {
+          res.writeHead(200, { "Content-Type": "text/xml" });
+          res.end(`<echo action=${req.headers.soapaction}>${body}</echo>`);
+        });
+      });
+      await new Promise<void>((resolve) => server.listen(0, "127.0.0.1", resolve));
+      const { port } = server.address() as { port: number };
+
+      const client = new SoapClient({ timeout: 2000 });
+      try {
+        const response = await client.post(`http://127.0.0.1:${port}/soap`, "<ping/>");
+        expect(response).toContain("<ping/>");
+        expect(response).toContain("oasis-open.org/committees/security");
+      } finally {
+        client.destroy();
+        server.close();
+      }
+    });
   });
 
   describe("Logout", () => {
@@ -220,5 +1374,82 @@ describe("lasso.js", () => {
       expect(logout.identity).toBeNull();
       expect(logout.session).toBeNull();
     });
+
+    test("buildSoapRequestsAsync requires a session", () => {
+      const logout = new Logout(server);
+      expect(() => logout.buildSoapRequestsAsync()).toThrow(/session/);
+    });
+
+    test("soapSingleLogout completes with no other providers", async () => {
+      const logout = new Logout(server);
+      logout.session = new Session();
+
+      const client = new SoapClient({
+        transport: async () => {
+          throw new Error("no request expected");
+        },
+      });
+      const outcome = await soapSingleLogout(logout, client);
+
+      expect(outcome).toEqual({ complete: true, results: [] });
+    });
+
+    test("soapSingleLogout reports a provider past its deadline as a partial logout", async () => {
+      const idp = Server.fromBuffers(
+        readFixture("idp-metadata.xml"),
+        readFixture("idp-key.pem"),
+        readFixture("idp-cert.pem"),
+      );
+      const sps = new Map<string, { server: ServerInstance; session: Session | null }>();
+      let idpSession: Session | null = null;
+
+      for (const entityId of ["https://sp1.example.com", "https://sp2.example.com"]) {
+        const metadata = spMetadataFor(entityId);
+        idp.addProviderFromBuffer(entityId, metadata);
+        const sp = Server.fromBuffers(metadata, readFixture("sp-key.pem"), readFixture("sp-cert.pem"));
+        sp.addProviderFromBuffer("https://idp.example.com", readFixture("idp-metadata.xml"));
+
+        const { spLogin, idpLogin, response } = idpSso(idp, sp, idpSession);
+        spLogin.processResponseMsg(response.responseBody!);
+        spLogin.acceptSso();
+        sps.set(entityId, { server: sp, session: spLogin.session });
+        idpSession = idpLogin.session;
+      }
+      expect(idpSession!.getProviderIds().sort()).toEqual([...sps.keys()]);
+
+      const calls: string[] = [];
+      const client = new SoapClient({
+        timeout: 200,
+        transport: async (url, body) => {
+          calls.push(url);
+          if (url.startsWith("https://sp2.example.com")) {
+            return new Promise<string>(() => {});  // Never answers
+          }
+          const sp = sps.get("https://sp1.example.com")!;
+          const logout = new Logout(sp.server);
+          logout.session = sp.session;
+          logout.processRequestMsg(body);
+          logout.validateRequest();
+          return logout.buildResponseMsg().responseBody!;
+        },
+      });
+
+      const logout = new Logout(idp);
+      logout.session = idpSession;
+      const outcome = await soapSingleLogout(logout, client);
+
+      expect(calls.sort()).toEqual([
+        "https://sp1.example.com/saml/soap",
+        "https://sp2.example.com/saml/soap",
+      ]);
+      expect(outcome.complete).toBe(false);
+      const results = Object.fromEntries(outcome.results.map((result) => [result.providerId, result]));
+      expect(results["https://sp1.example.com"]).toEqual({ providerId: "https://sp1.example.com", ok: true });
+      expect(results["https://sp2.example.com"]).toEqual({
+        providerId: "https://sp2.example.com",
+        ok: false,
+        error: "SOAP request timed out",
+      });
+    });
   });
 });
@@ -9,7 +9,13 @@
  */
 
 import * as crypto from "crypto";
-import { escapeHtml, isValidRedirectUrl } from "../lib/express";
+import {
+  escapeHtml,
+  isValidRedirectUrl,
+  requestCookieOptions,
+  signRequestCookie,
+  verifyRequestCookie,
+} from "../lib/express";
 
 describe("Security", () => {
   describe("URL Validation (isValidRedirectUrl)", () => {
@@ -151,6 +157,41 @@ describe("Security", () => {
       const uuidRegex = /^[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$/i;
       expect(uuidRegex.test(nonce)).toBe(true);
     });
+
+    it("should bind native-store logins to the browser with a signed cookie", () => {
+      const key = crypto.randomBytes(32);
+      const cookie = (value: string) =>
+        `other=1; lasso_saml_request=${encodeURIComponent(value)}; theme=dark`;
+      const value = signRequestCookie("_abc123", key);
+
+      expect(verifyRequestCookie(cookie(value), key)).toBe("_abc123");
+
+      // Missing, forged, re-targeted or signed with another key
+      expect(verifyRequestCookie(undefined, key)).toBeNull();
+      expect(verifyRequestCookie("other=1", key)).toBeNull();
+      expect(verifyRequestCookie(cookie("_abc123"), key)).toBeNull();
+      expect(verifyRequestCookie(cookie(value.replace("_abc123", "_attacker")), key)).toBeNull();
+      expect(verifyRequestCookie(cookie(value), crypto.randomBytes(32))).toBeNull();
+      expect(verifyRequestCookie("lasso_saml_request=%E0%A4%A", key)).toBeNull();
+    });
+
+    it("should not downgrade the request cookie over plain HTTP", () => {
+      // SameSite=None survives the IdP's cross-site POST, and needs Secure
+      expect(requestCookieOptions(true, "none", "/saml/acs", 60000)).toEqual({
+        httpOnly: true,
+        secure: true,
+        sameSite: "none",
+        maxAge: 60000,
+        path: "/saml/acs",
+      });
+      // A Lax cookie would be dropped from that POST: refuse instead
+      expect(() => requestCookieOptions(false, "none", "/saml/acs", 60000)).toThrow(/HTTPS/);
+      // Unless Lax was chosen explicitly
+      expect(requestCookieOptions(false, "lax", "/saml/acs", 60000)).toMatchObject({
+        secure: false,
+        sameSite: "lax",
+      });
+    });
   });
 
   describe("Input Size Limits", () => {